@@ -0,0 +1,1504 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "clk.h"
+#include "err.h"
+#include "fd.h"
+#include "hdr.h"
+#include "match.h"
+#include "proc.h"
+#include "macros.h"
+
+#include "lines.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/* Run each supervisor with purpose built child processes, and report
+ * the results one line per benchmark as key=value pairs so that the
+ * results can be tracked by continuous integration. Supervisor usage
+ * is read from /proc, so the benchmarks only run on Linux. */
+
+#define BENCH_RUNS           100
+#define BENCH_SAMPLE_MICROS  (2 * 1000000ULL)
+#define BENCH_TIMEOUT_MICROS (10 * 1000000ULL)
+
+#define BENCH_SCAN_BYTES  (16 * 1024 * 1024)
+#define BENCH_FLOOD_BYTES (256 * 1024 * 1024ULL)
+
+/* The chatty relay benchmark is scaled down from 1000 services to suit
+ * small hosts, keeping the aggregate line rate of 1000 services each
+ * writing 10 lines per second. */
+
+#define BENCH_CHATTY_CHILDREN 100
+#define BENCH_CHATTY_RATE     100
+
+#define BENCH_HIGHEST (60 * 1000000ULL)
+#define BENCH_DIGITS  3
+
+static const char ChildPath[] = "bench/child";
+
+struct Supervisor {
+    pid_t  mPid;
+    int    mStampFd;
+    size_t mLen;
+    char   mBuf[4096];
+};
+
+struct SupervisorUsage {
+    uint64_t mCpuMicros;
+    uint64_t mRssKib;
+};
+
+struct SupervisorOutput {
+    int mQuiet;
+    int mOutputFd;
+};
+
+/******************************************************************************/
+static int
+prepare_supervisor(void *aArg)
+{
+    int rc = -1;
+
+    const struct SupervisorOutput *output = aArg;
+
+    int nullFd = -1;
+
+    /* Discard the output relayed by the supervisor, unless it is to be
+     * measured, so that it does not interleave with the results, and
+     * discard the diagnostics that are expected from the supervisor
+     * when quiet. */
+
+    nullFd = open("/dev/null", O_WRONLY);
+    if (-1 == nullFd)
+        goto Finally;
+
+    int outputFd = -1 == output->mOutputFd ? nullFd : output->mOutputFd;
+
+    if (STDOUT_FILENO != dup2(outputFd, STDOUT_FILENO))
+        goto Finally;
+
+    if (output->mQuiet && STDERR_FILENO != dup2(nullFd, STDERR_FILENO))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (-1 != nullFd)
+            close(nullFd);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+supervisor_start(
+    struct Supervisor *aSupervisor, char **aCmd, int aQuiet, int aOutputFd,
+    uint64_t *aStartMicros)
+{
+    int rc = -1;
+
+    int stampFd[2] = { -1, -1 };
+
+    aSupervisor->mPid     = -1;
+    aSupervisor->mStampFd = -1;
+    aSupervisor->mLen     = 0;
+
+    /* Each supervisor reports through a new pipe, so that the end of
+     * the reports is seen once the supervisor and all its children
+     * have terminated. */
+
+    if (pipe(stampFd))
+        goto Finally;
+
+    if (fd_cloexec(stampFd[0]))
+        goto Finally;
+
+    char stampEnv[sizeof(int) * CHAR_BIT];
+
+    snprintf(stampEnv, sizeof(stampEnv), "%d", stampFd[1]);
+
+    if (setenv("BENCH_FD", stampEnv, 1))
+        goto Finally;
+
+    if (aStartMicros)
+        *aStartMicros = clk_monomicros();
+
+    struct SupervisorOutput output = {
+        .mQuiet    = aQuiet,
+        .mOutputFd = aOutputFd,
+    };
+
+    aSupervisor->mPid = proc_execute(aCmd, prepare_supervisor, &output);
+    if (-1 == aSupervisor->mPid)
+        goto Finally;
+
+    aSupervisor->mStampFd = stampFd[0];
+    stampFd[0] = -1;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (-1 != stampFd[0])
+            close(stampFd[0]);
+
+        if (-1 != stampFd[1])
+            close(stampFd[1]);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+wait_readable(uint64_t aDeadlineMicros, int aFd)
+{
+    int rc = -1;
+
+    /* Wait until the monotonic clock reaches the deadline, or until the
+     * file descriptor becomes readable. Return 1 if the file descriptor
+     * is readable, or 0 if the deadline was reached. */
+
+    while (1) {
+        uint64_t now = clk_monomicros();
+
+        uint64_t duration = aDeadlineMicros > now ? aDeadlineMicros - now : 0;
+
+        struct timespec pollDuration;
+        pollDuration.tv_sec = duration / 1000000;
+        pollDuration.tv_nsec = duration % 1000000 * 1000;
+
+        struct pollfd pollFd = { .fd = aFd, .events = POLLIN };
+
+        int polled = ppoll(&pollFd, 1, &pollDuration, 0);
+
+        if (-1 == polled) {
+            if (EINTR == errno)
+                continue;
+            goto Finally;
+        }
+
+        if (polled || clk_monomicros() >= aDeadlineMicros) {
+            rc = !!polled;
+            break;
+        }
+    }
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+supervisor_read(
+    struct Supervisor *aSupervisor,
+    const char *aEvent, uint64_t *aMicros, uint64_t aDeadlineMicros)
+{
+    int rc = -1;
+
+    /* Return 1 if the next report is the named event, 0 if there are
+     * no more reports, or -1 on error or if the deadline passes. */
+
+    while (1) {
+        char *endPtr = memchr(aSupervisor->mBuf, '\n', aSupervisor->mLen);
+
+        if (endPtr) {
+            *endPtr++ = 0;
+
+            char stampEvent[16];
+
+            if (2 != sscanf(aSupervisor->mBuf,
+                        "%15s %" SCNu64, stampEvent, aMicros)) {
+                errno = EINVAL;
+                goto Finally;
+            }
+
+            aSupervisor->mLen -= endPtr - aSupervisor->mBuf;
+            memmove(aSupervisor->mBuf, endPtr, aSupervisor->mLen);
+
+            if (strcmp(aEvent, stampEvent)) {
+                error("Expected %s but received %s", aEvent, stampEvent);
+                errno = EINVAL;
+                goto Finally;
+            }
+
+            rc = 1;
+            break;
+        }
+
+        int ready = wait_readable(aDeadlineMicros, aSupervisor->mStampFd);
+
+        if (-1 == ready)
+            goto Finally;
+
+        if (!ready) {
+            errno = ETIMEDOUT;
+            goto Finally;
+        }
+
+        if (sizeof(aSupervisor->mBuf) == aSupervisor->mLen) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        ssize_t readLen = read(
+            aSupervisor->mStampFd,
+            aSupervisor->mBuf + aSupervisor->mLen,
+            sizeof(aSupervisor->mBuf) - aSupervisor->mLen);
+
+        if (-1 == readLen) {
+            if (EINTR == errno)
+                continue;
+            goto Finally;
+        }
+
+        if (!readLen) {
+            rc = 0;
+            break;
+        }
+
+        aSupervisor->mLen += readLen;
+    }
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+supervisor_stop(struct Supervisor *aSupervisor, int aSignal)
+{
+    if (aSignal)
+        kill(aSupervisor->mPid, aSignal);
+
+    while (-1 == waitpid(aSupervisor->mPid, 0, 0)) {
+        if (EINTR != errno)
+            die("Unable to reap supervisor %d", aSupervisor->mPid);
+    }
+
+    close(aSupervisor->mStampFd);
+
+    aSupervisor->mPid     = -1;
+    aSupervisor->mStampFd = -1;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+process_usage(pid_t aPid, struct SupervisorUsage *aUsage)
+{
+    char procPath[64];
+    char procLine[1024];
+
+    FILE *procFile;
+
+    /* Only count the time used by the process itself, and not the
+     * time of the children that it has reaped. */
+
+    snprintf(procPath, sizeof(procPath), "/proc/%d/stat", aPid);
+
+    procFile = fopen(procPath, "r");
+    if (!procFile || !fgets(procLine, sizeof(procLine), procFile))
+        die("Unable to read %s", procPath);
+    fclose(procFile);
+
+    unsigned long userTicks;
+    unsigned long systemTicks;
+
+    const char *statPtr = strrchr(procLine, ')');
+
+    if (!statPtr || 2 != sscanf(statPtr + 1,
+            " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+            &userTicks, &systemTicks))
+        die("Unable to parse %s", procPath);
+
+    aUsage->mCpuMicros =
+        (uint64_t) (userTicks + systemTicks) * 1000000 / sysconf(_SC_CLK_TCK);
+
+    /* The time is counted in clock ticks, which is too coarse for a
+     * process that only runs briefly, so prefer the time on the cpu
+     * accounted by the scheduler when it is available. */
+
+    snprintf(procPath, sizeof(procPath), "/proc/%d/schedstat", aPid);
+
+    procFile = fopen(procPath, "r");
+    if (procFile) {
+        uint64_t cpuNanos;
+
+        if (1 == fscanf(procFile, "%" SCNu64, &cpuNanos))
+            aUsage->mCpuMicros = cpuNanos / 1000;
+        fclose(procFile);
+    }
+
+    snprintf(procPath, sizeof(procPath), "/proc/%d/status", aPid);
+
+    procFile = fopen(procPath, "r");
+    if (!procFile)
+        die("Unable to read %s", procPath);
+
+    aUsage->mRssKib = 0;
+
+    while (fgets(procLine, sizeof(procLine), procFile)) {
+        if (1 == sscanf(procLine, "VmRSS: %" SCNu64, &aUsage->mRssKib))
+            break;
+    }
+
+    fclose(procFile);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+supervisor_usage(
+    const struct Supervisor *aSupervisor, struct SupervisorUsage *aUsage)
+{
+    process_usage(aSupervisor->mPid, aUsage);
+}
+
+/*----------------------------------------------------------------------------*/
+static unsigned
+pool_usage(pid_t aPid, struct SupervisorUsage *aUsage)
+{
+    char procPath[64];
+
+    /* Add the usage of the pool supervisor, and of the supervisor of
+     * each replica, but not of the programs that they supervise. Each
+     * replica supervisor is a child of the pool, and has the same name.
+     * Return the number of supervisors counted. */
+
+    struct SupervisorUsage usage;
+
+    process_usage(aPid, &usage);
+
+    aUsage->mCpuMicros += usage.mCpuMicros;
+    aUsage->mRssKib    += usage.mRssKib;
+
+    unsigned supervisors = 1;
+
+    char poolComm[64];
+
+    snprintf(procPath, sizeof(procPath), "/proc/%d/comm", aPid);
+
+    FILE *commFile = fopen(procPath, "r");
+    if (!commFile || !fgets(poolComm, sizeof(poolComm), commFile))
+        die("Unable to read %s", procPath);
+    fclose(commFile);
+
+    snprintf(procPath, sizeof(procPath), "/proc/%d/task/%d/children",
+        aPid, aPid);
+
+    FILE *procFile = fopen(procPath, "r");
+    if (!procFile)
+        die("Unable to read %s", procPath);
+
+    int childPid;
+
+    while (1 == fscanf(procFile, "%d", &childPid)) {
+        char childComm[64];
+
+        snprintf(procPath, sizeof(procPath), "/proc/%d/comm", childPid);
+
+        commFile = fopen(procPath, "r");
+        if (!commFile)
+            continue;
+
+        int named = !!fgets(childComm, sizeof(childComm), commFile);
+        fclose(commFile);
+
+        if (named && !strcmp(childComm, poolComm)) {
+            process_usage(childPid, &usage);
+
+            aUsage->mCpuMicros += usage.mCpuMicros;
+            aUsage->mRssKib    += usage.mRssKib;
+
+            ++supervisors;
+        }
+    }
+
+    fclose(procFile);
+
+    return supervisors;
+}
+
+/******************************************************************************/
+static void
+report_latency(
+    const char *aBench, const char *aSupervisor,
+    const struct HdrHistogram *aHist)
+{
+    printf("bench=%s supervisor=%s runs=%" PRIu64
+           " p50_us=%" PRIu64 " p90_us=%" PRIu64
+           " p99_us=%" PRIu64 " max_us=%" PRIu64 "\n",
+        aBench, aSupervisor, aHist->mTotal,
+        hdr_percentile(aHist, 50),
+        hdr_percentile(aHist, 90),
+        hdr_percentile(aHist, 99),
+        aHist->mMax);
+
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+report_usage(
+    const char *aBench, const char *aSupervisor, const char *aExtra,
+    uint64_t aElapsedMicros,
+    const struct SupervisorUsage *aBegin, const struct SupervisorUsage *aEnd)
+{
+    uint64_t cpuMicros = aEnd->mCpuMicros - aBegin->mCpuMicros;
+
+    printf("bench=%s supervisor=%s%s seconds=%.3f"
+           " cpu_pct=%.2f rss_kib=%" PRIu64 "\n",
+        aBench, aSupervisor, aExtra,
+        aElapsedMicros / 1e6,
+        100.0 * cpuMicros / aElapsedMicros,
+        aEnd->mRssKib);
+
+    fflush(stdout);
+}
+
+/******************************************************************************/
+static void
+bench_spawn(const char *aSupervisor)
+{
+    struct HdrHistogram hist;
+
+    char *cmd[] = {
+        (char *) aSupervisor, "--", (char *) ChildPath, "start", 0 };
+
+    if (hdr_init(&hist, BENCH_HIGHEST, BENCH_DIGITS))
+        die("Unable to create histogram");
+
+    /* Measure from spawning the supervisor to the program running. */
+
+    for (unsigned run = 0; run < BENCH_RUNS; ++run) {
+        struct Supervisor supervisor;
+
+        uint64_t spawnMicros;
+        uint64_t startMicros;
+
+        if (supervisor_start(&supervisor, cmd, 0, -1, &spawnMicros))
+            die("Unable to start %s", aSupervisor);
+
+        if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                    spawnMicros + BENCH_TIMEOUT_MICROS))
+            die("Unable to start %s", ChildPath);
+
+        hdr_record(&hist, startMicros - spawnMicros);
+
+        supervisor_stop(&supervisor, 0);
+    }
+
+    report_latency("spawn_exec", aSupervisor, &hist);
+
+    hdr_close(&hist);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_crash(const char *aSupervisor)
+{
+    struct HdrHistogram hist;
+
+    char *cmd[] = {
+        (char *) aSupervisor, "--", (char *) ChildPath, "crash", 0 };
+
+    if (hdr_init(&hist, BENCH_HIGHEST, BENCH_DIGITS))
+        die("Unable to create histogram");
+
+    /* Measure from a failure to the next instance running. The
+     * supervisor stops retrying a program that repeatedly fails
+     * immediately, so start the supervisor as often as needed. */
+
+    while (hist.mTotal < BENCH_RUNS) {
+        struct Supervisor supervisor;
+
+        if (supervisor_start(&supervisor, cmd, 1, -1, 0))
+            die("Unable to start %s", aSupervisor);
+
+        uint64_t deadlineMicros = clk_monomicros() + BENCH_TIMEOUT_MICROS;
+        uint64_t exitMicros     = 0;
+
+        while (1) {
+            uint64_t startMicros;
+
+            int started = supervisor_read(
+                &supervisor, "start", &startMicros, deadlineMicros);
+
+            if (-1 == started)
+                die("Unable to start %s", ChildPath);
+
+            if (!started)
+                break;
+
+            if (exitMicros)
+                hdr_record(&hist, startMicros - exitMicros);
+
+            if (1 != supervisor_read(
+                        &supervisor, "exit", &exitMicros, deadlineMicros))
+                die("Unable to crash %s", ChildPath);
+        }
+
+        supervisor_stop(&supervisor, 0);
+    }
+
+    report_latency("crash_respawn", aSupervisor, &hist);
+
+    hdr_close(&hist);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_signal(const char *aSupervisor)
+{
+    struct HdrHistogram hist;
+    struct Supervisor   supervisor;
+
+    char *cmd[] = {
+        (char *) aSupervisor, "--", (char *) ChildPath, "signal", 0 };
+
+    if (hdr_init(&hist, BENCH_HIGHEST, BENCH_DIGITS))
+        die("Unable to create histogram");
+
+    uint64_t startMicros;
+
+    if (supervisor_start(&supervisor, cmd, 0, -1, &startMicros))
+        die("Unable to start %s", aSupervisor);
+
+    if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                startMicros + BENCH_TIMEOUT_MICROS))
+        die("Unable to start %s", ChildPath);
+
+    /* Measure from signalling the supervisor to the program receiving
+     * the forwarded signal. Each signal is sent as soon as the previous
+     * one is received, before the supervisor has necessarily returned
+     * to wait, so that the tail includes signals that arrive while the
+     * supervisor is still busy. */
+
+    for (unsigned run = 0; run < BENCH_RUNS; ++run) {
+        uint64_t signalMicros = clk_monomicros();
+        uint64_t receiveMicros;
+
+        if (kill(supervisor.mPid, SIGHUP))
+            die("Unable to signal %s", aSupervisor);
+
+        if (1 != supervisor_read(&supervisor, "signal", &receiveMicros,
+                    signalMicros + BENCH_TIMEOUT_MICROS))
+            die("Unable to forward signal to %s", ChildPath);
+
+        hdr_record(&hist, receiveMicros - signalMicros);
+    }
+
+    supervisor_stop(&supervisor, SIGTERM);
+
+    report_latency("signal_forward", aSupervisor, &hist);
+
+    hdr_close(&hist);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_idle(const char *aSupervisor)
+{
+    struct Supervisor supervisor;
+
+    char *cmd[] = {
+        (char *) aSupervisor, "--", (char *) ChildPath, "idle", 0 };
+
+    uint64_t startMicros;
+
+    if (supervisor_start(&supervisor, cmd, 0, -1, &startMicros))
+        die("Unable to start %s", aSupervisor);
+
+    if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                startMicros + BENCH_TIMEOUT_MICROS))
+        die("Unable to start %s", ChildPath);
+
+    /* Measure the resources used by the supervisor while the program
+     * runs without interruption. */
+
+    struct SupervisorUsage beginUsage;
+    struct SupervisorUsage endUsage;
+
+    uint64_t beginMicros = clk_monomicros();
+    supervisor_usage(&supervisor, &beginUsage);
+
+    clk_sleepuntil(beginMicros + BENCH_SAMPLE_MICROS);
+
+    supervisor_usage(&supervisor, &endUsage);
+    uint64_t endMicros = clk_monomicros();
+
+    supervisor_stop(&supervisor, SIGTERM);
+
+    report_usage("idle", aSupervisor, "",
+        endMicros - beginMicros, &beginUsage, &endUsage);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_restart(const char *aSupervisor)
+{
+    struct Supervisor supervisor;
+
+    char *cmd[] = {
+        (char *) aSupervisor, "-D", "restart:RESTART",
+        "--", (char *) ChildPath, "restart", 0 };
+
+    uint64_t startMicros;
+
+    if (supervisor_start(&supervisor, cmd, 0, -1, &startMicros))
+        die("Unable to start %s", aSupervisor);
+
+    if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                startMicros + BENCH_TIMEOUT_MICROS))
+        die("Unable to start %s", ChildPath);
+
+    /* Measure the sustained rate of restarts, and the resources used by
+     * the supervisor while restarting. Each instance asks to be
+     * restarted as soon as it starts. A program that fails immediately
+     * is not restarted indefinitely, so cannot be used to sustain the
+     * restart loop. */
+
+    struct SupervisorUsage beginUsage;
+    struct SupervisorUsage endUsage;
+
+    uint64_t beginMicros = clk_monomicros();
+    supervisor_usage(&supervisor, &beginUsage);
+
+    unsigned restarts = 0;
+
+    while (1) {
+        if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                    clk_monomicros() + BENCH_TIMEOUT_MICROS))
+            die("Unable to restart %s", ChildPath);
+
+        ++restarts;
+
+        if (startMicros - beginMicros >= BENCH_SAMPLE_MICROS)
+            break;
+    }
+
+    supervisor_usage(&supervisor, &endUsage);
+    uint64_t endMicros = clk_monomicros();
+
+    supervisor_stop(&supervisor, SIGTERM);
+
+    char extra[64];
+
+    snprintf(extra, sizeof(extra),
+        " restarts=%u restarts_per_s=%.1f",
+        restarts, restarts * 1e6 / (endMicros - beginMicros));
+
+    report_usage("restart_loop", aSupervisor, extra,
+        endMicros - beginMicros, &beginUsage, &endUsage);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_relay(const char *aBench, const char *aSupervisor, char *aOption[])
+{
+    struct Supervisor supervisor;
+
+    char floodBytes[sizeof(BENCH_FLOOD_BYTES) * CHAR_BIT];
+
+    snprintf(floodBytes, sizeof(floodBytes), "%llu", BENCH_FLOOD_BYTES);
+
+    unsigned options = 0;
+
+    while (aOption[options])
+        ++options;
+
+    char *cmd[options + 6];
+
+    unsigned cmdLen = 0;
+
+    cmd[cmdLen++] = (char *) aSupervisor;
+
+    for (unsigned ix = 0; ix < options; ++ix)
+        cmd[cmdLen++] = aOption[ix];
+
+    cmd[cmdLen++] = "--";
+    cmd[cmdLen++] = (char *) ChildPath;
+    cmd[cmdLen++] = "flood";
+    cmd[cmdLen++] = floodBytes;
+    cmd[cmdLen]   = 0;
+
+    uint64_t startMicros;
+
+    if (supervisor_start(&supervisor, cmd, 0, -1, &startMicros))
+        die("Unable to start %s", aSupervisor);
+
+    if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                startMicros + BENCH_TIMEOUT_MICROS))
+        die("Unable to start %s", ChildPath);
+
+    /* Measure from the program starting to write until the supervisor
+     * terminates, which is after it has relayed all the output. */
+
+    uint64_t exitMicros;
+
+    if (1 != supervisor_read(&supervisor, "exit", &exitMicros,
+                startMicros + BENCH_TIMEOUT_MICROS))
+        die("Unable to flood %s", ChildPath);
+
+    if (supervisor_read(&supervisor, "exit", &exitMicros,
+            startMicros + BENCH_TIMEOUT_MICROS))
+        die("Unable to relay output of %s", ChildPath);
+
+    uint64_t endMicros = clk_monomicros();
+
+    supervisor_stop(&supervisor, 0);
+
+    printf("bench=%s supervisor=%s bytes=%llu seconds=%.3f mb_per_s=%.1f\n",
+        aBench, aSupervisor, BENCH_FLOOD_BYTES,
+        (endMicros - startMicros) / 1e6,
+        BENCH_FLOOD_BYTES / 1e6 * 1e6 / (endMicros - startMicros));
+
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_match(const char *aSupervisor)
+{
+    static const char *Pattern[] = {
+        "Listening on port",
+        "FATAL",
+        "out of file descriptors",
+        "panic:",
+        "Segmentation fault",
+        "Traceback",
+        "deadlock detected",
+        "READY=1",
+    };
+
+    static char scanBuf[BENCH_SCAN_BYTES];
+
+    struct Matcher matcher;
+
+    if (match_init(&matcher))
+        die("Unable to create matcher");
+
+    for (unsigned ix = 0; ix < NUMBEROF(Pattern); ++ix) {
+        if (-1 == match_add(&matcher, Pattern[ix]))
+            die("Unable to add pattern %s", Pattern[ix]);
+    }
+
+    if (match_compile(&matcher))
+        die("Unable to compile matcher");
+
+    /* Measure the throughput of the output matcher scanning log lines
+     * that contain none of the patterns, so that all of the output is
+     * scanned, but that contain prefixes of some. */
+
+    size_t scanLen = bench_lines(scanBuf, sizeof(scanBuf));
+
+    uint32_t matched   = 0;
+    uint64_t scanBytes = 0;
+
+    uint64_t beginMicros = clk_monomicros();
+    uint64_t endMicros;
+
+    do {
+        uint32_t matchState = 0;
+
+        matched |= match_scan(&matcher, &matchState, scanBuf, scanLen);
+        scanBytes += scanLen;
+
+        endMicros = clk_monomicros();
+
+    } while (endMicros - beginMicros < BENCH_SAMPLE_MICROS);
+
+    if (matched)
+        die("Unexpected match %#" PRIx32, matched);
+
+    match_close(&matcher);
+
+    printf("bench=match_scan patterns=%zu bytes=%" PRIu64
+           " seconds=%.3f mb_per_s=%.1f\n",
+        NUMBEROF(Pattern), scanBytes,
+        (endMicros - beginMicros) / 1e6,
+        scanBytes / 1e6 * 1e6 / (endMicros - beginMicros));
+
+    fflush(stdout);
+
+    /* Measure the same scan end to end, as the supervisor relays the
+     * output of a program. */
+
+    char *option[2 * NUMBEROF(Pattern) + 1];
+
+    char detect[NUMBEROF(Pattern)][64];
+
+    for (unsigned ix = 0; ix < NUMBEROF(Pattern); ++ix) {
+        snprintf(detect[ix], sizeof(detect[ix]), "fail:%s", Pattern[ix]);
+
+        option[2 * ix + 0] = "-D";
+        option[2 * ix + 1] = detect[ix];
+    }
+    option[2 * NUMBEROF(Pattern)] = 0;
+
+    bench_relay("relay_detect", aSupervisor, option);
+}
+
+/*----------------------------------------------------------------------------*/
+static size_t
+split_memchr(const char *aBuf, size_t aLen)
+{
+    size_t lines = 0;
+
+    const char *linePtr = aBuf;
+    const char *bufEnd  = aBuf + aLen;
+
+    while (linePtr != bufEnd) {
+        const char *lineEnd = memchr(linePtr, '\n', bufEnd - linePtr);
+
+        if (!lineEnd)
+            break;
+
+        linePtr = lineEnd + 1;
+        ++lines;
+    }
+
+    return lines;
+}
+
+/*----------------------------------------------------------------------------*/
+static size_t
+split_naive(const char *aBuf, size_t aLen)
+{
+    size_t lines = 0;
+
+    const char *linePtr = aBuf;
+    const char *bufEnd  = aBuf + aLen;
+
+    while (linePtr != bufEnd) {
+        const char *lineEnd = linePtr;
+
+        while (lineEnd != bufEnd && '\n' != *lineEnd)
+            ++lineEnd;
+
+        if (lineEnd == bufEnd)
+            break;
+
+        linePtr = lineEnd + 1;
+        ++lines;
+    }
+
+    return lines;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_label(const char *aSupervisor)
+{
+    static const struct {
+        const char *mName;
+        size_t    (*mSplit)(const char *aBuf, size_t aLen);
+    } Split[] = {
+        { "memchr", split_memchr },
+        { "naive",  split_naive },
+    };
+
+    static char splitBuf[BENCH_SCAN_BYTES];
+
+    size_t splitLen = bench_lines(splitBuf, sizeof(splitBuf));
+
+    /* Measure splitting log lines with memchr, as the supervisor does
+     * when labelling output, against a byte at a time loop. */
+
+    for (unsigned ix = 0; ix < NUMBEROF(Split); ++ix) {
+
+        size_t   lines      = 0;
+        uint64_t splitBytes = 0;
+
+        uint64_t beginMicros = clk_monomicros();
+        uint64_t endMicros;
+
+        do {
+            lines += Split[ix].mSplit(splitBuf, splitLen);
+            splitBytes += splitLen;
+
+            endMicros = clk_monomicros();
+
+        } while (endMicros - beginMicros < BENCH_SAMPLE_MICROS);
+
+        if (!lines)
+            die("Unable to split lines with %s", Split[ix].mName);
+
+        printf("bench=line_split split=%s lines=%zu bytes=%" PRIu64
+               " seconds=%.3f mb_per_s=%.1f\n",
+            Split[ix].mName, lines, splitBytes,
+            (endMicros - beginMicros) / 1e6,
+            splitBytes / 1e6 * 1e6 / (endMicros - beginMicros));
+
+        fflush(stdout);
+    }
+
+    /* Measure labelling end to end, as the supervisor relays the
+     * output of a program. */
+
+    char *option[] = { "-l", "mono", 0 };
+
+    bench_relay("relay_label", aSupervisor, option);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_stall(const char *aSupervisor)
+{
+    /* Measure output written directly by the program, and output
+     * relayed by the supervisor to bound the time between output. */
+
+    char *direct[] = { 0 };
+    char *stall[]  = { "-S", "10s", 0 };
+
+    bench_relay("relay_direct", aSupervisor, direct);
+    bench_relay("relay_stall",  aSupervisor, stall);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_batch(const char *aSupervisor)
+{
+    static const unsigned BatchJobs = 2000;
+    static const char     BatchParallel[] = "4";
+
+    char jobPath[] = "/tmp/bench.XXXXXX";
+
+    int jobFd = mkstemp(jobPath);
+    if (-1 == jobFd)
+        die("Unable to create job file");
+
+    FILE *jobFile = fdopen(jobFd, "w");
+    if (!jobFile)
+        die("Unable to open job file %s", jobPath);
+
+    for (unsigned ix = 0; ix < BatchJobs; ++ix)
+        fprintf(jobFile, "true\n");
+
+    if (fclose(jobFile))
+        die("Unable to write job file %s", jobPath);
+
+    /* Measure the rate at which jobs are run by one supervisor in
+     * batch mode, and by one supervisor for each job run by xargs. */
+
+    char xargsCmd[256];
+
+    snprintf(xargsCmd, sizeof(xargsCmd),
+        "xargs -P %s -n 1 %s 0 10s -- < %s",
+        BatchParallel, aSupervisor, jobPath);
+
+    char *batch[] = {
+        (char *) aSupervisor, "-b", jobPath, "-j", (char *) BatchParallel,
+        "0", "10s", 0 };
+
+    char *xargs[] = { "sh", "-c", xargsCmd, 0 };
+
+    const struct {
+        const char *mName;
+        char      **mCmd;
+    } Run[] = {
+        { "batch", batch },
+        { "xargs", xargs },
+    };
+
+    for (unsigned ix = 0; ix < NUMBEROF(Run); ++ix) {
+        struct Supervisor supervisor;
+
+        uint64_t beginMicros;
+
+        if (supervisor_start(&supervisor, Run[ix].mCmd, 0, -1, &beginMicros))
+            die("Unable to start %s", Run[ix].mCmd[0]);
+
+        supervisor_stop(&supervisor, 0);
+
+        uint64_t endMicros = clk_monomicros();
+
+        printf("bench=batch_jobs supervisor=%s runner=%s parallel=%s"
+               " jobs=%u seconds=%.3f jobs_per_s=%.1f\n",
+            aSupervisor, Run[ix].mName, BatchParallel, BatchJobs,
+            (endMicros - beginMicros) / 1e6,
+            BatchJobs * 1e6 / (endMicros - beginMicros));
+
+        fflush(stdout);
+    }
+
+    unlink(jobPath);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_period(const char *aSupervisor)
+{
+    static const unsigned PeriodRuns   = 100;
+    static const uint64_t PeriodMicros = 20 * 1000;
+
+    struct Supervisor supervisor;
+
+    char *cmd[] = {
+        (char *) aSupervisor, "-p", "20ms", "10s",
+        "--", (char *) ChildPath, "start", 0 };
+
+    if (supervisor_start(&supervisor, cmd, 0, -1, 0))
+        die("Unable to start %s", aSupervisor);
+
+    /* Measure the deviation of the start of each run from its schedule,
+     * taking the start of the first run as the epoch, so that the
+     * latency of each start is measured as well as any accumulated
+     * drift. */
+
+    uint64_t epochMicros = 0;
+    uint64_t sumMicros   = 0;
+    uint64_t maxMicros   = 0;
+    int64_t  lastMicros  = 0;
+
+    for (unsigned ix = 0; ix < PeriodRuns; ++ix) {
+        uint64_t startMicros;
+
+        if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                    clk_monomicros() + BENCH_TIMEOUT_MICROS))
+            die("Unable to start %s", ChildPath);
+
+        if (!ix)
+            epochMicros = startMicros;
+
+        lastMicros = startMicros - (epochMicros + ix * PeriodMicros);
+
+        uint64_t deviationMicros = 0 > lastMicros ? -lastMicros : lastMicros;
+
+        sumMicros += deviationMicros;
+        if (maxMicros < deviationMicros)
+            maxMicros = deviationMicros;
+    }
+
+    supervisor_stop(&supervisor, SIGTERM);
+
+    printf("bench=period_drift supervisor=%s period_us=%" PRIu64
+           " runs=%u mean_us=%.1f max_us=%" PRIu64 " drift_us=%" PRId64 "\n",
+        aSupervisor, PeriodMicros, PeriodRuns,
+        (double) sumMicros / PeriodRuns, maxMicros, lastMicros);
+
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint64_t
+pool_client(unsigned aPort, uint64_t aDeadlineMicros)
+{
+    struct sockaddr_in sockAddr;
+
+    memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.sin_family      = AF_INET;
+    sockAddr.sin_port        = htons(aPort);
+    sockAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /* Retry until the supervisor is listening, then make requests on
+     * the one connection until the deadline. */
+
+    int sockFd;
+
+    while (1) {
+        sockFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (-1 == sockFd)
+            die("Unable to create socket");
+
+        if (!connect(sockFd, (struct sockaddr *) &sockAddr, sizeof(sockAddr)))
+            break;
+
+        if (ECONNREFUSED != errno || clk_monomicros() >= aDeadlineMicros)
+            die("Unable to connect to port %u", aPort);
+
+        close(sockFd);
+        usleep(10 * 1000);
+    }
+
+    uint64_t requests = 0;
+
+    while (clk_monomicros() < aDeadlineMicros) {
+        char response;
+
+        if (1 != fd_write(sockFd, "?", 1) || 1 != read(sockFd, &response, 1))
+            die("Unable to make request to port %u", aPort);
+
+        ++requests;
+    }
+
+    close(sockFd);
+
+    return requests;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_pool(const char *aSupervisor)
+{
+    static const unsigned PoolClients = 16;
+
+    static const char *PoolReplicas[] = { "1", "4" };
+
+    unsigned poolPort = 20000 + getpid() % 20000;
+
+    for (unsigned ix = 0; ix < NUMBEROF(PoolReplicas); ++ix) {
+        struct Supervisor supervisor;
+
+        char listenAddr[64];
+
+        snprintf(listenAddr, sizeof(listenAddr),
+            "tcp:127.0.0.1:%u", poolPort + ix);
+
+        char *cmd[] = {
+            (char *) aSupervisor, "-R", (char *) PoolReplicas[ix],
+            "-L", listenAddr, "--", (char *) ChildPath, "serve", 0 };
+
+        if (supervisor_start(&supervisor, cmd, 0, -1, 0))
+            die("Unable to start %s", aSupervisor);
+
+        /* Each client makes requests on its own connection, so that
+         * the connections are distributed across the replicas, and
+         * reports the requests made through a pipe. */
+
+        int resultFd[2];
+
+        if (pipe(resultFd))
+            die("Unable to create pipe");
+
+        uint64_t beginMicros = clk_monomicros();
+        uint64_t endMicros   = beginMicros + BENCH_SAMPLE_MICROS;
+
+        pid_t clientPid[PoolClients];
+
+        for (unsigned client = 0; client < PoolClients; ++client) {
+            clientPid[client] = fork();
+
+            if (-1 == clientPid[client])
+                die("Unable to fork client");
+
+            if (!clientPid[client]) {
+                uint64_t requests = pool_client(poolPort + ix, endMicros);
+
+                if (sizeof(requests) != fd_write(
+                        resultFd[1], (char *) &requests, sizeof(requests)))
+                    die("Unable to report requests");
+
+                _exit(EXIT_SUCCESS);
+            }
+        }
+
+        close(resultFd[1]);
+
+        uint64_t requests = 0;
+
+        for (unsigned client = 0; client < PoolClients; ++client) {
+            uint64_t clientRequests;
+
+            if (sizeof(clientRequests) != read(
+                    resultFd[0], &clientRequests, sizeof(clientRequests)))
+                die("Unable to read requests");
+
+            requests += clientRequests;
+        }
+
+        close(resultFd[0]);
+
+        for (unsigned client = 0; client < PoolClients; ++client) {
+            while (-1 == waitpid(clientPid[client], 0, 0)) {
+                if (EINTR != errno)
+                    die("Unable to reap client %d", clientPid[client]);
+            }
+        }
+
+        supervisor_stop(&supervisor, SIGTERM);
+
+        printf("bench=pool_requests supervisor=%s replicas=%s clients=%u"
+               " requests=%" PRIu64 " seconds=%.3f requests_per_s=%.1f\n",
+            aSupervisor, PoolReplicas[ix], PoolClients, requests,
+            (clk_monomicros() - beginMicros) / 1e6,
+            requests * 1e6 / (endMicros - beginMicros));
+
+        fflush(stdout);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_chatty(const char *aSupervisor)
+{
+    struct Supervisor supervisor;
+
+    char chatChildren[sizeof(unsigned) * CHAR_BIT];
+    char chatRate[sizeof(unsigned) * CHAR_BIT];
+
+    snprintf(chatChildren, sizeof(chatChildren), "%u", BENCH_CHATTY_CHILDREN);
+    snprintf(chatRate, sizeof(chatRate), "%u", BENCH_CHATTY_RATE);
+
+    /* Each replica supervisor captures and labels the output of its
+     * own chatty child, and relays it to a pipe shared by all the
+     * replicas so that the aggregate throughput can be measured. */
+
+    int outputFd[2];
+
+    if (pipe(outputFd))
+        die("Unable to create pipe");
+
+    if (fd_cloexec(outputFd[0]))
+        die("Unable to configure pipe");
+
+    char *cmd[] = {
+        (char *) aSupervisor, "-R", chatChildren, "-l", "mono",
+        "--", (char *) ChildPath, "chat", chatRate, 0 };
+
+    if (supervisor_start(&supervisor, cmd, 0, outputFd[1], 0))
+        die("Unable to start %s", aSupervisor);
+
+    close(outputFd[1]);
+
+    uint64_t deadlineMicros = clk_monomicros() + BENCH_TIMEOUT_MICROS;
+
+    for (unsigned ix = 0; ix < BENCH_CHATTY_CHILDREN; ++ix) {
+        uint64_t startMicros;
+
+        if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                    deadlineMicros))
+            die("Unable to start %s", ChildPath);
+    }
+
+    /* Measure the output relayed, and the time used by all the
+     * supervisors, over the sample period once every child is running. */
+
+    static char outputBuf[64 * 1024];
+
+    struct SupervisorUsage beginUsage = { 0 };
+    struct SupervisorUsage endUsage   = { 0 };
+
+    uint64_t beginMicros = clk_monomicros();
+    uint64_t endMicros   = beginMicros + BENCH_SAMPLE_MICROS;
+
+    unsigned supervisors = pool_usage(supervisor.mPid, &beginUsage);
+
+    uint64_t outputBytes = 0;
+    uint64_t outputLines = 0;
+
+    while (1) {
+        int ready = wait_readable(endMicros, outputFd[0]);
+
+        if (-1 == ready)
+            die("Unable to wait for output");
+
+        if (!ready)
+            break;
+
+        ssize_t readLen = read(outputFd[0], outputBuf, sizeof(outputBuf));
+
+        if (-1 == readLen) {
+            if (EINTR == errno)
+                continue;
+            die("Unable to read output");
+        }
+
+        if (!readLen)
+            die("Unable to relay output of %s", ChildPath);
+
+        outputBytes += readLen;
+
+        for (const char *linePtr = outputBuf;
+                (linePtr = memchr(
+                    linePtr, '\n', outputBuf + readLen - linePtr));
+                ++linePtr)
+            ++outputLines;
+    }
+
+    uint64_t elapsedMicros = clk_monomicros() - beginMicros;
+
+    pool_usage(supervisor.mPid, &endUsage);
+
+    /* Continue to drain the output while the pool stops, so that no
+     * supervisor blocks writing to the pipe. */
+
+    kill(supervisor.mPid, SIGTERM);
+
+    while (1) {
+        ssize_t readLen = read(outputFd[0], outputBuf, sizeof(outputBuf));
+
+        if (-1 == readLen) {
+            if (EINTR == errno)
+                continue;
+            die("Unable to read output");
+        }
+
+        if (!readLen)
+            break;
+    }
+
+    close(outputFd[0]);
+
+    supervisor_stop(&supervisor, 0);
+
+    uint64_t cpuMicros = endUsage.mCpuMicros - beginUsage.mCpuMicros;
+
+    printf("bench=chatty_relay supervisor=%s children=%u supervisors=%u"
+           " lines_per_s=%.1f mb_per_s=%.3f seconds=%.3f"
+           " cpu_pct=%.2f rss_kib=%" PRIu64 "\n",
+        aSupervisor, BENCH_CHATTY_CHILDREN, supervisors,
+        outputLines * 1e6 / elapsedMicros,
+        outputBytes / 1e6 * 1e6 / elapsedMicros,
+        elapsedMicros / 1e6,
+        100.0 * cpuMicros / elapsedMicros,
+        endUsage.mRssKib);
+
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+bench_tree(const char *aSupervisor)
+{
+    static const char     TreeDepth[]     = "100";
+    static const char     TreeBound[]     = "200ms";
+    static const uint64_t TreeBoundMicros = 200 * 1000;
+
+    static const char *TreeMode[] = { "-g", "-c" };
+
+    for (unsigned ix = 0; ix < NUMBEROF(TreeMode); ++ix) {
+        struct Supervisor supervisor;
+
+        char *cmd[] = {
+            (char *) aSupervisor, (char *) TreeMode[ix],
+            "0", (char *) TreeBound,
+            "--", (char *) ChildPath, "tree", (char *) TreeDepth, 0 };
+
+        if (supervisor_start(&supervisor, cmd, 1, -1, 0))
+            die("Unable to start %s", aSupervisor);
+
+        /* Measure from the expiry of the bound, taken from the start
+         * of the root of the tree, until the last process in the tree
+         * has terminated. A cgroup cannot be created by every user, so
+         * report the mode as unavailable rather than failing. */
+
+        uint64_t startMicros;
+        uint64_t readyMicros;
+
+        if (1 != supervisor_read(&supervisor, "start", &startMicros,
+                    clk_monomicros() + BENCH_TIMEOUT_MICROS)) {
+
+            supervisor_stop(&supervisor, 0);
+
+            printf("bench=tree_bound supervisor=%s mode=%s available=0\n",
+                aSupervisor, TreeMode[ix]);
+
+            fflush(stdout);
+            continue;
+        }
+
+        if (1 != supervisor_read(&supervisor, "ready", &readyMicros,
+                    startMicros + BENCH_TIMEOUT_MICROS))
+            die("Unable to fork tree of %s", ChildPath);
+
+        if (supervisor_read(&supervisor, "ready", &readyMicros,
+                startMicros + BENCH_TIMEOUT_MICROS))
+            die("Unable to bound tree of %s", ChildPath);
+
+        uint64_t endMicros = clk_monomicros();
+
+        supervisor_stop(&supervisor, 0);
+
+        printf("bench=tree_bound supervisor=%s mode=%s depth=%s"
+               " bound_ms=%.1f fork_ms=%.1f stop_ms=%.1f\n",
+            aSupervisor, TreeMode[ix], TreeDepth, TreeBoundMicros / 1e3,
+            (readyMicros - startMicros) / 1e3,
+            ((int64_t) (endMicros - startMicros - TreeBoundMicros)) / 1e3);
+
+        fflush(stdout);
+    }
+}
+
+/******************************************************************************/
+static const struct {
+    const char *mName;
+    void      (*mBench)(const char *aSupervisor);
+    const char *mSupervisor;
+} Bench[] = {
+    { "spawn_exec",     bench_spawn,   "./timebound" },
+    { "spawn_exec",     bench_spawn,   "./respawn" },
+    { "crash_respawn",  bench_crash,   "./respawn" },
+    { "signal_forward", bench_signal,  "./timebound" },
+    { "signal_forward", bench_signal,  "./respawn" },
+    { "idle",           bench_idle,    "./respawn" },
+    { "restart_loop",   bench_restart, "./respawn" },
+    { "match_scan",     bench_match,   "./respawn" },
+    { "line_split",     bench_label,   "./respawn" },
+    { "relay_stall",    bench_stall,   "./timebound" },
+    { "batch_jobs",     bench_batch,   "./timebound" },
+    { "period_drift",   bench_period,  "./timebound" },
+    { "pool_requests",  bench_pool,    "./respawn" },
+    { "chatty_relay",   bench_chatty,  "./respawn" },
+    { "tree_bound",     bench_tree,    "./timebound" },
+};
+
+/*----------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+    /* Run all the benchmarks, or only those that are named. */
+
+    for (int arg = 1; arg < argc; ++arg) {
+        unsigned ix;
+
+        for (ix = 0; ix < NUMBEROF(Bench); ++ix) {
+            if (!strcmp(argv[arg], Bench[ix].mName))
+                break;
+        }
+
+        if (NUMBEROF(Bench) == ix)
+            die("usage: bench [name ...]");
+    }
+
+    /* Do not let a broken pipe end the benchmarks. */
+
+    signal(SIGPIPE, SIG_IGN);
+
+    for (unsigned ix = 0; ix < NUMBEROF(Bench); ++ix) {
+        int selected = 1 == argc;
+
+        for (int arg = 1; !selected && arg < argc; ++arg)
+            selected = !strcmp(argv[arg], Bench[ix].mName);
+
+        if (selected)
+            Bench[ix].mBench(Bench[ix].mSupervisor);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,289 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "clk.h"
+#include "err.h"
+#include "fd.h"
+#include "macros.h"
+
+#include "lines.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+
+/* A purpose built child process for the benchmarks. Each event is
+ * reported to the benchmark driver as a line on the descriptor named
+ * by BENCH_FD, stamped with the monotonic clock that is shared by all
+ * processes. Lines shorter than PIPE_BUF are written atomically. */
+
+static int StampFd = -1;
+
+/******************************************************************************/
+static void
+stamp(const char *aEvent)
+{
+    char stampLine[64];
+
+    int stampLen = snprintf(stampLine, sizeof(stampLine),
+        "%s %" PRIu64 "\n", aEvent, clk_monomicros());
+
+    if (stampLen != fd_write(StampFd, stampLine, stampLen))
+        die("Unable to report %s", aEvent);
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    const char *stampEnv = getenv("BENCH_FD");
+
+    if (argc < 2 || !stampEnv)
+        die("usage: BENCH_FD=fd child start|crash|restart|signal|idle|flood|chat|serve|tree");
+
+    StampFd = atoi(stampEnv);
+
+    const char *mode = argv[1];
+
+    if (!strcmp("start", mode)) {
+
+        /* Start and exit successfully, to measure the latency from
+         * spawning the supervisor to the program running. */
+
+        stamp("start");
+
+    } else if (!strcmp("crash", mode)) {
+
+        /* Fail immediately, to measure the latency from the failure
+         * to the next instance running. */
+
+        stamp("start");
+        stamp("exit");
+        return EXIT_FAILURE;
+
+    } else if (!strcmp("restart", mode)) {
+
+        /* Request a restart through the output, and wait to be
+         * stopped, to measure a sustained restart loop. */
+
+        stamp("start");
+
+        if (EOF == puts("RESTART") || fflush(stdout))
+            die("Unable to request restart");
+
+        while (1)
+            pause();
+
+    } else if (!strcmp("signal", mode)) {
+
+        /* Report each SIGHUP forwarded by the supervisor. Accept the
+         * signal synchronously so that the report is not made from a
+         * signal handler. */
+
+        sigset_t sigSet;
+
+        sigemptyset(&sigSet);
+        sigaddset(&sigSet, SIGHUP);
+
+        if (sigprocmask(SIG_BLOCK, &sigSet, 0))
+            die("Unable to block SIGHUP");
+
+        stamp("start");
+
+        while (1) {
+            int sigNum;
+
+            if (sigwait(&sigSet, &sigNum))
+                die("Unable to wait for SIGHUP");
+
+            stamp("signal");
+        }
+
+    } else if (!strcmp("flood", mode)) {
+
+        /* Write the named number of bytes of log lines as quickly as
+         * possible, to measure the throughput of output relayed by the
+         * supervisor. */
+
+        if (argc != 3)
+            die("usage: child flood bytes");
+
+        unsigned long floodBytes = strtoul(argv[2], 0, 10);
+
+        static char floodBuf[64 * 1024];
+
+        size_t floodLen = bench_lines(floodBuf, sizeof(floodBuf));
+
+        stamp("start");
+
+        while (floodBytes) {
+            size_t writeLen =
+                floodBytes < floodLen ? floodBytes : floodLen;
+
+            if (writeLen != fd_write(STDOUT_FILENO, floodBuf, writeLen))
+                die("Unable to write output");
+
+            floodBytes -= writeLen;
+        }
+
+        stamp("exit");
+
+    } else if (!strcmp("chat", mode)) {
+
+        /* Write one log line at a time at the named rate, as one of
+         * many chatty services, to measure the aggregate throughput of
+         * output relayed by many supervisors. */
+
+        if (argc != 3)
+            die("usage: child chat lines_per_second");
+
+        unsigned long chatRate = strtoul(argv[2], 0, 10);
+
+        if (!chatRate)
+            die("Invalid chat rate %s", argv[2]);
+
+        static char chatBuf[64 * 1024];
+
+        size_t chatLen = bench_lines(chatBuf, sizeof(chatBuf));
+
+        const char *linePtr = chatBuf;
+
+        uint64_t periodMicros = 1000000 / chatRate;
+        uint64_t lineMicros   = clk_monomicros();
+
+        stamp("start");
+
+        while (1) {
+            const char *lineEnd = memchr(
+                linePtr, '\n', chatBuf + chatLen - linePtr);
+
+            size_t lineLen = lineEnd + 1 - linePtr;
+
+            if (lineLen != fd_write(STDOUT_FILENO, linePtr, lineLen))
+                die("Unable to write output");
+
+            linePtr = lineEnd + 1;
+            if (linePtr == chatBuf + chatLen)
+                linePtr = chatBuf;
+
+            lineMicros += periodMicros;
+            clk_sleepuntil(lineMicros);
+        }
+
+    } else if (!strcmp("serve", mode)) {
+
+        /* Answer each byte received on each connection accepted from
+         * the listening socket with one byte, to measure the requests
+         * served by a pool of replicas. */
+
+        const char *listenEnv = getenv("RESPAWN_LISTEN");
+
+        if (!listenEnv)
+            die("usage: RESPAWN_LISTEN=fd child serve");
+
+        struct pollfd pollFd[64];
+
+        unsigned pollFds = 0;
+
+        pollFd[pollFds].fd     = atoi(listenEnv);
+        pollFd[pollFds].events = POLLIN;
+        ++pollFds;
+
+        stamp("start");
+
+        while (1) {
+            if (-1 == poll(pollFd, pollFds, -1)) {
+                if (EINTR == errno)
+                    continue;
+                die("Unable to poll connections");
+            }
+
+            for (unsigned ix = pollFds; ix-- > 1; ) {
+                if (!pollFd[ix].revents)
+                    continue;
+
+                char request;
+
+                ssize_t readLen = read(pollFd[ix].fd, &request, 1);
+
+                if (1 == readLen && 1 == fd_write(pollFd[ix].fd, "+", 1))
+                    continue;
+
+                close(pollFd[ix].fd);
+                pollFd[ix] = pollFd[--pollFds];
+            }
+
+            if (pollFd[0].revents && NUMBEROF(pollFd) != pollFds) {
+                int connFd = accept(pollFd[0].fd, 0, 0);
+
+                if (-1 != connFd) {
+                    pollFd[pollFds].fd     = connFd;
+                    pollFd[pollFds].events = POLLIN;
+                    ++pollFds;
+                }
+            }
+        }
+
+    } else if (!strcmp("tree", mode)) {
+
+        /* Fork a chain of descendants of the named depth, each of which
+         * waits to be stopped, to measure the time to stop the whole
+         * tree. Every process holds the report descriptor, so the end
+         * of the reports is seen once the tree is empty. */
+
+        if (argc != 3)
+            die("usage: child tree depth");
+
+        unsigned long treeDepth = strtoul(argv[2], 0, 10);
+
+        stamp("start");
+
+        while (treeDepth--) {
+            pid_t treePid = fork();
+
+            if (-1 == treePid)
+                die("Unable to fork tree");
+
+            if (treePid)
+                break;
+
+            if (!treeDepth)
+                stamp("ready");
+        }
+
+        while (1)
+            pause();
+
+    } else if (!strcmp("idle", mode)) {
+
+        stamp("start");
+
+        while (1)
+            pause();
+
+    } else {
+        die("Unknown mode %s", mode);
+    }
+
+    return EXIT_SUCCESS;
+}
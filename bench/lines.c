@@ -0,0 +1,63 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lines.h"
+
+#include "macros.h"
+
+#include <string.h>
+
+/******************************************************************************/
+size_t
+bench_lines(char *aBuf, size_t aLen)
+{
+    static const char *Line[] = {
+        "2026-10-18T12:00:00.118Z INFO  request id=4821 method=GET"
+            " path=/api/v1/items status=200 latency_ms=3\n",
+        "2026-10-18T12:00:00.121Z DEBUG cache lookup key=items:4821"
+            " hit=1 entries=18231 evictions=12\n",
+        "2026-10-18T12:00:00.127Z INFO  Listening on socket"
+            " /run/app/app.sock backlog=128\n",
+        "2026-10-18T12:00:00.134Z WARN  retrying connection to db-1:5432"
+            " attempt=2 backoff_ms=250\n",
+        "2026-10-18T12:00:00.139Z INFO  request id=4822 method=POST"
+            " path=/api/v1/orders status=201 latency_ms=17\n",
+        "2026-10-18T12:00:00.146Z ERROR upstream timed out after 5000ms"
+            " upstream=pricing-2 retries=3\n",
+        "2026-10-18T12:00:00.152Z INFO  worker pool resized from 8 to 12"
+            " queue_depth=311 pending=4\n",
+        "2026-10-18T12:00:00.160Z DEBUG gc pause_us=412 heap_mb=812"
+            " freed_mb=96 fragmentation=0.07\n",
+    };
+
+    /* Fill the buffer with whole lines, and return the length used. */
+
+    size_t bufLen = 0;
+
+    for (unsigned ix = 0; ; ++ix) {
+        const char *line = Line[ix % NUMBEROF(Line)];
+
+        size_t lineLen = strlen(line);
+
+        if (lineLen > aLen - bufLen)
+            break;
+
+        memcpy(aBuf + bufLen, line, lineLen);
+        bufLen += lineLen;
+    }
+
+    return bufLen;
+}
@@ -0,0 +1,399 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "sim.h"
+
+#include "clk.h"
+#include "err.h"
+#include "proc.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/wait.h>
+
+/* Run the restart and escalation policies against scripted process
+ * lifetimes in virtual time. Virtual time only advances when a policy
+ * sleeps or waits, so each trace completes at once. The traces are
+ * generated from a seeded generator, and the backoff of each trace is
+ * drawn from its own seed, so that every trace is repeatable and can
+ * be replayed by the reference model. */
+
+#define SIM_PID_BASE 1000
+#define SIM_SEED     1
+#define SIM_SPINS    1000
+
+static uint64_t SimNanos;
+static uint64_t SimEpochNanos;
+
+static const struct SimScript *SimScript_;
+static unsigned                SimScripts_;
+
+static struct SimProcess SimProcess_[SIM_PROCESSES];
+static unsigned          SimProcesses_;
+
+static unsigned SimSpins_;
+
+static unsigned SimRandom_ = SIM_SEED;
+
+/******************************************************************************/
+static void
+sim_fail_(const char *aReason, pid_t aPid)
+{
+    clk_source(0);
+    proc_source(0);
+
+    errno = 0;
+    die("Simulation %s process %d at %" PRIu64 "ms",
+        aReason, (int) aPid, sim_millis());
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_advance_(uint64_t aMillis)
+{
+    uint64_t nanos = SimEpochNanos + aMillis * 1000000;
+
+    if (nanos > SimNanos)
+        SimNanos = nanos;
+}
+
+/*----------------------------------------------------------------------------*/
+static struct SimProcess *
+sim_find_(pid_t aPid)
+{
+    unsigned ix = aPid - SIM_PID_BASE;
+
+    return ix < SimProcesses_ ? &SimProcess_[ix] : 0;
+}
+
+/******************************************************************************/
+static uint64_t
+sim_nanos_(clockid_t aClock)
+{
+    /* All the clocks advance together in virtual time. */
+
+    return SimNanos;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_sleepuntil_(uint64_t aMonoMicros)
+{
+    uint64_t nowMicros = clk_monomicros();
+
+    if (aMonoMicros > nowMicros)
+        SimNanos += (aMonoMicros - nowMicros) * 1000;
+}
+
+static const struct ClkSource SimClock = {
+    .mNanos      = sim_nanos_,
+    .mSleepUntil = sim_sleepuntil_,
+};
+
+/******************************************************************************/
+static pid_t
+sim_execute_(char **aCmd, int (*aPrepare)(void *aArg), void *aArg)
+{
+    /* Each process follows the next step of the script, and the last
+     * step is repeated. The preparation is not run because it would
+     * modify the simulation itself. */
+
+    if (SIM_PROCESSES == SimProcesses_) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    const struct SimScript *step = sim_script(SimProcesses_);
+
+    struct SimProcess *process = &SimProcess_[SimProcesses_];
+
+    memset(process, 0, sizeof(*process));
+
+    process->mPid         = SIM_PID_BASE + SimProcesses_;
+    process->mSpawnMillis = sim_millis();
+    process->mExit        = step->mExit;
+    process->mExitMillis  = SIM_FOREVER == step->mRunMillis
+        ? SIM_FOREVER : process->mSpawnMillis + step->mRunMillis;
+
+    ++SimProcesses_;
+
+    return process->mPid;
+}
+
+/*----------------------------------------------------------------------------*/
+static pid_t
+sim_wait_(pid_t aPid, int *aStatus, int aOptions, struct rusage *aUsage)
+{
+    while (1) {
+
+        struct SimProcess *nextProcess = 0;
+
+        for (unsigned ix = 0; ix < SimProcesses_; ++ix) {
+            struct SimProcess *process = &SimProcess_[ix];
+
+            if (process->mReaped || (-1 != aPid && aPid != process->mPid))
+                continue;
+
+            if (process->mExitMillis <= sim_millis()) {
+
+                /* Encode the status as wait(2) does. */
+
+                if (aStatus)
+                    *aStatus = 0x100 <= process->mExit
+                        ? (process->mExit - 0x100) & 0x7f
+                        : (process->mExit & 0xff) << 8;
+
+                if (aUsage)
+                    memset(aUsage, 0, sizeof(*aUsage));
+
+                process->mReaped = 1;
+
+                return process->mPid;
+            }
+
+            if (!nextProcess ||
+                    process->mExitMillis < nextProcess->mExitMillis)
+                nextProcess = process;
+        }
+
+        if (!nextProcess) {
+            errno = ECHILD;
+            return -1;
+        }
+
+        if (aOptions & WNOHANG)
+            return 0;
+
+        if (SIM_FOREVER == nextProcess->mExitMillis)
+            sim_fail_("waits forever for", nextProcess->mPid);
+
+        sim_advance_(nextProcess->mExitMillis);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+sim_kill_(pid_t aPid, int aSignal)
+{
+    struct SimProcess *process = sim_find_(0 > aPid ? -aPid : aPid);
+
+    if (!process || process->mReaped) {
+        errno = ESRCH;
+        return -1;
+    }
+
+    if (!aSignal || process->mExitMillis <= sim_millis())
+        return 0;
+
+    if (SIM_SIGNALS > process->mSignals) {
+        process->mSignal[process->mSignals]       = aSignal;
+        process->mSignalMillis[process->mSignals] = sim_millis();
+        ++process->mSignals;
+    }
+
+    const struct SimScript *step = sim_script(process - SimProcess_);
+
+    if (sim_terminates(aSignal, step->mIgnore)) {
+        process->mExitMillis = sim_millis();
+        process->mExit       = 0x100 + aSignal;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+sim_monitor_wait_(
+    int aMonitorFd, int aTimeoutMillis, struct ProcMonitorEvent *aEvent)
+{
+    aEvent->mParentPid = 0;
+    aEvent->mFds       = 0;
+
+    /* Advance to the timeout, or the next process that terminates,
+     * whichever is first. */
+
+    uint64_t nowMillis = sim_millis();
+
+    uint64_t untilMillis =
+        0 <= aTimeoutMillis ? nowMillis + aTimeoutMillis : SIM_FOREVER;
+
+    for (unsigned ix = 0; ix < SimProcesses_; ++ix) {
+        const struct SimProcess *process = &SimProcess_[ix];
+
+        if (!process->mReaped &&
+                process->mExitMillis > nowMillis &&
+                process->mExitMillis < untilMillis)
+            untilMillis = process->mExitMillis;
+    }
+
+    if (SIM_FOREVER == untilMillis)
+        sim_fail_("cannot advance waiting for", 0);
+
+    /* A policy that repeatedly waits without time advancing is spinning
+     * because it woke before its deadline. */
+
+    if (untilMillis != nowMillis)
+        SimSpins_ = 0;
+    else if (SIM_SPINS == ++SimSpins_)
+        sim_fail_("spins waiting for", 0);
+
+    sim_advance_(untilMillis);
+
+    return 0;
+}
+
+static const struct ProcSource SimProc = {
+    .mExecute     = sim_execute_,
+    .mWait        = sim_wait_,
+    .mKill        = sim_kill_,
+    .mMonitorWait = sim_monitor_wait_,
+};
+
+/******************************************************************************/
+void
+sim_start(const struct SimScript *aScript, unsigned aScripts, unsigned aSeed)
+{
+    SimScript_  = aScript;
+    SimScripts_ = aScripts;
+
+    SimProcesses_ = 0;
+    SimSpins_     = 0;
+
+    /* Start the virtual clocks away from zero, because the clocks
+     * measured from program initialisation must be rebased from a
+     * non-zero reading. */
+
+    SimNanos      = 1000000000;
+    SimEpochNanos = SimNanos;
+
+    srand(aSeed);
+
+    clk_source(&SimClock);
+    proc_source(&SimProc);
+}
+
+/*----------------------------------------------------------------------------*/
+void
+sim_stop(void)
+{
+    clk_source(0);
+    proc_source(0);
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+sim_millis(void)
+{
+    return (SimNanos - SimEpochNanos) / 1000000;
+}
+
+/*----------------------------------------------------------------------------*/
+unsigned
+sim_processes(void)
+{
+    return SimProcesses_;
+}
+
+/*----------------------------------------------------------------------------*/
+const struct SimProcess *
+sim_process(unsigned aIndex)
+{
+    if (aIndex >= SimProcesses_)
+        die("Simulation has no process %u", aIndex);
+
+    return &SimProcess_[aIndex];
+}
+
+/*----------------------------------------------------------------------------*/
+const struct SimScript *
+sim_script(unsigned aIndex)
+{
+    return &SimScript_[aIndex < SimScripts_ ? aIndex : SimScripts_ - 1];
+}
+
+/*----------------------------------------------------------------------------*/
+unsigned
+sim_random(unsigned aRange)
+{
+    /* The traces are generated from a stream that is separate from
+     * rand(3), which is reserved for the policies. */
+
+    return rand_r(&SimRandom_) % aRange;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+sim_terminates(int aSignal, int aIgnore)
+{
+    if (SIGKILL == aSignal)
+        return 1;
+
+    if (aIgnore == aSignal)
+        return 0;
+
+    switch (aSignal) {
+    case SIGCHLD:
+    case SIGCONT:
+    case SIGURG:
+    case SIGWINCH:
+    case SIGSTOP:
+    case SIGTSTP:
+    case SIGTTIN:
+    case SIGTTOU:
+        return 0;
+    }
+
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+sim_expect(const char *aName, unsigned aTrace, const char *aWhat,
+           uint64_t aActual, uint64_t aExpected)
+{
+    if (aActual != aExpected) {
+        errno = 0;
+        die("Simulation %s trace %u %s %" PRId64 " expected %" PRId64,
+            aName, aTrace, aWhat, (int64_t) aActual, (int64_t) aExpected);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+sim_report(const char *aName, unsigned aTraces,
+           unsigned aProcesses, unsigned aSignals, uint64_t aMillis)
+{
+    printf("sim=%s traces=%u processes=%u signals=%u virtual_s=%.3f\n",
+        aName, aTraces, aProcesses, aSignals, aMillis / 1e3);
+
+    fflush(stdout);
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    sim_respawn();
+    sim_timebound();
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef SIM_H_
+#define SIM_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+/* A simulation replaces the clocks and the process primitives with
+ * scripted fakes, so that the restart and escalation policies run in
+ * virtual time against synthetic process lifetimes. Each policy is
+ * driven through thousands of seeded random traces, and its decisions
+ * are checked against a reference model of the policy. */
+
+#define SIM_FOREVER   UINT64_MAX
+#define SIM_PROCESSES 64
+#define SIM_SIGNALS   8
+#define SIM_TRACES    5000
+
+/* A trace that reaches the limit on processes or signals is stopped,
+ * and reports that it was exhausted instead of an exit status. */
+
+#define SIM_EXHAUSTED (-2)
+
+struct SimScript {
+    uint64_t mRunMillis;
+    int      mExit;
+    int      mIgnore;
+    int      mFault;
+    int      mPlanned;
+};
+
+struct SimProcess {
+    pid_t    mPid;
+    uint64_t mSpawnMillis;
+    uint64_t mExitMillis;
+    int      mExit;
+    int      mReaped;
+    unsigned mSignals;
+    int      mSignal[SIM_SIGNALS];
+    uint64_t mSignalMillis[SIM_SIGNALS];
+};
+
+void sim_start(const struct SimScript *aScript, unsigned aScripts,
+               unsigned aSeed);
+void sim_stop(void);
+
+uint64_t sim_millis(void);
+unsigned sim_processes(void);
+const struct SimProcess *sim_process(unsigned aIndex);
+const struct SimScript *sim_script(unsigned aIndex);
+
+unsigned sim_random(unsigned aRange);
+int sim_terminates(int aSignal, int aIgnore);
+
+void sim_expect(const char *aName, unsigned aTrace, const char *aWhat,
+                uint64_t aActual, uint64_t aExpected);
+void sim_report(const char *aName, unsigned aTraces,
+                unsigned aProcesses, unsigned aSignals, uint64_t aMillis);
+
+void sim_respawn(void);
+void sim_timebound(void);
+
+#endif
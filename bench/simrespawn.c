@@ -0,0 +1,335 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "sim.h"
+
+#include "clk.h"
+#include "err.h"
+#include "proc.h"
+#include "restart.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/wait.h>
+
+/* Drive the restart policy as respawn does, and compare the restarts,
+ * the delay before each restart, and the decision to stop, with a
+ * reference model that states the policy in terms of the number of
+ * consecutive failures to initialise. */
+
+#define SIM_RESPAWN_STEPS 12
+
+struct SimRespawnTrace {
+    struct SimScript mScript[SIM_RESPAWN_STEPS];
+    unsigned         mScripts;
+    int              mForever;
+    unsigned char    mExit[256];
+    unsigned         mSeed;
+};
+
+struct SimRespawnOutcome {
+    int      mExit;
+    unsigned mProcesses;
+    uint64_t mSpawnMillis[SIM_PROCESSES];
+    uint64_t mMillis;
+};
+
+/******************************************************************************/
+static int
+sim_respawn_(const struct RestartPolicy *aPolicy)
+{
+    static char *cmd[] = { "sim", 0 };
+
+    struct RestartBackoff backoff;
+
+    memset(&backoff, 0, sizeof(backoff));
+
+    restart_reset(&backoff, clk_bootmillis());
+
+    while (1) {
+
+        pid_t pid = proc_execute(cmd, 0, 0);
+        if (-1 == pid)
+            return SIM_EXHAUSTED;
+
+        ++backoff.mAttempt;
+
+        int status;
+
+        if (pid != proc_wait(pid, &status, 0, 0))
+            die("Unable to wait for process %d", (int) pid);
+
+        uint64_t endMillis = clk_bootmillis();
+
+        int exitCode = WIFSIGNALED(status)
+            ? 0x100 + WTERMSIG(status) : WEXITSTATUS(status);
+
+        const struct SimScript *step = sim_script(sim_processes() - 1);
+
+        if (step->mPlanned) {
+            restart_reset(&backoff, endMillis);
+            continue;
+        }
+
+        if (!restart_wanted(aPolicy, exitCode, step->mFault))
+            return exitCode;
+
+        if (restart_backoff(&backoff, endMillis))
+            return -1;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_respawn_model_(const struct SimRespawnTrace *aTrace,
+                   struct SimRespawnOutcome *aOutcome)
+{
+    /* A run of consecutive failures to initialise draws each delay from
+     * a window that grows from 2s to 62s, and the window is reset by a
+     * failure to start or by a long run. */
+
+    static const unsigned WindowSeconds[] = { 2, 6, 14, 30, 62 };
+
+    srand(aTrace->mSeed);
+
+    uint64_t nowMillis    = 0;
+    uint64_t windowMillis = 0;
+    unsigned attempts     = 0;
+    unsigned failures     = 0;
+
+    aOutcome->mProcesses = 0;
+
+    while (1) {
+
+        if (SIM_PROCESSES == aOutcome->mProcesses) {
+            aOutcome->mExit = SIM_EXHAUSTED;
+            break;
+        }
+
+        unsigned stepIx = aOutcome->mProcesses < aTrace->mScripts
+            ? aOutcome->mProcesses : aTrace->mScripts - 1;
+
+        const struct SimScript *step = &aTrace->mScript[stepIx];
+
+        aOutcome->mSpawnMillis[aOutcome->mProcesses++] = nowMillis;
+        ++attempts;
+
+        nowMillis += step->mRunMillis;
+
+        if (step->mPlanned) {
+            windowMillis = nowMillis;
+            attempts     = 0;
+            continue;
+        }
+
+        int succeeded = 0x100 <= step->mExit || aTrace->mExit[step->mExit];
+
+        if (succeeded && !aTrace->mForever && !step->mFault) {
+            aOutcome->mExit = step->mExit;
+            break;
+        }
+
+        uint64_t ranMillis = nowMillis - windowMillis;
+
+        if (1000 >= ranMillis) {
+            failures = 0;
+
+            if (10 <= attempts) {
+                aOutcome->mExit = -1;
+                break;
+            }
+
+            nowMillis += 1;
+            continue;
+        }
+
+        windowMillis = nowMillis;
+        attempts     = 0;
+
+        if (60000 < ranMillis)
+            failures = 0;
+        else {
+            ++failures;
+
+            unsigned windowIx = failures < NUMBEROF(WindowSeconds)
+                ? failures - 1 : NUMBEROF(WindowSeconds) - 1;
+
+            nowMillis += rand() % WindowSeconds[windowIx] * 1000;
+        }
+    }
+
+    aOutcome->mMillis = nowMillis;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_respawn_trace_(struct SimRespawnTrace *aTrace, unsigned aSeed)
+{
+    /* Favour run durations at the boundaries of the classification,
+     * and mix exits that succeed, fail, and are due to signals. */
+
+    static const uint64_t RunMillis[] = {
+        0, 1, 999, 1000, 1001, 30000, 59999, 60000, 60001, 120000,
+    };
+
+    static const int Signal[] = { SIGTERM, SIGKILL, SIGSEGV };
+
+    memset(aTrace, 0, sizeof(*aTrace));
+
+    aTrace->mSeed    = aSeed;
+    aTrace->mForever = !sim_random(5);
+
+    for (unsigned ix = 0; ix < 4; ++ix)
+        aTrace->mExit[ix] = !sim_random(2);
+
+    aTrace->mScripts = 1 + sim_random(SIM_RESPAWN_STEPS);
+
+    for (unsigned ix = 0; ix < aTrace->mScripts; ++ix) {
+        struct SimScript *step = &aTrace->mScript[ix];
+
+        step->mRunMillis = sim_random(2)
+            ? RunMillis[sim_random(NUMBEROF(RunMillis))]
+            : sim_random(90000);
+
+        step->mExit = sim_random(4)
+            ? sim_random(4) : 0x100 + Signal[sim_random(NUMBEROF(Signal))];
+
+        step->mFault   = !sim_random(8);
+        step->mPlanned = !sim_random(10);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_respawn_check_(const char *aName, unsigned aTraceNo,
+                   const struct SimRespawnTrace *aTrace,
+                   struct SimRespawnOutcome *aOutcome)
+{
+    struct RestartPolicy policy = {
+        .mForever = aTrace->mForever,
+        .mExit    = aTrace->mExit,
+        .mExits   = NUMBEROF(aTrace->mExit),
+    };
+
+    sim_start(aTrace->mScript, aTrace->mScripts, aTrace->mSeed);
+
+    int exitCode = sim_respawn_(&policy);
+
+    sim_stop();
+
+    sim_respawn_model_(aTrace, aOutcome);
+
+    sim_expect(aName, aTraceNo, "exit", exitCode, aOutcome->mExit);
+    sim_expect(aName, aTraceNo, "processes",
+        sim_processes(), aOutcome->mProcesses);
+
+    for (unsigned ix = 0; ix < sim_processes(); ++ix)
+        sim_expect(aName, aTraceNo, "spawn time",
+            sim_process(ix)->mSpawnMillis, aOutcome->mSpawnMillis[ix]);
+
+    sim_expect(aName, aTraceNo, "duration", sim_millis(), aOutcome->mMillis);
+}
+
+/******************************************************************************/
+void
+sim_respawn(void)
+{
+    struct SimRespawnTrace   trace;
+    struct SimRespawnOutcome outcome;
+
+    /* Anchor the reference model with traces whose outcomes are known:
+     * a program that fails after running for a few seconds is restarted
+     * with backoff until it succeeds, a program that fails immediately
+     * is abandoned after ten attempts, and a program that terminates
+     * due to a signal is not restarted. */
+
+    {
+        static const struct SimScript Script[] = {
+            { 2000, 0x001 }, { 2000, 0x001 }, { 2000, 0x001 },
+            { 2000, 0x001 }, { 2000, 0x001 }, { 2000, 0x001 },
+            { 2000, 0x001 }, { 2000, 0x000 },
+        };
+
+        memset(&trace, 0, sizeof(trace));
+        memcpy(trace.mScript, Script, sizeof(Script));
+        trace.mScripts = NUMBEROF(Script);
+        trace.mExit[0] = 1;
+        trace.mSeed    = 1;
+
+        sim_respawn_check_("respawn_backoff", 0, &trace, &outcome);
+        sim_expect("respawn_backoff", 0, "exit", outcome.mExit, 0x000);
+        sim_expect("respawn_backoff", 0, "processes",
+            outcome.mProcesses, NUMBEROF(Script));
+        sim_report("respawn_backoff", 1, outcome.mProcesses, 0, sim_millis());
+    }
+
+    {
+        static const struct SimScript Script[] = {
+            { 0, 0x001 },
+        };
+
+        memset(&trace, 0, sizeof(trace));
+        memcpy(trace.mScript, Script, sizeof(Script));
+        trace.mScripts = NUMBEROF(Script);
+        trace.mExit[0] = 1;
+        trace.mSeed    = 1;
+
+        sim_respawn_check_("respawn_short", 0, &trace, &outcome);
+        sim_expect("respawn_short", 0, "exit", outcome.mExit, -1);
+        sim_expect("respawn_short", 0, "processes", outcome.mProcesses, 10);
+        sim_expect("respawn_short", 0, "duration", outcome.mMillis, 9);
+        sim_report("respawn_short", 1, outcome.mProcesses, 0, sim_millis());
+    }
+
+    {
+        static const struct SimScript Script[] = {
+            { 3000, 0x100 + SIGSEGV },
+        };
+
+        memset(&trace, 0, sizeof(trace));
+        memcpy(trace.mScript, Script, sizeof(Script));
+        trace.mScripts = NUMBEROF(Script);
+        trace.mExit[0] = 1;
+        trace.mSeed    = 1;
+
+        sim_respawn_check_("respawn_crash", 0, &trace, &outcome);
+        sim_expect("respawn_crash", 0, "exit", outcome.mExit, 0x100 + SIGSEGV);
+        sim_expect("respawn_crash", 0, "processes", outcome.mProcesses, 1);
+        sim_report("respawn_crash", 1, outcome.mProcesses, 0, sim_millis());
+    }
+
+    /* Check the policy against the model across random traces. */
+
+    unsigned processes = 0;
+    uint64_t millis    = 0;
+
+    for (unsigned traceNo = 1; traceNo <= SIM_TRACES; ++traceNo) {
+        sim_respawn_trace_(&trace, traceNo);
+        sim_respawn_check_("respawn_random", traceNo, &trace, &outcome);
+
+        processes += outcome.mProcesses;
+        millis    += outcome.mMillis;
+    }
+
+    sim_report("respawn_random", SIM_TRACES, processes, 0, millis);
+}
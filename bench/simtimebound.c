@@ -0,0 +1,358 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+
+#include "sim.h"
+
+#include "clk.h"
+#include "err.h"
+#include "escalate.h"
+#include "proc.h"
+#include "macros.h"
+
+#include <signal.h>
+#include <string.h>
+
+#include <sys/wait.h>
+
+/* Drive the escalation policy as timebound does, and compare the
+ * signals sent, the time each is sent, and the outcome, with a
+ * reference model that walks the schedule from the earlier of the
+ * maximum bound and the time a budget is exceeded. */
+
+#define SIM_TIMEBOUND_STEPS 4
+
+struct SimTimeboundTrace {
+    struct SimScript    mScript;
+    struct EscalateStep mStep[SIM_TIMEBOUND_STEPS];
+    unsigned            mSteps;
+    uint64_t            mMinMillis;
+    uint64_t            mMaxMillis;
+    uint64_t            mBudgetMillis;
+};
+
+struct SimTimeboundOutcome {
+    int      mExit;
+    unsigned mSignals;
+    int      mSignal[SIM_SIGNALS];
+    uint64_t mSignalMillis[SIM_SIGNALS];
+    uint64_t mMillis;
+};
+
+/******************************************************************************/
+static int
+sim_timebound_(const struct SimTimeboundTrace *aTrace)
+{
+    static char *cmd[] = { "sim", 0 };
+
+    uint64_t beginMicros = clk_monomicros();
+
+    pid_t pid = proc_execute(cmd, 0, 0);
+    if (-1 == pid)
+        die("Unable to execute process");
+
+    struct Escalation escalation;
+
+    escalate_init(&escalation, aTrace->mStep, aTrace->mSteps);
+
+    if (aTrace->mMaxMillis)
+        escalate_start(&escalation, beginMicros + aTrace->mMaxMillis * 1000);
+
+    uint64_t budgetMicros = aTrace->mBudgetMillis
+        ? beginMicros + aTrace->mBudgetMillis * 1000 : 0;
+
+    int exitCode;
+
+    while (1) {
+
+        int status;
+
+        pid_t waitPid = proc_wait(pid, &status, WNOHANG, 0);
+        if (-1 == waitPid)
+            die("Unable to wait for process %d", (int) pid);
+
+        if (waitPid) {
+            exitCode = WIFSIGNALED(status)
+                ? 0x100 + WTERMSIG(status) : WEXITSTATUS(status);
+            break;
+        }
+
+        if (SIM_SIGNALS == escalation.mSignals) {
+            exitCode = SIM_EXHAUSTED;
+            break;
+        }
+
+        /* Once the budget is exceeded, start the escalation at once,
+         * which has no effect if the maximum bound has already started
+         * it. */
+
+        uint64_t nowMicros = clk_monomicros();
+
+        if (budgetMicros && nowMicros >= budgetMicros) {
+            escalate_start(&escalation, nowMicros);
+            budgetMicros = 0;
+        }
+
+        const struct EscalateStep *step =
+            escalate_signal(&escalation, nowMicros);
+
+        if (step) {
+            proc_kill(pid, step->mSignal);
+            continue;
+        }
+
+        int waitMillis = escalate_wait(&escalation, nowMicros);
+
+        if (budgetMicros) {
+            int budgetMillis = (budgetMicros - nowMicros + 999) / 1000;
+
+            if (-1 == waitMillis || budgetMillis < waitMillis)
+                waitMillis = budgetMillis;
+        }
+
+        struct ProcMonitorEvent procEvent;
+
+        if (proc_monitor_wait(-1, waitMillis, &procEvent))
+            die("Unable to wait for process %d", (int) pid);
+    }
+
+    /* Hold a program that exits early until the minimum bound. */
+
+    uint64_t minMicros = beginMicros + aTrace->mMinMillis * 1000;
+
+    if (0 <= exitCode && 0x100 > exitCode && clk_monomicros() < minMicros)
+        clk_sleepuntil(minMicros);
+
+    return exitCode;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_timebound_model_(const struct SimTimeboundTrace *aTrace,
+                     struct SimTimeboundOutcome *aOutcome)
+{
+    uint64_t signalMillis = SIM_FOREVER;
+
+    if (aTrace->mMaxMillis)
+        signalMillis = aTrace->mMaxMillis;
+
+    if (aTrace->mBudgetMillis && aTrace->mBudgetMillis < signalMillis)
+        signalMillis = aTrace->mBudgetMillis;
+
+    uint64_t exitMillis = aTrace->mScript.mRunMillis;
+
+    aOutcome->mExit    = aTrace->mScript.mExit;
+    aOutcome->mSignals = 0;
+
+    /* Each signal is sent while the program is still running, and the
+     * last signal of the schedule is repeated. */
+
+    for (unsigned stepIx = 0; signalMillis < exitMillis; ) {
+
+        const struct EscalateStep *step = &aTrace->mStep[stepIx];
+
+        aOutcome->mSignal[aOutcome->mSignals]       = step->mSignal;
+        aOutcome->mSignalMillis[aOutcome->mSignals] = signalMillis;
+        ++aOutcome->mSignals;
+
+        if (sim_terminates(step->mSignal, aTrace->mScript.mIgnore)) {
+            aOutcome->mExit = 0x100 + step->mSignal;
+            exitMillis      = signalMillis;
+            break;
+        }
+
+        if (SIM_SIGNALS == aOutcome->mSignals) {
+            aOutcome->mExit = SIM_EXHAUSTED;
+            exitMillis      = signalMillis;
+            break;
+        }
+
+        /* The simulation only wakes on whole milliseconds, so each
+         * signal is sent at the first millisecond it is due. */
+
+        signalMillis += (step->mDelayMicros + 999) / 1000;
+
+        if (stepIx + 1 < aTrace->mSteps)
+            ++stepIx;
+    }
+
+    aOutcome->mMillis = exitMillis;
+
+    if (0 <= aOutcome->mExit && 0x100 > aOutcome->mExit &&
+            aOutcome->mMillis < aTrace->mMinMillis)
+        aOutcome->mMillis = aTrace->mMinMillis;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_timebound_trace_(struct SimTimeboundTrace *aTrace)
+{
+    /* Mix signals that terminate the program with signals that do not,
+     * and programs that ignore a signal in the schedule. */
+
+    static const int Signal[] = {
+        SIGTERM, SIGINT, SIGHUP, SIGUSR1, SIGCONT, SIGKILL,
+    };
+
+    memset(aTrace, 0, sizeof(*aTrace));
+
+    aTrace->mSteps = 1 + sim_random(SIM_TIMEBOUND_STEPS);
+
+    for (unsigned ix = 0; ix < aTrace->mSteps; ++ix) {
+        struct EscalateStep *step = &aTrace->mStep[ix];
+
+        step->mSignal = Signal[sim_random(NUMBEROF(Signal))];
+
+        /* Only the last step must have a delay. */
+
+        if (ix + 1 == aTrace->mSteps || sim_random(4))
+            step->mDelayMicros = 1 + sim_random(5000000);
+    }
+
+    aTrace->mScript.mRunMillis = sim_random(3)
+        ? sim_random(30000) : SIM_FOREVER;
+    aTrace->mScript.mExit = sim_random(4)
+        ? sim_random(4) : 0x100 + SIGSEGV;
+    aTrace->mScript.mIgnore = sim_random(2)
+        ? Signal[sim_random(NUMBEROF(Signal))] : 0;
+
+    aTrace->mMinMillis    = sim_random(2) ? 1 + sim_random(20000) : 0;
+    aTrace->mMaxMillis    = sim_random(5) ? 1 + sim_random(20000) : 0;
+    aTrace->mBudgetMillis = sim_random(4) ? 0 : 1 + sim_random(30000);
+
+    /* A program that runs forever must be bounded. */
+
+    if (SIM_FOREVER == aTrace->mScript.mRunMillis &&
+            !aTrace->mMaxMillis && !aTrace->mBudgetMillis)
+        aTrace->mMaxMillis = 1 + sim_random(20000);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+sim_timebound_check_(const char *aName, unsigned aTraceNo,
+                     const struct SimTimeboundTrace *aTrace,
+                     struct SimTimeboundOutcome *aOutcome)
+{
+    sim_start(&aTrace->mScript, 1, aTraceNo);
+
+    int exitCode = sim_timebound_(aTrace);
+
+    sim_stop();
+
+    sim_timebound_model_(aTrace, aOutcome);
+
+    const struct SimProcess *process = sim_process(0);
+
+    sim_expect(aName, aTraceNo, "exit", exitCode, aOutcome->mExit);
+    sim_expect(aName, aTraceNo, "signals",
+        process->mSignals, aOutcome->mSignals);
+
+    for (unsigned ix = 0; ix < process->mSignals; ++ix) {
+        sim_expect(aName, aTraceNo, "signal",
+            process->mSignal[ix], aOutcome->mSignal[ix]);
+        sim_expect(aName, aTraceNo, "signal time",
+            process->mSignalMillis[ix], aOutcome->mSignalMillis[ix]);
+    }
+
+    sim_expect(aName, aTraceNo, "duration", sim_millis(), aOutcome->mMillis);
+}
+
+/******************************************************************************/
+void
+sim_timebound(void)
+{
+    static const struct EscalateStep DefaultStep[] = {
+        { SIGTERM, 5 * 1000000 },
+        { SIGKILL, 5 * 1000000 },
+    };
+
+    struct SimTimeboundTrace   trace;
+    struct SimTimeboundOutcome outcome;
+
+    /* Anchor the reference model with traces whose outcomes are known,
+     * using the default escalation schedule: a program that exits within
+     * the maximum bound is not signalled, a program that exits early is
+     * held until the minimum bound, and a program that ignores the first
+     * signal is killed when the next step of the schedule is reached. */
+
+    memset(&trace, 0, sizeof(trace));
+    memcpy(trace.mStep, DefaultStep, sizeof(DefaultStep));
+    trace.mSteps = NUMBEROF(DefaultStep);
+
+    trace.mScript     = (struct SimScript) { 2000, 0x003 };
+    trace.mMaxMillis  = 10000;
+
+    sim_timebound_check_("timebound_exit", 0, &trace, &outcome);
+    sim_expect("timebound_exit", 0, "exit", outcome.mExit, 0x003);
+    sim_expect("timebound_exit", 0, "duration", outcome.mMillis, 2000);
+    sim_expect("timebound_exit", 0, "signals", outcome.mSignals, 0);
+    sim_report("timebound_exit", 1, 1, outcome.mSignals, outcome.mMillis);
+
+    trace.mScript     = (struct SimScript) { 1000, 0x000 };
+    trace.mMinMillis  = 5000;
+
+    sim_timebound_check_("timebound_min", 0, &trace, &outcome);
+    sim_expect("timebound_min", 0, "exit", outcome.mExit, 0x000);
+    sim_expect("timebound_min", 0, "duration", outcome.mMillis, 5000);
+    sim_report("timebound_min", 1, 1, outcome.mSignals, outcome.mMillis);
+
+    trace.mScript     = (struct SimScript) { SIM_FOREVER, 0x000, SIGTERM };
+    trace.mMinMillis  = 0;
+    trace.mMaxMillis  = 1000;
+
+    sim_timebound_check_("timebound_kill", 0, &trace, &outcome);
+    sim_expect("timebound_kill", 0, "exit", outcome.mExit, 0x100 + SIGKILL);
+    sim_expect("timebound_kill", 0, "duration", outcome.mMillis, 6000);
+    sim_expect("timebound_kill", 0, "signals", outcome.mSignals, 2);
+    sim_expect("timebound_kill", 0, "signal",
+        outcome.mSignal[0], SIGTERM);
+    sim_expect("timebound_kill", 0, "signal time",
+        outcome.mSignalMillis[0], 1000);
+    sim_expect("timebound_kill", 0, "signal",
+        outcome.mSignal[1], SIGKILL);
+    sim_expect("timebound_kill", 0, "signal time",
+        outcome.mSignalMillis[1], 6000);
+    sim_report("timebound_kill", 1, 1, outcome.mSignals, outcome.mMillis);
+
+    /* A budget that is exceeded before the maximum bound starts the
+     * escalation at once. */
+
+    trace.mScript       = (struct SimScript) { SIM_FOREVER, 0x000 };
+    trace.mMaxMillis    = 10000;
+    trace.mBudgetMillis = 500;
+
+    sim_timebound_check_("timebound_budget", 0, &trace, &outcome);
+    sim_expect("timebound_budget", 0, "exit", outcome.mExit, 0x100 + SIGTERM);
+    sim_expect("timebound_budget", 0, "duration", outcome.mMillis, 500);
+    sim_report("timebound_budget", 1, 1, outcome.mSignals, outcome.mMillis);
+
+    /* Check the policy against the model across random traces. */
+
+    unsigned signals = 0;
+    uint64_t millis  = 0;
+
+    for (unsigned traceNo = 1; traceNo <= SIM_TRACES; ++traceNo) {
+        sim_timebound_trace_(&trace);
+        sim_timebound_check_("timebound_random", traceNo, &trace, &outcome);
+
+        signals += outcome.mSignals;
+        millis  += outcome.mMillis;
+    }
+
+    sim_report("timebound_random", SIM_TRACES, SIM_TRACES, signals, millis);
+}
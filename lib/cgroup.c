@@ -0,0 +1,330 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "cgroup.h"
+
+#include "err.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+/******************************************************************************/
+const char *
+cgroup_mount(void)
+{
+    /* The unified hierarchy is mounted at /sys/fs/cgroup, or beneath
+     * it on hosts that also mount the legacy hierarchies. */
+
+    static const char *MountPath[] = {
+        "/sys/fs/cgroup",
+        "/sys/fs/cgroup/unified",
+    };
+
+    for (unsigned ix = 0; ix < NUMBEROF(MountPath); ++ix) {
+        char controllerPath[sizeof("/sys/fs/cgroup/unified/cgroup.procs")];
+
+        snprintf(controllerPath, sizeof(controllerPath),
+            "%s/cgroup.procs", MountPath[ix]);
+
+        if (!access(controllerPath, F_OK))
+            return MountPath[ix];
+    }
+
+    errno = ENOENT;
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_find(pid_t aPid, char *aPath, size_t aLen)
+{
+    int rc = -1;
+
+    FILE *cgroupFile = 0;
+
+    /* Find the path of the unified cgroup hierarchy, which is listed
+     * on a line of the form 0::path. */
+
+    char cgroupPath[sizeof("/proc//cgroup") + sizeof(pid_t) * CHAR_BIT];
+
+    if (aPid)
+        snprintf(cgroupPath, sizeof(cgroupPath), "/proc/%d/cgroup", aPid);
+    else
+        snprintf(cgroupPath, sizeof(cgroupPath), "/proc/self/cgroup");
+
+    cgroupFile = fopen(cgroupPath, "r");
+    if (!cgroupFile)
+        goto Finally;
+
+    char cgroupLine[PATH_MAX];
+
+    while (1) {
+        if (!fgets(cgroupLine, sizeof(cgroupLine), cgroupFile)) {
+            errno = ENOENT;
+            goto Finally;
+        }
+
+        if (!strncmp("0::", cgroupLine, 3))
+            break;
+    }
+
+    cgroupLine[strcspn(cgroupLine, "\n")] = 0;
+
+    if (strlen(cgroupLine + 3) >= aLen) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    strcpy(aPath, cgroupLine + 3);
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (cgroupFile)
+            fclose(cgroupFile);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+cgroup_write(const char *aDir, const char *aFile, const char *aText)
+{
+    int rc = -1;
+
+    FILE *controlFile = 0;
+
+    char controlPath[PATH_MAX];
+
+    if (sizeof(controlPath) <= snprintf(
+            controlPath, sizeof(controlPath), "%s/%s", aDir, aFile)) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    controlFile = fopen(controlPath, "w");
+    if (!controlFile)
+        goto Finally;
+
+    if (EOF == fputs(aText, controlFile))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (controlFile) {
+            if (fclose(controlFile))
+                rc = -1;
+        }
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_stat(
+    const char *aDir, const char *aFile, const char *aKey, uint64_t *aValue)
+{
+    int rc = -1;
+
+    FILE *statFile = 0;
+
+    /* Find the value of a key in a flat keyed file such as cpu.stat
+     * or memory.events, where each line has the form: key value */
+
+    char statPath[PATH_MAX];
+
+    if (sizeof(statPath) <= snprintf(
+            statPath, sizeof(statPath), "%s/%s", aDir, aFile)) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    statFile = fopen(statPath, "r");
+    if (!statFile)
+        goto Finally;
+
+    size_t keyLen = strlen(aKey);
+
+    char statLine[256];
+
+    while (fgets(statLine, sizeof(statLine), statFile)) {
+        if (strncmp(statLine, aKey, keyLen) || ' ' != statLine[keyLen])
+            continue;
+
+        if (1 != sscanf(statLine + keyLen, " %" SCNu64, aValue)) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        rc = 0;
+        goto Finally;
+    }
+
+    errno = ENOENT;
+
+Finally:
+
+    FINALLY({
+        if (statFile)
+            fclose(statFile);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_create(char *aDir, size_t aLen, const char *aName)
+{
+    int rc = -1;
+
+    /* Create the new cgroup as a child of the cgroup of the caller,
+     * which must be delegated to the caller. */
+
+    const char *mountPath = cgroup_mount();
+    if (!mountPath)
+        goto Finally;
+
+    char selfCgroup[PATH_MAX];
+
+    if (cgroup_find(0, selfCgroup, sizeof(selfCgroup)))
+        goto Finally;
+
+    const char *selfSep = strcmp("/", selfCgroup) ? "/" : "";
+
+    if (aLen <= snprintf(aDir, aLen, "%s%s%s%s",
+            mountPath, selfCgroup, selfSep, aName)) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    if (mkdir(aDir, 0755))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_enter(const char *aDir)
+{
+    /* Writing 0 moves the calling process. */
+
+    return cgroup_write(aDir, "cgroup.procs", "0\n");
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_signal(const char *aDir, int aSignal)
+{
+    int rc = -1;
+
+    FILE *procsFile = 0;
+
+    /* Signal each process in the cgroup, and return the number of
+     * processes found so that a signal of 0 counts the processes. */
+
+    char procsPath[PATH_MAX];
+
+    if (sizeof(procsPath) <= snprintf(
+            procsPath, sizeof(procsPath), "%s/cgroup.procs", aDir)) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    procsFile = fopen(procsPath, "r");
+    if (!procsFile)
+        goto Finally;
+
+    int procCount = 0;
+
+    int procPid;
+
+    while (1 == fscanf(procsFile, "%d", &procPid)) {
+        ++procCount;
+
+        if (aSignal)
+            kill(procPid, aSignal);
+    }
+
+    if (ferror(procsFile))
+        goto Finally;
+
+    rc = procCount;
+
+Finally:
+
+    FINALLY({
+        if (procsFile)
+            fclose(procsFile);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_kill(const char *aDir)
+{
+    int rc = -1;
+
+    /* Kill all the processes in the cgroup atomically, including those
+     * that are forking, but fall back to killing each process in turn
+     * on kernels without cgroup.kill. */
+
+    if (cgroup_write(aDir, "cgroup.kill", "1\n")) {
+        if (ENOENT != errno)
+            goto Finally;
+
+        if (-1 == cgroup_signal(aDir, SIGKILL))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+cgroup_remove(const char *aDir)
+{
+    return rmdir(aDir);
+}
+
+/******************************************************************************/
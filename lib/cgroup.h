@@ -0,0 +1,37 @@
+#ifndef CGROUP_H_
+#define CGROUP_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+
+#include <sys/types.h>
+
+const char *cgroup_mount(void);
+int cgroup_find(pid_t aPid, char *aPath, size_t aLen);
+
+int cgroup_create(char *aDir, size_t aLen, const char *aName);
+int cgroup_enter(const char *aDir);
+int cgroup_signal(const char *aDir, int aSignal);
+int cgroup_kill(const char *aDir);
+int cgroup_remove(const char *aDir);
+
+int cgroup_write(const char *aDir, const char *aFile, const char *aText);
+int cgroup_stat(
+    const char *aDir, const char *aFile, const char *aKey, uint64_t *aValue);
+
+#endif
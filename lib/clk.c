@@ -17,26 +17,92 @@
 #include "clk.h"
 
 #include "err.h"
+#include "macros.h"
 
+#include <ctype.h>
+#include <string.h>
 #include <time.h>
 
+/* The coarse clock is read from the tick maintained by the kernel, and
+ * is cheaper to read at the expense of resolution. The boot clock
+ * continues to advance while the system is suspended. MacOS does not
+ * provide either, but its monotonic clock already advances while the
+ * system is suspended. */
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define CLK_COARSE_ CLOCK_MONOTONIC_COARSE
+#else
+#define CLK_COARSE_ CLOCK_MONOTONIC
+#endif
+
+#ifdef CLOCK_BOOTTIME
+#define CLK_BOOT_ CLOCK_BOOTTIME
+#else
+#define CLK_BOOT_ CLOCK_MONOTONIC
+#endif
+
+/******************************************************************************/
+static uint64_t
+clk_nanos_(clockid_t aClock)
+{
+    struct timespec clockTime;
+
+    if (clock_gettime(aClock, &clockTime))
+        fatal("Unable to get clock %d time", (int) aClock);
+
+    return 1000000000 * (uint64_t) clockTime.tv_sec + clockTime.tv_nsec;
+}
+
+static void
+clk_sleepuntil_(uint64_t aMonoMicros);
+
+static const struct ClkSource SystemSource = {
+    .mNanos      = clk_nanos_,
+    .mSleepUntil = clk_sleepuntil_,
+};
+
+static const struct ClkSource *ActiveSource = &SystemSource;
+
+static uint64_t
+clk_read_(clockid_t aClock, unsigned aScale)
+{
+    return ActiveSource->mNanos(aClock) / aScale;
+}
+
 /******************************************************************************/
 static volatile uint64_t ReferenceMillis;
+static volatile uint64_t ReferenceBootMillis;
 
 uint64_t
 clk_monomillis(void)
 {
-    struct timespec clockTime;
+    return
+        clk_read_(CLOCK_MONOTONIC, 1000000)
+            - ReferenceMillis;
+}
 
-    if (clock_gettime(CLOCK_MONOTONIC, &clockTime))
-        fatal("Unable to get CLOCK_MONOTONIC time");
+/*----------------------------------------------------------------------------*/
+uint64_t
+clk_coarsemillis(void)
+{
+    /* The coarse clock never leads the monotonic clock, so a coarse
+     * timestamp can be subtracted from a later reading of
+     * clk_monomillis(), but not the other way around. */
 
     return
-        1000 * (uint64_t) clockTime.tv_sec
-            + clockTime.tv_nsec / 1000000
+        clk_read_(CLK_COARSE_, 1000000)
             - ReferenceMillis;
 }
 
+/*----------------------------------------------------------------------------*/
+uint64_t
+clk_bootmillis(void)
+{
+    return
+        clk_read_(CLK_BOOT_, 1000000)
+            - ReferenceBootMillis;
+}
+
 static void
 clk_monomillis_init_(void)
 __attribute__((constructor));
@@ -45,46 +111,193 @@ static void
 clk_monomillis_init_(void)
 {
     uint64_t monoMillis;
+    uint64_t bootMillis;
 
     /* Count the number of milliseconds elapsed since program initialisation
      * so that the observed clock will advance from 0 without concern
-     * for wrapping. */
+     * for wrapping. Take the reference from the coarse clock so that
+     * readings of both the coarse and the monotonic clock advance from
+     * 0. */
 
     ReferenceMillis = 0;
 
     do
-        monoMillis = clk_monomillis();
+        monoMillis = clk_coarsemillis();
     while (!monoMillis);
 
     ReferenceMillis = monoMillis;
+
+    ReferenceBootMillis = 0;
+
+    do
+        bootMillis = clk_bootmillis();
+    while (!bootMillis);
+
+    ReferenceBootMillis = bootMillis;
+}
+
+/******************************************************************************/
+uint64_t
+clk_monomicros(void)
+{
+    /* Unlike clk_monomillis(), the monotonic clock is not offset so that
+     * the observed time can be correlated with that of other processes. */
+
+    return clk_read_(CLOCK_MONOTONIC, 1000);
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+clk_mononanos(void)
+{
+    return clk_read_(CLOCK_MONOTONIC, 1);
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+clk_coarsemicros(void)
+{
+    /* The coarse clock can lag clk_monomicros() by up to a tick, so
+     * only compare it to other readings of the coarse clock. */
+
+    return clk_read_(CLK_COARSE_, 1000);
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+clk_realmicros(void)
+{
+    return clk_read_(CLOCK_REALTIME, 1000);
 }
 
 /******************************************************************************/
 void
 clk_sleepmillis(uint32_t aDuration)
 {
-    uint64_t now = clk_monomillis();
-    uint64_t deadline = now + aDuration;
+    /* Use a fixed deadline so that long durations will be immune to the
+     * affect of small errors accumulating over multiple interrupted
+     * nanosleep() calls. */
+
+    clk_sleepuntil(clk_monomicros() + 1000 * (uint64_t) aDuration);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+clk_sleepuntil_(uint64_t aMonoMicros)
+{
+    uint64_t now = clk_monomicros();
 
     /* Do not use clock_nanosleep(2) because it is not available on MacOS,
      * and do not use sleep(3) because in principle it can interfere with
      * SIGALRM handling.
      *
-     * Use a fixed deadline so that long durations will be immune to the
-     * affect of small errors accumulating over multiple interrupted
-     * nanosleep() calls. */
+     * Sleep until the monotonic clock reaches an absolute deadline so
+     * that periodic schedules do not accumulate errors from one period
+     * to the next. */
 
-    while (now < deadline) {
-        uint64_t duration = deadline - now;
+    while (now < aMonoMicros) {
+        uint64_t duration = aMonoMicros - now;
 
         struct timespec sleepDuration;
-        sleepDuration.tv_sec = duration / 1000;
-        sleepDuration.tv_nsec = duration % 1000 * 1000000;
+        sleepDuration.tv_sec = duration / 1000000;
+        sleepDuration.tv_nsec = duration % 1000000 * 1000;
 
         nanosleep(&sleepDuration, 0);
 
-        now = clk_monomillis();
+        now = clk_monomicros();
+    }
+}
+
+void
+clk_sleepuntil(uint64_t aMonoMicros)
+{
+    ActiveSource->mSleepUntil(aMonoMicros);
+}
+
+/******************************************************************************/
+int
+clk_strtomicros(uint64_t *aMicros, const char *aString)
+{
+    int rc = -1;
+
+    static const struct {
+        const char *mUnit;
+        uint64_t    mMicros;
+    } DurationUnit[] = {
+        { "us", 1 },
+        { "ms", 1000 },
+        { "s",  1000000 },
+        { "m",  60 * 1000000ULL },
+        { "h",  60 * 60 * 1000000ULL },
+        { "",   1000000 },
+    };
+
+    /* Parse a decimal duration, for example 250ms or 1.5s, with the
+     * fraction limited to the resolution of a microsecond. A duration
+     * without a unit is measured in seconds. */
+
+    const char *textPtr = aString;
+
+    if (!isdigit((unsigned char) *textPtr))
+        goto Finally;
+
+    uint64_t whole = 0;
+
+    while (isdigit((unsigned char) *textPtr)) {
+        if (whole > (UINT64_MAX - 9) / 10)
+            goto Finally;
+        whole = whole * 10 + (*textPtr++ - '0');
+    }
+
+    uint64_t fraction      = 0;
+    uint64_t fractionScale = 1;
+
+    if ('.' == *textPtr) {
+        ++textPtr;
+
+        if (!isdigit((unsigned char) *textPtr))
+            goto Finally;
+
+        while (isdigit((unsigned char) *textPtr)) {
+            if (fractionScale < 1000000) {
+                fraction = fraction * 10 + (*textPtr - '0');
+                fractionScale *= 10;
+            }
+            ++textPtr;
+        }
+    }
+
+    unsigned ix;
+
+    for (ix = 0; ix < NUMBEROF(DurationUnit); ++ix) {
+        if (!strcmp(DurationUnit[ix].mUnit, textPtr))
+            break;
     }
+
+    if (NUMBEROF(DurationUnit) <= ix)
+        goto Finally;
+
+    uint64_t unitMicros = DurationUnit[ix].mMicros;
+
+    if (whole > UINT64_MAX / unitMicros)
+        goto Finally;
+
+    *aMicros = whole * unitMicros + fraction * unitMicros / fractionScale;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+void
+clk_source(const struct ClkSource *aSource)
+{
+    ActiveSource = aSource ? aSource : &SystemSource;
+
+    clk_monomillis_init_();
 }
 
 /******************************************************************************/
@@ -17,8 +17,31 @@
  */
 
 #include <inttypes.h>
+#include <time.h>
 
 uint64_t clk_monomillis(void);
+uint64_t clk_monomicros(void);
+uint64_t clk_mononanos(void);
+uint64_t clk_coarsemillis(void);
+uint64_t clk_coarsemicros(void);
+uint64_t clk_bootmillis(void);
+uint64_t clk_realmicros(void);
 void clk_sleepmillis(uint32_t aDuration);
+void clk_sleepuntil(uint64_t aMonoMicros);
+
+int clk_strtomicros(uint64_t *aMicros, const char *aString);
+
+/* A clock source replaces the system clocks and sleep, so that a
+ * simulation can run in virtual time. Installing a source rebases the
+ * clocks measured from program initialisation, so should be done
+ * before any time is measured. Installing a null source restores the
+ * system clocks. */
+
+struct ClkSource {
+    uint64_t (*mNanos)(clockid_t aClock);
+    void     (*mSleepUntil)(uint64_t aMonoMicros);
+};
+
+void clk_source(const struct ClkSource *aSource);
 
 #endif
@@ -0,0 +1,84 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "escalate.h"
+
+#include <limits.h>
+
+/******************************************************************************/
+void
+escalate_init(struct Escalation *aEscalation,
+              const struct EscalateStep *aStep, unsigned aSteps)
+{
+    aEscalation->mStep    = aStep;
+    aEscalation->mSteps   = aSteps;
+    aEscalation->mNext    = 0;
+    aEscalation->mSignals = 0;
+    aEscalation->mMicros  = 0;
+}
+
+/******************************************************************************/
+void
+escalate_start(struct Escalation *aEscalation, uint64_t aMicros)
+{
+    /* Once the first signal is sent, the schedule determines when the
+     * next signal is sent, so a later start is ignored. */
+
+    if (!aEscalation->mSignals)
+        aEscalation->mMicros = aMicros;
+}
+
+/******************************************************************************/
+const struct EscalateStep *
+escalate_signal(struct Escalation *aEscalation, uint64_t aNowMicros)
+{
+    /* Return the step whose signal is due, if any, and schedule the
+     * next step, repeating the last step of the schedule. */
+
+    if (!aEscalation->mMicros || aNowMicros < aEscalation->mMicros)
+        return 0;
+
+    const struct EscalateStep *step = &aEscalation->mStep[aEscalation->mNext];
+
+    aEscalation->mMicros = aNowMicros + step->mDelayMicros;
+
+    if (aEscalation->mNext + 1 < aEscalation->mSteps)
+        ++aEscalation->mNext;
+
+    ++aEscalation->mSignals;
+
+    return step;
+}
+
+/******************************************************************************/
+int
+escalate_wait(const struct Escalation *aEscalation, uint64_t aNowMicros)
+{
+    /* Return the milliseconds until the next signal is due, rounding
+     * up to avoid waking before it is, or -1 if none is scheduled. */
+
+    if (!aEscalation->mMicros)
+        return -1;
+
+    uint64_t waitMicros = aEscalation->mMicros > aNowMicros
+        ? aEscalation->mMicros - aNowMicros : 0;
+
+    return waitMicros / 1000 >= INT_MAX
+        ? INT_MAX : (waitMicros + 999) / 1000;
+}
+
+/******************************************************************************/
@@ -0,0 +1,47 @@
+#ifndef ESCALATE_H_
+#define ESCALATE_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+
+/* An escalation sends each signal in a schedule in turn, waiting the
+ * delay of each step before sending the next signal, and repeats the
+ * last signal until the process terminates. The escalation only starts
+ * once it is scheduled, and a time of zero means that it is not. */
+
+struct EscalateStep {
+    int      mSignal;
+    uint64_t mDelayMicros;
+};
+
+struct Escalation {
+    const struct EscalateStep *mStep;
+    unsigned                   mSteps;
+    unsigned                   mNext;
+    unsigned                   mSignals;
+    uint64_t                   mMicros;
+};
+
+void escalate_init(struct Escalation *aEscalation,
+                   const struct EscalateStep *aStep, unsigned aSteps);
+void escalate_start(struct Escalation *aEscalation, uint64_t aMicros);
+const struct EscalateStep *escalate_signal(
+    struct Escalation *aEscalation, uint64_t aNowMicros);
+int escalate_wait(const struct Escalation *aEscalation, uint64_t aNowMicros);
+
+#endif
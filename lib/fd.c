@@ -22,8 +22,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include <sys/mman.h>
+#include <sys/uio.h>
+
 /******************************************************************************/
 int
 fd_cloexec(int aFd)
@@ -48,6 +52,54 @@ Finally:
     return rc;
 }
 
+/*----------------------------------------------------------------------------*/
+int
+fd_inherit(int aFd)
+{
+    int rc = -1;
+
+    int arg;
+
+    arg = fcntl(aFd, F_GETFD);
+    if (-1 == arg)
+        goto Finally;
+
+    arg &= ~FD_CLOEXEC;
+
+    if (-1 == fcntl(aFd, F_SETFD, arg))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+fd_nonblock(int aFd)
+{
+    int rc = -1;
+
+    int arg;
+
+    arg = fcntl(aFd, F_GETFL);
+    if (-1 == arg)
+        goto Finally;
+
+    arg |= O_NONBLOCK;
+
+    if (-1 == fcntl(aFd, F_SETFL, arg))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
 /*----------------------------------------------------------------------------*/
 int
 fd_close(int aFd)
@@ -58,6 +110,47 @@ fd_close(int aFd)
     return -1;
 }
 
+/*----------------------------------------------------------------------------*/
+int
+fd_anonymous(const char *aName)
+{
+    int rc = -1;
+
+    int fd = -1;
+
+#ifdef MFD_CLOEXEC
+    fd = memfd_create(aName, MFD_CLOEXEC);
+    if (-1 == fd)
+        goto Finally;
+#else
+    /* Without memfd_create(2), use an unlinked temporary file so that
+     * the content disappears once the last descriptor is closed. */
+
+    char tmpPath[] = "/tmp/anon.XXXXXX";
+
+    fd = mkstemp(tmpPath);
+    if (-1 == fd)
+        goto Finally;
+
+    if (unlink(tmpPath))
+        goto Finally;
+
+    if (fd_cloexec(fd))
+        goto Finally;
+#endif
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc)
+            fd = fd_close(fd);
+    });
+
+    return fd;
+}
+
 /*----------------------------------------------------------------------------*/
 ssize_t
 fd_write(int aFd, const char *aBuf, ssize_t aLen)
@@ -95,6 +188,65 @@ Finally:
     return rc ? -1 : bufPtr - aBuf;
 }
 
+/*----------------------------------------------------------------------------*/
+ssize_t
+fd_writev(int aFd, struct iovec *aIov, unsigned aCount)
+{
+    int rc = -1;
+
+    ssize_t writeTotal = 0;
+
+    struct iovec *iovPtr   = aIov;
+    unsigned      iovCount = aCount;
+
+    /* The vector is consumed as it is written so that a partial write
+     * can be resumed from the first byte not yet written. */
+
+    while (iovCount) {
+
+        if (!iovPtr->iov_len) {
+            ++iovPtr;
+            --iovCount;
+            continue;
+        }
+
+        ssize_t writeLen = writev(aFd, iovPtr, iovCount);
+        if (-1 == writeLen) {
+            if (EINTR == errno)
+                continue;
+            if (writeTotal)
+                break;
+            goto Finally;
+        }
+
+        if (0 == writeLen)
+            break;
+
+        writeTotal += writeLen;
+
+        while (writeLen) {
+            if (!iovCount)
+                die("File descriptor %d writev overrunning vector", aFd);
+
+            if ((size_t) writeLen < iovPtr->iov_len) {
+                iovPtr->iov_base  = (char *) iovPtr->iov_base + writeLen;
+                iovPtr->iov_len  -= writeLen;
+                writeLen = 0;
+            } else {
+                writeLen -= iovPtr->iov_len;
+                ++iovPtr;
+                --iovCount;
+            }
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : writeTotal;
+}
+
 /*----------------------------------------------------------------------------*/
 ssize_t
 fd_read(int aFd, char *aBuf, ssize_t aLen)
@@ -133,3 +285,53 @@ Finally:
 }
 
 /******************************************************************************/
+static ssize_t
+fd_copy_(int aPipeFd, int aFd, size_t aLen)
+{
+    ssize_t rc = -1;
+
+    char copyBuf[64 * 1024];
+
+    if (aLen > sizeof(copyBuf))
+        aLen = sizeof(copyBuf);
+
+    do
+        rc = read(aPipeFd, copyBuf, aLen);
+    while (-1 == rc && EINTR == errno);
+
+    if (0 < rc) {
+        if (rc != fd_write(aFd, copyBuf, rc))
+            rc = -1;
+    }
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+ssize_t
+fd_splice(int aPipeFd, int aFd, size_t aLen)
+{
+    ssize_t rc = -1;
+
+    /* Move data from the pipe to the descriptor within the kernel where
+     * possible, without copying it through user space. Only the pipe is
+     * non-blocking, so the caller should check that the descriptor is
+     * writable. Fall back to copying if the descriptor does not support
+     * splicing, as is the case for terminals and files opened for
+     * appending. */
+
+#ifdef __linux__
+    do
+        rc = splice(aPipeFd, 0, aFd, 0, aLen, SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+    while (-1 == rc && EINTR == errno);
+
+    if (-1 == rc && EINVAL == errno)
+        rc = fd_copy_(aPipeFd, aFd, aLen);
+#else
+    rc = fd_copy_(aPipeFd, aFd, aLen);
+#endif
+
+    return rc;
+}
+
+/******************************************************************************/
@@ -18,10 +18,17 @@
 
 #include <sys/types.h>
 
+struct iovec;
+
 int fd_cloexec(int aFd);
+int fd_inherit(int aFd);
+int fd_nonblock(int aFd);
 int fd_close(int aFd);
+int fd_anonymous(const char *aName);
 
 ssize_t fd_write(int aFd, const char *aBuf, ssize_t aLen);
+ssize_t fd_writev(int aFd, struct iovec *aIov, unsigned aCount);
 ssize_t fd_read(int aFd, char *aBuf, ssize_t aLen);
+ssize_t fd_splice(int aPipeFd, int aFd, size_t aLen);
 
 #endif
@@ -0,0 +1,173 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "fdstore.h"
+
+#include "err.h"
+#include "fd.h"
+
+#include "macros.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+void
+fdstore_init(struct FdStore *aStore)
+{
+    aStore->mCount = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+fdstore_put(struct FdStore *aStore, const char *aName, int aFd)
+{
+    int rc = -1;
+
+    /* Names are published in the environment as name=fd pairs, so
+     * restrict names to characters that cannot be confused with
+     * the separators. */
+
+    size_t nameLen = strlen(aName);
+
+    if (!nameLen || nameLen >= FDSTORE_NAME_MAX) {
+        warn("Invalid fd store name length %zu", nameLen);
+        goto Finally;
+    }
+
+    for (const char *ch = aName; *ch; ++ch) {
+        if (!isalnum((unsigned char) *ch) && !strchr("_-.", *ch)) {
+            warn("Invalid fd store name %s", aName);
+            goto Finally;
+        }
+    }
+
+    /* A descriptor with an existing name replaces the earlier one,
+     * and a notification without a descriptor removes the name. */
+
+    unsigned ix;
+
+    for (ix = 0; ix < aStore->mCount; ++ix) {
+        if (!strcmp(aName, aStore->mEntry[ix].mName))
+            break;
+    }
+
+    if (ix < aStore->mCount) {
+        DEBUG("Releasing fd store %s fd %d", aName, aStore->mEntry[ix].mFd);
+
+        fd_close(aStore->mEntry[ix].mFd);
+
+        if (-1 == aFd) {
+            aStore->mEntry[ix] = aStore->mEntry[--aStore->mCount];
+            rc = 0;
+            goto Finally;
+        }
+
+    } else if (-1 != aFd) {
+
+        if (FDSTORE_SIZE <= aStore->mCount) {
+            errno = 0;
+            warn("Unable to store fd %s, fd store is full", aName);
+            goto Finally;
+        }
+
+        ++aStore->mCount;
+    }
+
+    if (-1 != aFd) {
+        DEBUG("Storing fd store %s fd %d", aName, aFd);
+
+        aStore->mEntry[ix].mFd = aFd;
+        memcpy(aStore->mEntry[ix].mName, aName, nameLen + 1);
+
+        aFd = -1;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        aFd = fd_close(aFd);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+fdstore_share(const struct FdStore *aStore, int aShare)
+{
+    int rc = -1;
+
+    for (unsigned ix = 0; ix < aStore->mCount; ++ix) {
+        int fd = aStore->mEntry[ix].mFd;
+
+        if (aShare) {
+            if (fd_inherit(fd))
+                goto Finally;
+        } else {
+            if (fd_cloexec(fd))
+                goto Finally;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+fdstore_export(const struct FdStore *aStore, const char *aEnvName)
+{
+    int rc = -1;
+
+    char envValue[FDSTORE_SIZE * (FDSTORE_NAME_MAX + sizeof(int) * CHAR_BIT)];
+
+    char  *envPtr = envValue;
+    size_t envLen = sizeof(envValue);
+
+    envValue[0] = 0;
+
+    for (unsigned ix = 0; ix < aStore->mCount; ++ix) {
+        int printLen = snprintf(
+            envPtr, envLen, "%s%s=%d",
+            ix ? "," : "",
+            aStore->mEntry[ix].mName, aStore->mEntry[ix].mFd);
+
+        if (0 > printLen || envLen <= printLen)
+            goto Finally;
+
+        envPtr += printLen;
+        envLen -= printLen;
+    }
+
+    if (setenv(aEnvName, envValue, 1))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
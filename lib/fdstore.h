@@ -0,0 +1,37 @@
+#ifndef FDSTORE_H_
+#define FDSTORE_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define FDSTORE_SIZE     64
+#define FDSTORE_NAME_MAX 64
+
+struct FdStoreEntry {
+    int  mFd;
+    char mName[FDSTORE_NAME_MAX];
+};
+
+struct FdStore {
+    unsigned            mCount;
+    struct FdStoreEntry mEntry[FDSTORE_SIZE];
+};
+
+void fdstore_init(struct FdStore *aStore);
+int fdstore_put(struct FdStore *aStore, const char *aName, int aFd);
+int fdstore_share(const struct FdStore *aStore, int aShare);
+int fdstore_export(const struct FdStore *aStore, const char *aEnvName);
+
+#endif
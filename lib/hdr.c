@@ -0,0 +1,199 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "hdr.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+/******************************************************************************/
+static unsigned
+hdr_magnitude_(uint64_t aValue)
+{
+    /* Return the number of significant bits in the value. */
+
+    unsigned bits = 0;
+
+    while (aValue) {
+        aValue >>= 1;
+        ++bits;
+    }
+
+    return bits;
+}
+
+/*----------------------------------------------------------------------------*/
+static unsigned
+hdr_index_(const struct HdrHistogram *aHist, uint64_t aValue)
+{
+    /* Values smaller than the sub-bucket count are recorded exactly in
+     * the first bucket. Each subsequent bucket doubles the range and
+     * the resolution, so only the upper half of its sub-buckets are
+     * needed, the lower half being covered by the preceding buckets. */
+
+    unsigned halfBits  = aHist->mSubBucketBits - 1;
+    uint64_t subMask   = ((uint64_t) 1 << aHist->mSubBucketBits) - 1;
+
+    unsigned bucketIx  = hdr_magnitude_(aValue | subMask) -
+                         aHist->mSubBucketBits;
+    uint64_t subIx     = aValue >> bucketIx;
+
+    return (bucketIx << halfBits) + subIx;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint64_t
+hdr_value_(const struct HdrHistogram *aHist, unsigned aIndex)
+{
+    /* Return the highest value that is recorded at the index. */
+
+    unsigned halfBits = aHist->mSubBucketBits - 1;
+    uint64_t halfSize = (uint64_t) 1 << halfBits;
+
+    unsigned bucketIx = aIndex >> halfBits;
+    uint64_t subIx    = aIndex & (halfSize - 1);
+
+    if (bucketIx) {
+        subIx += halfSize;
+        --bucketIx;
+    }
+
+    return (subIx << bucketIx) + ((uint64_t) 1 << bucketIx) - 1;
+}
+
+/******************************************************************************/
+int
+hdr_init(struct HdrHistogram *aHist, uint64_t aHighest, unsigned aDigits)
+{
+    int rc = -1;
+
+    aHist->mCount = 0;
+
+    if (!aDigits || 5 < aDigits || aHighest >= UINT64_MAX >> 1) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    /* Resolve values to the specified number of decimal digits by
+     * dividing each bucket into at least twice that many sub-buckets,
+     * because each bucket only uses the upper half of its range. */
+
+    uint64_t resolution = 2;
+
+    for (unsigned digit = 0; digit < aDigits; ++digit)
+        resolution *= 10;
+
+    aHist->mSubBucketBits = hdr_magnitude_(resolution - 1);
+    aHist->mHighest       = aHighest;
+    aHist->mCounts        = hdr_index_(aHist, aHighest) + 1;
+
+    aHist->mCount = calloc(aHist->mCounts, sizeof(*aHist->mCount));
+    if (!aHist->mCount)
+        goto Finally;
+
+    aHist->mTotal = 0;
+    aHist->mMin   = UINT64_MAX;
+    aHist->mMax   = 0;
+    aHist->mSum   = 0;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+hdr_close(struct HdrHistogram *aHist)
+{
+    free(aHist->mCount);
+    aHist->mCount = 0;
+}
+
+/******************************************************************************/
+int
+hdr_record(struct HdrHistogram *aHist, uint64_t aValue)
+{
+    int rc = -1;
+
+    if (aValue > aHist->mHighest) {
+        errno = ERANGE;
+        goto Finally;
+    }
+
+    ++aHist->mCount[hdr_index_(aHist, aValue)];
+    ++aHist->mTotal;
+
+    aHist->mSum += aValue;
+
+    if (aValue < aHist->mMin)
+        aHist->mMin = aValue;
+    if (aValue > aHist->mMax)
+        aHist->mMax = aValue;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+hdr_percentile(const struct HdrHistogram *aHist, double aPercent)
+{
+    /* Find the smallest recorded value such that the given percentage
+     * of the recorded values are no larger, reporting the highest value
+     * that is equivalent at the recorded resolution, but no more than
+     * the largest value recorded. */
+
+    if (!aHist->mTotal)
+        return 0;
+
+    uint64_t rank = aPercent / 100 * aHist->mTotal + 0.5;
+
+    if (rank < 1)
+        rank = 1;
+    if (rank > aHist->mTotal)
+        rank = aHist->mTotal;
+
+    uint64_t count = 0;
+
+    for (unsigned ix = 0; ix < aHist->mCounts; ++ix) {
+        count += aHist->mCount[ix];
+
+        if (count >= rank) {
+            uint64_t value = hdr_value_(aHist, ix);
+
+            return value < aHist->mMax ? value : aHist->mMax;
+        }
+    }
+
+    return aHist->mMax;
+}
+
+/*----------------------------------------------------------------------------*/
+uint64_t
+hdr_mean(const struct HdrHistogram *aHist)
+{
+    return aHist->mTotal ? aHist->mSum / aHist->mTotal : 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,44 @@
+#ifndef HDR_H_
+#define HDR_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+/* A high dynamic range histogram records values with a fixed number
+ * of significant decimal digits across the whole range of values. The
+ * range is divided into buckets that are successive powers of two,
+ * and each bucket is divided linearly into sub-buckets. */
+
+struct HdrHistogram {
+    unsigned  mSubBucketBits;
+    unsigned  mCounts;
+    uint64_t *mCount;
+    uint64_t  mHighest;
+    uint64_t  mTotal;
+    uint64_t  mMin;
+    uint64_t  mMax;
+    uint64_t  mSum;
+};
+
+int hdr_init(struct HdrHistogram *aHist, uint64_t aHighest, unsigned aDigits);
+void hdr_close(struct HdrHistogram *aHist);
+
+int hdr_record(struct HdrHistogram *aHist, uint64_t aValue);
+uint64_t hdr_percentile(const struct HdrHistogram *aHist, double aPercent);
+uint64_t hdr_mean(const struct HdrHistogram *aHist);
+
+#endif
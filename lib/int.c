@@ -57,3 +57,95 @@ Finally:
 }
 
 /******************************************************************************/
+int
+int_strtol(long *aInteger, const char *aString)
+{
+    int rc = -1;
+
+    /* Accept an optional sign, and allow zero to be specified
+     * explicitly because signed values are often centred at zero. */
+
+    const char *digits = aString;
+
+    if ('-' == *digits || '+' == *digits)
+        ++digits;
+
+    if (!isdigit((unsigned char) *digits))
+        goto Finally;
+
+    char *endPtr;
+
+    errno = 0;
+    long value = strtol(aString, &endPtr, 10);
+
+    if (ERANGE == errno)
+        goto Finally;
+
+    if (*endPtr)
+        goto Finally;
+
+    *aInteger = value;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+int_strtosize(uint64_t *aSize, const char *aString)
+{
+    int rc = -1;
+
+    /* Accept a positive decimal size with an optional binary
+     * multiplier suffix of k, m, g or t. */
+
+    if (!isdigit((unsigned char) *aString))
+        goto Finally;
+
+    char *endPtr;
+
+    errno = 0;
+    unsigned long long value = strtoull(aString, &endPtr, 10);
+
+    if (ERANGE == errno || !value)
+        goto Finally;
+
+    unsigned shift = 0;
+
+    switch (tolower((unsigned char) *endPtr)) {
+    default:
+        goto Finally;
+    case 0:
+        break;
+    case 't':
+        shift += 10;
+        /* Fall through */
+    case 'g':
+        shift += 10;
+        /* Fall through */
+    case 'm':
+        shift += 10;
+        /* Fall through */
+    case 'k':
+        shift += 10;
+        if (endPtr[1])
+            goto Finally;
+        break;
+    }
+
+    if (value > (UINT64_MAX >> shift))
+        goto Finally;
+
+    *aSize = (uint64_t) value << shift;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
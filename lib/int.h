@@ -16,6 +16,10 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdint.h>
+
 int int_strtoul(unsigned long *aInteger, const char *aString);
+int int_strtol(long *aInteger, const char *aString);
+int int_strtosize(uint64_t *aSize, const char *aString);
 
 #endif
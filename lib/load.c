@@ -0,0 +1,411 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "load.h"
+
+#include "cgroup.h"
+#include "err.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+int
+load_cpu_pressure(unsigned *aPercent)
+{
+    int rc = -1;
+
+    FILE *pressureFile = 0;
+
+    /* Use the ten second average of the share of time that at least
+     * one runnable task was stalled waiting for a cpu. This is only
+     * available on Linux with PSI enabled. */
+
+    pressureFile = fopen("/proc/pressure/cpu", "r");
+    if (!pressureFile)
+        goto Finally;
+
+    double avg10;
+
+    if (1 != fscanf(pressureFile, "some avg10=%lf", &avg10)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    *aPercent = avg10 + 0.5;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (pressureFile)
+            fclose(pressureFile);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+static int
+load_backlog_file_(const char *aPath, unsigned aPort, unsigned *aBacklog)
+{
+    int rc = -1;
+
+    FILE *netFile = fopen(aPath, "r");
+    if (!netFile) {
+        if (ENOENT == errno)
+            rc = 0;
+        goto Finally;
+    }
+
+    /* For sockets in the LISTEN state, the receive queue reports the
+     * number of connections waiting to be accepted. Each line has the
+     * form: sl local_address rem_address st tx_queue:rx_queue ... */
+
+    char netLine[512];
+
+    if (!fgets(netLine, sizeof(netLine), netFile)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    while (fgets(netLine, sizeof(netLine), netFile)) {
+
+        char     localAddr[64];
+        unsigned localPort;
+        unsigned sockState;
+        unsigned txQueue;
+        unsigned rxQueue;
+
+        if (5 != sscanf(netLine, " %*u: %63[0-9A-Fa-f]:%x %*s %x %x:%x",
+                        localAddr, &localPort, &sockState, &txQueue, &rxQueue))
+            continue;
+
+        static const unsigned TcpListen = 0x0A;
+
+        if (TcpListen == sockState && aPort == localPort)
+            *aBacklog += rxQueue;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (netFile)
+            fclose(netFile);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+load_backlog(unsigned aPort, unsigned *aBacklog)
+{
+    int rc = -1;
+
+    *aBacklog = 0;
+
+    if (load_backlog_file_("/proc/net/tcp", aPort, aBacklog))
+        goto Finally;
+
+    if (load_backlog_file_("/proc/net/tcp6", aPort, aBacklog))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+static int
+load_cgroup_(pid_t aPid, char *aDir, size_t aLen)
+{
+    int rc = -1;
+
+    /* Find the cgroup directory of the process, but only if the
+     * process has a cgroup of its own so that the cgroup accounts
+     * for the process and its descendants alone. */
+
+    char childCgroup[PATH_MAX];
+    char selfCgroup[PATH_MAX];
+
+    const char *mountPath = cgroup_mount();
+    if (!mountPath)
+        goto Finally;
+
+    if (cgroup_find(aPid, childCgroup, sizeof(childCgroup)))
+        goto Finally;
+
+    if (cgroup_find(0, selfCgroup, sizeof(selfCgroup)))
+        goto Finally;
+
+    if (!strcmp(childCgroup, selfCgroup)) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    if (aLen <= snprintf(aDir, aLen, "%s%s", mountPath, childCgroup)) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+load_memory(pid_t aPid, uint64_t *aBytes)
+{
+    int rc = -1;
+
+    FILE *memoryFile = 0;
+
+    /* If the process has a cgroup of its own, the memory charged to
+     * the cgroup includes the page cache and kernel memory used by the
+     * process and its descendants. Otherwise fall back to the resident
+     * set size of the process itself. */
+
+    char cgroupDir[PATH_MAX];
+
+    if (!load_cgroup_(aPid, cgroupDir, sizeof(cgroupDir))) {
+
+        char memoryPath[sizeof("/memory.current") + PATH_MAX];
+
+        snprintf(memoryPath, sizeof(memoryPath),
+            "%s/memory.current", cgroupDir);
+
+        memoryFile = fopen(memoryPath, "r");
+        if (memoryFile) {
+            if (1 != fscanf(memoryFile, "%" SCNu64, aBytes)) {
+                errno = EINVAL;
+                goto Finally;
+            }
+
+            rc = 0;
+            goto Finally;
+        }
+    }
+
+    char statmPath[sizeof("/proc//statm") + sizeof(pid_t) * CHAR_BIT];
+
+    snprintf(statmPath, sizeof(statmPath), "/proc/%d/statm", aPid);
+
+    memoryFile = fopen(statmPath, "r");
+    if (!memoryFile)
+        goto Finally;
+
+    unsigned long residentPages;
+
+    if (1 != fscanf(memoryFile, "%*u %lu", &residentPages)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    *aBytes = (uint64_t) residentPages * sysconf(_SC_PAGESIZE);
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (memoryFile)
+            fclose(memoryFile);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+load_cpu(pid_t aPid, uint64_t *aMicros)
+{
+    int rc = -1;
+
+    FILE *statFile = 0;
+
+    /* If the process has a cgroup of its own, the cgroup accounts for
+     * the cpu time of the process and all its descendants. Otherwise
+     * use the cpu time of the process, and that of the children it
+     * has reaped. */
+
+    char cgroupDir[PATH_MAX];
+
+    if (!load_cgroup_(aPid, cgroupDir, sizeof(cgroupDir)) &&
+            !cgroup_stat(cgroupDir, "cpu.stat", "usage_usec", aMicros)) {
+        rc = 0;
+        goto Finally;
+    }
+
+    char statPath[sizeof("/proc//stat") + sizeof(pid_t) * CHAR_BIT];
+
+    snprintf(statPath, sizeof(statPath), "/proc/%d/stat", aPid);
+
+    statFile = fopen(statPath, "r");
+    if (!statFile)
+        goto Finally;
+
+    /* The command name in the second field is parenthesised, but might
+     * itself contain spaces and parentheses, so skip to the last
+     * closing parenthesis before parsing the numeric fields. */
+
+    char statLine[1024];
+
+    if (!fgets(statLine, sizeof(statLine), statFile)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    const char *fields = strrchr(statLine, ')');
+    if (!fields) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    unsigned long long userTicks;
+    unsigned long long systemTicks;
+    unsigned long long childUserTicks;
+    unsigned long long childSystemTicks;
+
+    if (4 != sscanf(fields + 1,
+                    " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u"
+                    " %llu %llu %llu %llu",
+                    &userTicks, &systemTicks,
+                    &childUserTicks, &childSystemTicks)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    long ticksPerSecond = sysconf(_SC_CLK_TCK);
+
+    *aMicros =
+        (userTicks + systemTicks + childUserTicks + childSystemTicks) *
+        1000000 / ticksPerSecond;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (statFile)
+            fclose(statFile);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+load_io(pid_t aPid, uint64_t *aBytes)
+{
+    int rc = -1;
+
+    FILE *ioFile = 0;
+
+    /* If the process has a cgroup of its own with the io controller
+     * enabled, sum the bytes read and written on each device by the
+     * process and its descendants. Each line has the form:
+     * major:minor rbytes=N wbytes=N ... */
+
+    char cgroupDir[PATH_MAX];
+
+    if (!load_cgroup_(aPid, cgroupDir, sizeof(cgroupDir))) {
+
+        char ioPath[sizeof("/io.stat") + PATH_MAX];
+
+        snprintf(ioPath, sizeof(ioPath), "%s/io.stat", cgroupDir);
+
+        ioFile = fopen(ioPath, "r");
+        if (ioFile) {
+            char ioLine[512];
+
+            *aBytes = 0;
+
+            while (fgets(ioLine, sizeof(ioLine), ioFile)) {
+                uint64_t readBytes;
+                uint64_t writeBytes;
+
+                if (2 == sscanf(ioLine,
+                                "%*u:%*u rbytes=%" SCNu64 " wbytes=%" SCNu64,
+                                &readBytes, &writeBytes))
+                    *aBytes += readBytes + writeBytes;
+            }
+
+            rc = 0;
+            goto Finally;
+        }
+    }
+
+    /* Otherwise use the storage bytes read and written by the process
+     * itself, which excludes reads satisfied by the page cache. */
+
+    char ioPath[sizeof("/proc//io") + sizeof(pid_t) * CHAR_BIT];
+
+    snprintf(ioPath, sizeof(ioPath), "/proc/%d/io", aPid);
+
+    ioFile = fopen(ioPath, "r");
+    if (!ioFile)
+        goto Finally;
+
+    char ioLine[128];
+
+    uint64_t ioBytes = 0;
+    unsigned ioFields = 0;
+
+    while (fgets(ioLine, sizeof(ioLine), ioFile)) {
+        uint64_t fieldBytes;
+
+        if (1 == sscanf(ioLine, "read_bytes: %" SCNu64, &fieldBytes) ||
+                1 == sscanf(ioLine, "write_bytes: %" SCNu64, &fieldBytes)) {
+            ioBytes += fieldBytes;
+            ++ioFields;
+        }
+    }
+
+    if (2 != ioFields) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    *aBytes = ioBytes;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (ioFile)
+            fclose(ioFile);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
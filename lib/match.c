@@ -0,0 +1,297 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "match.h"
+
+#include "err.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Each transition holds the index of the target state multiplied by
+ * the size of the alphabet, so that the scan avoids a multiplication,
+ * and uses the top bit to flag target states that report a match. */
+
+#define MATCH_ALPHABET 256
+#define MATCH_OUTPUT   0x80000000u
+#define MATCH_NONE     0xffffffffu
+
+/******************************************************************************/
+int
+match_init(struct Matcher *aMatcher)
+{
+    int rc = -1;
+
+    memset(aMatcher, 0, sizeof(*aMatcher));
+
+    /* Start with the root state of the trie. */
+
+    aMatcher->mNext   = malloc(MATCH_ALPHABET * sizeof(*aMatcher->mNext));
+    aMatcher->mOutput = malloc(sizeof(*aMatcher->mOutput));
+
+    if (!aMatcher->mNext || !aMatcher->mOutput)
+        goto Finally;
+
+    for (unsigned ix = 0; ix < MATCH_ALPHABET; ++ix)
+        aMatcher->mNext[ix] = MATCH_NONE;
+
+    aMatcher->mOutput[0] = 0;
+    aMatcher->mStates    = 1;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc)
+            match_close(aMatcher);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+match_close(struct Matcher *aMatcher)
+{
+    free(aMatcher->mNext);
+    free(aMatcher->mOutput);
+
+    aMatcher->mNext   = 0;
+    aMatcher->mOutput = 0;
+
+    return 0;
+}
+
+/******************************************************************************/
+static int
+match_grow_(struct Matcher *aMatcher)
+{
+    int rc = -1;
+
+    unsigned states = aMatcher->mStates + 1;
+
+    if (states > (MATCH_OUTPUT - 1) / MATCH_ALPHABET) {
+        errno = ERANGE;
+        goto Finally;
+    }
+
+    uint32_t *next = realloc(
+        aMatcher->mNext, states * MATCH_ALPHABET * sizeof(*next));
+    if (!next)
+        goto Finally;
+    aMatcher->mNext = next;
+
+    uint32_t *output = realloc(
+        aMatcher->mOutput, states * sizeof(*output));
+    if (!output)
+        goto Finally;
+    aMatcher->mOutput = output;
+
+    uint32_t *stateNext = &next[aMatcher->mStates * MATCH_ALPHABET];
+
+    for (unsigned ix = 0; ix < MATCH_ALPHABET; ++ix)
+        stateNext[ix] = MATCH_NONE;
+
+    output[aMatcher->mStates] = 0;
+
+    rc = aMatcher->mStates++;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+match_add(struct Matcher *aMatcher, const char *aPattern)
+{
+    int rc = -1;
+
+    if (aMatcher->mCompiled || !*aPattern) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    if (MATCH_PATTERN_MAX <= aMatcher->mPatterns) {
+        errno = ERANGE;
+        goto Finally;
+    }
+
+    /* Extend the trie with the pattern, and record the pattern in the
+     * output of the final state. */
+
+    unsigned state = 0;
+
+    for (const unsigned char *ch = (const void *) aPattern; *ch; ++ch) {
+
+        uint32_t *next = &aMatcher->mNext[state * MATCH_ALPHABET + *ch];
+
+        if (MATCH_NONE != *next) {
+            state = *next / MATCH_ALPHABET;
+        } else {
+            int nextState = match_grow_(aMatcher);
+            if (-1 == nextState)
+                goto Finally;
+
+            aMatcher->mNext[state * MATCH_ALPHABET + *ch] =
+                nextState * MATCH_ALPHABET;
+
+            state = nextState;
+        }
+    }
+
+    aMatcher->mOutput[state] |= 1u << aMatcher->mPatterns;
+
+    rc = aMatcher->mPatterns++;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+match_compile(struct Matcher *aMatcher)
+{
+    int rc = -1;
+
+    unsigned *failure = 0;
+    unsigned *queue   = 0;
+
+    unsigned states = aMatcher->mStates;
+
+    failure = malloc(states * sizeof(*failure));
+    queue   = malloc(states * sizeof(*queue));
+
+    if (!failure || !queue)
+        goto Finally;
+
+    uint32_t *next = aMatcher->mNext;
+
+    /* Visit the states breadth first so that the failure state of each
+     * state is complete before it is used. Missing transitions are
+     * replaced by the transitions of the failure state, which turns the
+     * trie into a deterministic automaton. */
+
+    unsigned head = 0;
+    unsigned tail = 0;
+
+    for (unsigned ch = 0; ch < MATCH_ALPHABET; ++ch) {
+        if (MATCH_NONE == next[ch]) {
+            next[ch] = 0;
+        } else {
+            unsigned child = next[ch] / MATCH_ALPHABET;
+
+            failure[child] = 0;
+            queue[tail++]  = child;
+
+            aMatcher->mStart[ch] = 1;
+        }
+    }
+
+    while (head < tail) {
+        unsigned state = queue[head++];
+
+        uint32_t *stateNext   = &next[state * MATCH_ALPHABET];
+        uint32_t *failureNext = &next[failure[state] * MATCH_ALPHABET];
+
+        aMatcher->mOutput[state] |= aMatcher->mOutput[failure[state]];
+
+        for (unsigned ch = 0; ch < MATCH_ALPHABET; ++ch) {
+            if (MATCH_NONE == stateNext[ch]) {
+                stateNext[ch] = failureNext[ch];
+            } else {
+                unsigned child = stateNext[ch] / MATCH_ALPHABET;
+
+                failure[child] = failureNext[ch] / MATCH_ALPHABET;
+                queue[tail++]  = child;
+            }
+        }
+    }
+
+    /* Flag the transitions to states that report a match so that the
+     * scan only consults the output when there is a match. */
+
+    for (unsigned ix = 0; ix < states * MATCH_ALPHABET; ++ix) {
+        unsigned target = next[ix] / MATCH_ALPHABET;
+
+        if (aMatcher->mOutput[target])
+            next[ix] |= MATCH_OUTPUT;
+    }
+
+    aMatcher->mCompiled = 1;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        free(failure);
+        free(queue);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+uint32_t
+match_scan(
+    const struct Matcher *aMatcher,
+    uint32_t *aState, const char *aBuf, size_t aLen)
+{
+    uint32_t matched = 0;
+
+    const uint32_t      *next    = aMatcher->mNext;
+    const uint32_t      *output  = aMatcher->mOutput;
+    const uint8_t       *start   = aMatcher->mStart;
+    const unsigned char *bufPtr  = (const void *) aBuf;
+    const unsigned char *bufEnd  = bufPtr + aLen;
+
+    uint32_t state = *aState;
+
+    while (bufPtr != bufEnd) {
+
+        /* Most of the stream does not begin any pattern, so skip
+         * quickly past those bytes while the automaton is at the root
+         * without following the chain of transitions. */
+
+        if (!state) {
+            while (!start[*bufPtr]) {
+                if (++bufPtr == bufEnd)
+                    goto Finally;
+            }
+        }
+
+        state = next[state + *bufPtr++];
+
+        if (state & MATCH_OUTPUT) {
+            state &= ~MATCH_OUTPUT;
+            matched |= output[state / MATCH_ALPHABET];
+        }
+    }
+
+Finally:
+
+    *aState = state;
+
+    return matched;
+}
+
+/******************************************************************************/
@@ -0,0 +1,47 @@
+#ifndef MATCH_H_
+#define MATCH_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Match a set of literal patterns against a stream using Aho-Corasick
+ * compiled to a dense automaton. The scan reports the set of patterns
+ * that matched as a bitmask, and the state of the automaton is carried
+ * between successive buffers of the stream. */
+
+#define MATCH_PATTERN_MAX 32
+
+struct Matcher {
+    unsigned  mPatterns;
+    unsigned  mStates;
+    unsigned  mCompiled;
+    uint32_t *mNext;
+    uint32_t *mOutput;
+    uint8_t   mStart[256];
+};
+
+int match_init(struct Matcher *aMatcher);
+int match_add(struct Matcher *aMatcher, const char *aPattern);
+int match_compile(struct Matcher *aMatcher);
+int match_close(struct Matcher *aMatcher);
+
+uint32_t match_scan(
+    const struct Matcher *aMatcher,
+    uint32_t *aState, const char *aBuf, size_t aLen);
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "notify.h"
+
+#include "err.h"
+#include "fd.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/******************************************************************************/
+int
+notify_create(int aNotifyFd[2])
+{
+    int rc = -1;
+
+    int sockFds[2] = { -1, -1 };
+
+    /* Use a datagram socket so that each notification from the child
+     * arrives intact, and so that descriptors can be passed using
+     * SCM_RIGHTS. The supervisor retains both ends so that the channel
+     * survives the restart of the child process. */
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockFds))
+        goto Finally;
+
+    if (fd_cloexec(sockFds[0]) || fd_cloexec(sockFds[1]))
+        goto Finally;
+
+    aNotifyFd[0] = sockFds[0];
+    aNotifyFd[1] = sockFds[1];
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc) {
+            sockFds[0] = fd_close(sockFds[0]);
+            sockFds[1] = fd_close(sockFds[1]);
+        }
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+notify_share(const int aNotifyFd[2], int aShare)
+{
+    int rc = -1;
+
+    for (unsigned ix = 0; ix < 2; ++ix) {
+        if (-1 == aNotifyFd[ix])
+            continue;
+
+        if (aShare) {
+            if (fd_inherit(aNotifyFd[ix]))
+                goto Finally;
+        } else {
+            if (fd_cloexec(aNotifyFd[ix]))
+                goto Finally;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+notify_send(int aFd, const char *aMsg)
+{
+    int rc = -1;
+
+    /* Never block the sender. If the receiver is not keeping up, the
+     * notification is discarded. */
+
+    ssize_t txLen;
+
+    do
+        txLen = send(aFd, aMsg, strlen(aMsg), MSG_DONTWAIT);
+    while (-1 == txLen && EINTR == errno);
+
+    if (-1 == txLen)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+ssize_t
+notify_receive(int aFd, char *aBuf, size_t aLen, int *aRxFd)
+{
+    int rc = -1;
+
+    ssize_t rxLen = -1;
+
+    *aRxFd = -1;
+
+    union {
+        struct cmsghdr mAlign;
+        char           mBuf[CMSG_SPACE(sizeof(int) * 8)];
+    } ctlBuf;
+
+    struct iovec rxVec;
+    rxVec.iov_base = aBuf;
+    rxVec.iov_len  = aLen - 1;
+
+    struct msghdr rxMsg;
+    memset(&rxMsg, 0, sizeof(rxMsg));
+    rxMsg.msg_iov        = &rxVec;
+    rxMsg.msg_iovlen     = 1;
+    rxMsg.msg_control    = ctlBuf.mBuf;
+    rxMsg.msg_controllen = sizeof(ctlBuf.mBuf);
+
+    do
+        rxLen = recvmsg(aFd, &rxMsg, MSG_DONTWAIT);
+    while (-1 == rxLen && EINTR == errno);
+
+    if (-1 == rxLen) {
+        if (EAGAIN != errno && EWOULDBLOCK != errno)
+            goto Finally;
+
+        aBuf[0] = 0;
+
+        rxLen = 0;
+        rc = 0;
+        goto Finally;
+    }
+
+    aBuf[rxLen] = 0;
+
+    /* Only a single descriptor is accepted with each notification.
+     * Close any others so that they do not leak into the supervisor. */
+
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(&rxMsg); cmsg; cmsg = CMSG_NXTHDR(&rxMsg, cmsg)) {
+        if (SOL_SOCKET != cmsg->cmsg_level || SCM_RIGHTS != cmsg->cmsg_type)
+            continue;
+
+        unsigned numFds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+        for (unsigned ix = 0; ix < numFds; ++ix) {
+            int rxFd;
+
+            memcpy(&rxFd, CMSG_DATA(cmsg) + ix * sizeof(int), sizeof(rxFd));
+
+            if (-1 == *aRxFd && !fd_cloexec(rxFd))
+                *aRxFd = rxFd;
+            else {
+                DEBUG("Discarding notification fd %d", rxFd);
+                fd_close(rxFd);
+            }
+        }
+    }
+
+    if (rxMsg.msg_flags & MSG_CTRUNC) {
+        DEBUG("Notification control data truncated");
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : rxLen;
+}
+
+/******************************************************************************/
@@ -0,0 +1,428 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "probe.h"
+
+#include "err.h"
+#include "fd.h"
+#include "int.h"
+#include "proc.h"
+#include "sock.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/******************************************************************************/
+static void
+probe_unescape_(char *aText)
+{
+    /* Allow payloads to include line endings required by the protocol
+     * using the familiar escapes. */
+
+    char *dst = aText;
+
+    for (const char *src = aText; *src; ++src) {
+        if ('\\' == src[0] && src[1]) {
+            switch (*++src) {
+            default:   *dst++ = '\\'; *dst++ = *src; break;
+            case 'n':  *dst++ = '\n'; break;
+            case 'r':  *dst++ = '\r'; break;
+            case 't':  *dst++ = '\t'; break;
+            case '\\': *dst++ = '\\'; break;
+            }
+        } else {
+            *dst++ = *src;
+        }
+    }
+
+    *dst = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+probe_parse(struct Probe *aProbe, const char *aSpec)
+{
+    int rc = -1;
+
+    memset(aProbe, 0, sizeof(*aProbe));
+
+    aProbe->mFd  = -1;
+    aProbe->mPid = 0;
+
+    aProbe->mIntervalMillis = 1000;
+    aProbe->mTimeoutMillis  = 1000;
+    aProbe->mFailureLimit   = 3;
+
+    aProbe->mText = strdup(aSpec);
+    if (!aProbe->mText)
+        goto Finally;
+
+    /* The probe comprises optional key=value settings separated by
+     * commas, followed by the target. The target is the remainder of
+     * the specification so that an exec command can contain commas. */
+
+    char *specPtr = aProbe->mText;
+
+    while (1) {
+        char *valueSep = strchr(specPtr, '=');
+        char *wordSep  = strchr(specPtr, ',');
+
+        if (!valueSep || !wordSep || wordSep < valueSep)
+            break;
+
+        *valueSep++ = 0;
+        *wordSep++  = 0;
+
+        unsigned long value = 0;
+
+        if (!strcmp("send", specPtr)) {
+            probe_unescape_(valueSep);
+            aProbe->mSend = valueSep;
+        } else if (!strcmp("expect", specPtr)) {
+            probe_unescape_(valueSep);
+            aProbe->mExpect = valueSep;
+        } else if (int_strtoul(&value, valueSep) || value > 3600 * 1000) {
+            errno = EINVAL;
+            goto Finally;
+        } else if (!strcmp("interval", specPtr)) {
+            aProbe->mIntervalMillis = value;
+        } else if (!strcmp("timeout", specPtr)) {
+            aProbe->mTimeoutMillis = value;
+        } else if (!strcmp("failures", specPtr)) {
+            aProbe->mFailureLimit = value;
+        } else {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        specPtr = wordSep;
+    }
+
+    if (!strncmp("exec:", specPtr, 5)) {
+        aProbe->mExec   = 1;
+        aProbe->mTarget = specPtr + 5;
+
+        if (aProbe->mSend || aProbe->mExpect) {
+            errno = EINVAL;
+            goto Finally;
+        }
+    } else {
+        aProbe->mTarget = specPtr;
+    }
+
+    if (!*aProbe->mTarget) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc) {
+            free(aProbe->mText);
+            aProbe->mText = 0;
+        }
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+static void
+probe_cancel_(struct Probe *aProbe)
+{
+    aProbe->mFd = fd_close(aProbe->mFd);
+
+    /* An exec probe runs in its own process group so that the entire
+     * probe can be killed when it exceeds the timeout. */
+
+    if (aProbe->mPid) {
+        kill(-aProbe->mPid, SIGKILL);
+        kill(aProbe->mPid, SIGKILL);
+
+        while (-1 == waitpid(aProbe->mPid, 0, 0) && EINTR == errno)
+            ;
+
+        aProbe->mPid = 0;
+    }
+
+    aProbe->mConnected = 0;
+    aProbe->mReplyLen  = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+probe_complete_(struct Probe *aProbe, int aSuccess, uint64_t aNowMillis)
+{
+    probe_cancel_(aProbe);
+
+    if (aSuccess) {
+        aProbe->mFailures = 0;
+    } else {
+        ++aProbe->mFailures;
+
+        DEBUG("Probe %s failed after %" PRIu64 "ms count %u",
+            aProbe->mTarget,
+            aNowMillis - aProbe->mStartMillis, aProbe->mFailures);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+probe_prepare_(void *aArg)
+{
+    return setpgid(0, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+probe_start_(struct Probe *aProbe, uint64_t aNowMillis)
+{
+    /* Probes are started at a fixed rate, regardless of how long each
+     * probe takes to complete. */
+
+    aProbe->mStartMillis = aNowMillis;
+    aProbe->mDueMillis  += aProbe->mIntervalMillis;
+
+    if (aProbe->mDueMillis <= aNowMillis)
+        aProbe->mDueMillis = aNowMillis + aProbe->mIntervalMillis;
+
+    if (aProbe->mExec) {
+
+        char *probeCmd[] = {
+            "/bin/sh", "-c", (char *) aProbe->mTarget, 0 };
+
+        pid_t probePid = proc_execute(probeCmd, probe_prepare_, 0);
+
+        if (-1 == probePid)
+            probe_complete_(aProbe, 0, aNowMillis);
+        else
+            aProbe->mPid = probePid;
+
+    } else {
+
+        aProbe->mFd = sock_connect(aProbe->mTarget);
+
+        if (-1 == aProbe->mFd)
+            probe_complete_(aProbe, 0, aNowMillis);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void
+probe_advance_(struct Probe *aProbe, short aEvents, uint64_t aNowMillis)
+{
+    /* Complete the connection, then send the payload, and finally
+     * collect the reply until it matches the expected text. */
+
+    if (!aProbe->mConnected) {
+
+        if (!(aEvents & (POLLOUT | POLLERR | POLLHUP)))
+            return;
+
+        if (sock_error(aProbe->mFd)) {
+            probe_complete_(aProbe, 0, aNowMillis);
+            return;
+        }
+
+        aProbe->mConnected = 1;
+
+        if (aProbe->mSend) {
+            size_t sendLen = strlen(aProbe->mSend);
+
+            if (sendLen != send(
+                    aProbe->mFd, aProbe->mSend, sendLen, MSG_NOSIGNAL)) {
+                probe_complete_(aProbe, 0, aNowMillis);
+                return;
+            }
+        }
+
+        if (!aProbe->mExpect)
+            probe_complete_(aProbe, 1, aNowMillis);
+
+        return;
+    }
+
+    if (!(aEvents & (POLLIN | POLLERR | POLLHUP)))
+        return;
+
+    size_t replySpace = sizeof(aProbe->mReply) - 1 - aProbe->mReplyLen;
+
+    ssize_t replyLen = recv(
+        aProbe->mFd, aProbe->mReply + aProbe->mReplyLen, replySpace, 0);
+
+    if (-1 == replyLen) {
+        if (EAGAIN != errno && EINTR != errno)
+            probe_complete_(aProbe, 0, aNowMillis);
+        return;
+    }
+
+    aProbe->mReplyLen += replyLen;
+    aProbe->mReply[aProbe->mReplyLen] = 0;
+
+    if (strstr(aProbe->mReply, aProbe->mExpect))
+        probe_complete_(aProbe, 1, aNowMillis);
+    else if (!replyLen || aProbe->mReplyLen == sizeof(aProbe->mReply) - 1)
+        probe_complete_(aProbe, 0, aNowMillis);
+}
+
+/******************************************************************************/
+void
+probe_reset(struct Probe *aProbe, unsigned aCount, uint64_t aNowMillis)
+{
+    /* Allow the child process an interval to initialise before it
+     * is first probed. */
+
+    for (unsigned ix = 0; ix < aCount; ++ix) {
+        probe_cancel_(&aProbe[ix]);
+
+        aProbe[ix].mFailures  = 0;
+        aProbe[ix].mDueMillis = aNowMillis + aProbe[ix].mIntervalMillis;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int
+probe_run(struct Probe *aProbe, unsigned aCount, uint64_t aNowMillis)
+{
+    int rc = -1;
+
+    /* Check the progress of all the socket probes using a single
+     * system call, before considering timeouts, so that a probe that
+     * completed just before its deadline is not counted as failed. */
+
+    struct pollfd pollFd[aCount ? aCount : 1];
+
+    nfds_t pollCount = 0;
+
+    for (unsigned ix = 0; ix < aCount; ++ix) {
+        if (-1 != aProbe[ix].mFd) {
+            pollFd[pollCount].fd      = aProbe[ix].mFd;
+            pollFd[pollCount].events  = aProbe[ix].mConnected ? POLLIN : POLLOUT;
+            pollFd[pollCount].revents = 0;
+            ++pollCount;
+        }
+    }
+
+    if (pollCount) {
+        int pollRc;
+
+        do
+            pollRc = poll(pollFd, pollCount, 0);
+        while (-1 == pollRc && EINTR == errno);
+
+        if (-1 == pollRc)
+            goto Finally;
+    }
+
+    for (unsigned ix = 0, px = 0; ix < aCount; ++ix) {
+
+        struct Probe *probe = &aProbe[ix];
+
+        if (-1 != probe->mFd) {
+            short pollEvents = pollFd[px++].revents;
+
+            if (pollEvents)
+                probe_advance_(probe, pollEvents, aNowMillis);
+        }
+
+        if (probe->mPid) {
+            int probeStatus;
+
+            pid_t pid = waitpid(probe->mPid, &probeStatus, WNOHANG);
+            if (-1 == pid)
+                goto Finally;
+
+            if (pid) {
+                probe->mPid = 0;
+                probe_complete_(
+                    probe,
+                    WIFEXITED(probeStatus) && !WEXITSTATUS(probeStatus),
+                    aNowMillis);
+            }
+        }
+
+        int running = -1 != probe->mFd || probe->mPid;
+
+        if (running) {
+            if (aNowMillis - probe->mStartMillis >= probe->mTimeoutMillis)
+                probe_complete_(probe, 0, aNowMillis);
+        } else if (aNowMillis >= probe->mDueMillis) {
+            probe_start_(probe, aNowMillis);
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+probe_wait(const struct Probe *aProbe, unsigned aCount, uint64_t aNowMillis)
+{
+    int waitMillis = -1;
+
+    /* Compute the time until the earliest deadline, either the timeout
+     * of a running probe, or the start of the next probe. */
+
+    for (unsigned ix = 0; ix < aCount; ++ix) {
+
+        const struct Probe *probe = &aProbe[ix];
+
+        uint64_t deadlineMillis =
+            (-1 != probe->mFd || probe->mPid)
+                ? probe->mStartMillis + probe->mTimeoutMillis
+                : probe->mDueMillis;
+
+        uint64_t probeMillis =
+            deadlineMillis > aNowMillis ? deadlineMillis - aNowMillis : 0;
+
+        if (-1 == waitMillis || probeMillis < waitMillis)
+            waitMillis = probeMillis;
+    }
+
+    return waitMillis;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+probe_failed(const struct Probe *aProbe, unsigned aCount)
+{
+    for (unsigned ix = 0; ix < aCount; ++ix) {
+        if (aProbe[ix].mFailureLimit &&
+                aProbe[ix].mFailures >= aProbe[ix].mFailureLimit)
+            return 1;
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,55 @@
+#ifndef PROBE_H_
+#define PROBE_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#define PROBE_REPLY_MAX 256
+
+struct Probe {
+    char       *mText;
+    const char *mTarget;
+    const char *mSend;
+    const char *mExpect;
+    int         mExec;
+
+    unsigned mIntervalMillis;
+    unsigned mTimeoutMillis;
+    unsigned mFailureLimit;
+
+    int      mFd;
+    pid_t    mPid;
+    int      mConnected;
+    uint64_t mStartMillis;
+    uint64_t mDueMillis;
+    unsigned mFailures;
+
+    size_t mReplyLen;
+    char   mReply[PROBE_REPLY_MAX];
+};
+
+int probe_parse(struct Probe *aProbe, const char *aSpec);
+
+void probe_reset(struct Probe *aProbe, unsigned aCount, uint64_t aNowMillis);
+int  probe_run(struct Probe *aProbe, unsigned aCount, uint64_t aNowMillis);
+int  probe_wait(const struct Probe *aProbe, unsigned aCount, uint64_t aNowMillis);
+int  probe_failed(const struct Probe *aProbe, unsigned aCount);
+
+#endif
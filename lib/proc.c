@@ -18,17 +18,20 @@
 
 #include "err.h"
 #include "fd.h"
+#include "macros.h"
 
+#include <errno.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <sys/event.h>
 #include <sys/wait.h>
 
 /******************************************************************************/
-pid_t
-proc_execute(char **aCmd)
+static pid_t
+proc_execute_(char **aCmd, int (*aPrepare)(void *aArg), void *aArg)
 {
     int rc = -1;
 
@@ -65,6 +68,20 @@ proc_execute(char **aCmd)
 
     if (!childPid) {
 
+        /* Allow the caller to configure the child process before the
+         * program is executed. A failure is reported in the same way
+         * as a failure to execute the program. */
+
+        if (aPrepare && aPrepare(aArg)) {
+            int errCode = errno;
+
+            error("Unable to prepare %s", aCmd[0]);
+
+            fd_write(pipeWr, (void *) &errCode, sizeof(errCode));
+
+            _exit(EXIT_FAILURE);
+        }
+
         /* Signals that are being caught will revert to their default
          * action as described in execve(2). */
 
@@ -127,7 +144,7 @@ Finally:
 }
 
 /******************************************************************************/
-int proc_monitor_create(pid_t aParentPid)
+int proc_monitor_create(pid_t aParentPid, const sigset_t *aSigSet)
 {
     int rc = -1;
 
@@ -135,6 +152,9 @@ int proc_monitor_create(pid_t aParentPid)
     if (-1 == monitorFd)
         goto Finally;
 
+    if (fd_cloexec(monitorFd))
+        goto Finally;
+
     struct kevent kevs[2];
 
     struct kevent *kevp = kevs;
@@ -158,6 +178,23 @@ int proc_monitor_create(pid_t aParentPid)
     if (-1 == kevent(monitorFd, kevs, nkevs, 0, 0, 0))
         goto Finally;
 
+    /* Wake the monitor for each caught signal, so that a signal that
+     * arrives after the caller samples its signal set, but before it
+     * waits, is not left pending until the next event. */
+
+    for (int signal = 1; aSigSet && signal < NSIG; ++signal) {
+
+        if (SIGCHLD == signal || 1 != sigismember(aSigSet, signal))
+            continue;
+
+        struct kevent kev;
+
+        EV_SET(&kev, signal, EVFILT_SIGNAL, EV_ADD | EV_ENABLE, 0, 0, 0);
+
+        if (-1 == kevent(monitorFd, &kev, 1, 0, 0, 0))
+            goto Finally;
+    }
+
     rc = 0;
 
 Finally:
@@ -172,28 +209,98 @@ Finally:
 }
 
 /*----------------------------------------------------------------------------*/
-int proc_monitor_wait(int aMonitorFd)
+int proc_monitor_watch(int aMonitorFd, int aFd, int aEdge)
+{
+    int rc = -1;
+
+    /* Wake the monitor when the descriptor becomes readable. Level
+     * triggered descriptors must be drained by the caller after each
+     * wakeup, whereas edge triggered descriptors only report
+     * new activity. */
+
+    struct kevent kev;
+
+    EV_SET(&kev, aFd,
+        EVFILT_READ, EV_ADD | EV_ENABLE | (aEdge ? EV_CLEAR : 0),
+        0, 0, 0);
+
+    if (-1 == kevent(aMonitorFd, &kev, 1, 0, 0, 0))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int proc_monitor_oneshot(int aMonitorFd, int aFd, int aWrite)
 {
     int rc = -1;
 
-    int ident = 0;
+    /* Wake the monitor once when the descriptor becomes readable, or
+     * writable. The registration is removed after it fires, or when
+     * the descriptor is closed, so the caller re-registers interest
+     * each time that it waits. */
 
     struct kevent kev;
-    int kevents = kevent(aMonitorFd, 0, 0, &kev, 1, 0);
+
+    EV_SET(&kev, aFd,
+        aWrite ? EVFILT_WRITE : EVFILT_READ, EV_ADD | EV_ENABLE | EV_ONESHOT,
+        0, 0, 0);
+
+    if (-1 == kevent(aMonitorFd, &kev, 1, 0, 0, 0))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static int proc_monitor_wait_(
+    int aMonitorFd, int aTimeoutMillis, struct ProcMonitorEvent *aEvent)
+{
+    int rc = -1;
+
+    aEvent->mParentPid = 0;
+    aEvent->mFds       = 0;
+
+    struct timespec timeout;
+    struct timespec *timeoutPtr = 0;
+
+    if (0 <= aTimeoutMillis) {
+        timeout.tv_sec  = aTimeoutMillis / 1000;
+        timeout.tv_nsec = aTimeoutMillis % 1000 * 1000000L;
+
+        timeoutPtr = &timeout;
+    }
+
+    struct kevent kevs[PROC_MONITOR_BATCH];
+    int kevents = kevent(aMonitorFd, 0, 0, kevs, NUMBEROF(kevs), timeoutPtr);
 
     if (-1 == kevents) {
         if (EINTR != errno)
             goto Finally;
     } else {
-        if (kevents && EVFILT_PROC == kev.filter)
-            ident = kev.ident;
+        for (int ix = 0; ix < kevents; ++ix) {
+            struct kevent *kev = &kevs[ix];
+
+            if (EVFILT_PROC == kev->filter)
+                aEvent->mParentPid = kev->ident;
+            else if (EVFILT_READ == kev->filter || EVFILT_WRITE == kev->filter)
+                aEvent->mFd[aEvent->mFds++] = kev->ident;
+        }
     }
 
     rc = 0;
 
 Finally:
 
-    return rc ? rc : ident;
+    return rc;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -205,3 +312,61 @@ int proc_monitor_close(int aMonitorFd)
 }
 
 /******************************************************************************/
+static pid_t
+proc_wait_(pid_t aPid, int *aStatus, int aOptions, struct rusage *aUsage)
+{
+    return wait4(aPid, aStatus, aOptions, aUsage);
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+proc_kill_(pid_t aPid, int aSignal)
+{
+    return kill(aPid, aSignal);
+}
+
+/*----------------------------------------------------------------------------*/
+static const struct ProcSource SystemSource = {
+    .mExecute     = proc_execute_,
+    .mWait        = proc_wait_,
+    .mKill        = proc_kill_,
+    .mMonitorWait = proc_monitor_wait_,
+};
+
+static const struct ProcSource *ActiveSource = &SystemSource;
+
+void
+proc_source(const struct ProcSource *aSource)
+{
+    ActiveSource = aSource ? aSource : &SystemSource;
+}
+
+/*----------------------------------------------------------------------------*/
+pid_t
+proc_execute(char **aCmd, int (*aPrepare)(void *aArg), void *aArg)
+{
+    return ActiveSource->mExecute(aCmd, aPrepare, aArg);
+}
+
+/*----------------------------------------------------------------------------*/
+pid_t
+proc_wait(pid_t aPid, int *aStatus, int aOptions, struct rusage *aUsage)
+{
+    return ActiveSource->mWait(aPid, aStatus, aOptions, aUsage);
+}
+
+/*----------------------------------------------------------------------------*/
+int
+proc_kill(pid_t aPid, int aSignal)
+{
+    return ActiveSource->mKill(aPid, aSignal);
+}
+
+/*----------------------------------------------------------------------------*/
+int proc_monitor_wait(
+    int aMonitorFd, int aTimeoutMillis, struct ProcMonitorEvent *aEvent)
+{
+    return ActiveSource->mMonitorWait(aMonitorFd, aTimeoutMillis, aEvent);
+}
+
+/******************************************************************************/
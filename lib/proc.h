@@ -16,12 +16,46 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <signal.h>
+
 #include <sys/types.h>
+#include <sys/resource.h>
+
+pid_t proc_execute(char **aCmd, int (*aPrepare)(void *aArg), void *aArg);
+pid_t proc_wait(pid_t aPid, int *aStatus, int aOptions, struct rusage *aUsage);
+int proc_kill(pid_t aPid, int aSignal);
+
+/* A single wait collects a batch of events so that several ready
+ * descriptors are reported without additional system calls. */
+
+#define PROC_MONITOR_BATCH 16
 
-pid_t proc_execute(char **aCmd);
+struct ProcMonitorEvent {
+    pid_t    mParentPid;
+    unsigned mFds;
+    int      mFd[PROC_MONITOR_BATCH];
+};
 
-int proc_monitor_create(pid_t aParentPid);
-int proc_monitor_wait(int aMonitorFd);
+int proc_monitor_create(pid_t aParentPid, const sigset_t *aSigSet);
+int proc_monitor_watch(int aMonitorFd, int aFd, int aEdge);
+int proc_monitor_oneshot(int aMonitorFd, int aFd, int aWrite);
+int proc_monitor_wait(
+    int aMonitorFd, int aTimeoutMillis, struct ProcMonitorEvent *aEvent);
 int proc_monitor_close(int aMonitorFd);
 
+/* A process source replaces the primitives used to run, reap, signal
+ * and monitor child processes, so that a simulation can replay
+ * synthetic process lifetimes without running programs. Installing
+ * a null source restores the system primitives. */
+
+struct ProcSource {
+    pid_t (*mExecute)(char **aCmd, int (*aPrepare)(void *aArg), void *aArg);
+    pid_t (*mWait)(pid_t aPid, int *aStatus, int aOptions, struct rusage *aUsage);
+    int   (*mKill)(pid_t aPid, int aSignal);
+    int   (*mMonitorWait)(
+        int aMonitorFd, int aTimeoutMillis, struct ProcMonitorEvent *aEvent);
+};
+
+void proc_source(const struct ProcSource *aSource);
+
 #endif
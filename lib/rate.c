@@ -0,0 +1,76 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "rate.h"
+
+/******************************************************************************/
+void
+rate_init(struct RateBucket *aBucket,
+          uint64_t aRate, uint64_t aBurst, uint64_t aNowMillis)
+{
+    /* Start with a full bucket so that an initial burst is admitted. */
+
+    aBucket->mRate   = aRate;
+    aBucket->mBurst  = aBurst;
+    aBucket->mCredit = 1000 * aBurst;
+    aBucket->mMillis = aNowMillis;
+}
+
+/******************************************************************************/
+int64_t
+rate_available(struct RateBucket *aBucket, uint64_t aNowMillis)
+{
+    /* The credit can be negative if more was consumed than was
+     * available, and must be repaid before more is available. Compare
+     * the times by their difference so that a time carried across an
+     * upgrade, which can precede the origin of the clock, is still
+     * ordered correctly. */
+
+    int64_t elapsedMillis = aNowMillis - aBucket->mMillis;
+
+    if (0 < elapsedMillis) {
+        int64_t burstCredit = 1000 * aBucket->mBurst;
+
+        /* Avoid overflow by only accruing credit for the time needed
+         * to fill the bucket. */
+
+        if (aBucket->mCredit < burstCredit) {
+            uint64_t fillCredit = burstCredit - aBucket->mCredit;
+
+            uint64_t fillMillis =
+                aBucket->mRate ? fillCredit / aBucket->mRate : UINT64_MAX;
+
+            if ((uint64_t) elapsedMillis > fillMillis)
+                aBucket->mCredit = burstCredit;
+            else
+                aBucket->mCredit += aBucket->mRate * elapsedMillis;
+        }
+
+        aBucket->mMillis = aNowMillis;
+    }
+
+    return aBucket->mCredit / 1000;
+}
+
+/******************************************************************************/
+void
+rate_consume(struct RateBucket *aBucket, uint64_t aUnits)
+{
+    aBucket->mCredit -= 1000 * (int64_t) aUnits;
+}
+
+/******************************************************************************/
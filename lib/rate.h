@@ -0,0 +1,38 @@
+#ifndef RATE_H_
+#define RATE_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+
+/* A token bucket accrues credit at a fixed rate up to a burst limit.
+ * Credit is kept in thousandths of a unit so that slow rates accrue
+ * without losing fractions of a unit to rounding. */
+
+struct RateBucket {
+    uint64_t mRate;
+    uint64_t mBurst;
+    int64_t  mCredit;
+    uint64_t mMillis;
+};
+
+void rate_init(struct RateBucket *aBucket,
+               uint64_t aRate, uint64_t aBurst, uint64_t aNowMillis);
+int64_t rate_available(struct RateBucket *aBucket, uint64_t aNowMillis);
+void rate_consume(struct RateBucket *aBucket, uint64_t aUnits);
+
+#endif
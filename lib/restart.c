@@ -0,0 +1,128 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "restart.h"
+
+#include "clk.h"
+#include "trace.h"
+#include "err.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+/******************************************************************************/
+void
+restart_reset(struct RestartBackoff *aBackoff, uint64_t aNowMillis)
+{
+    /* Start a new backoff window, without changing the backoff, when a
+     * process is restarted for reasons other than a failure. */
+
+    aBackoff->mWindowStartMillis = aNowMillis;
+    aBackoff->mAttempt = 0;
+}
+
+/******************************************************************************/
+int
+restart_wanted(const struct RestartPolicy *aPolicy, int aExitCode, int aFault)
+{
+    /* Normally only restart the process if it failed to exit with one
+     * of the nominated exit statuses and did not terminate due to a
+     * signal. A process that was stopped because of a fault is always
+     * restarted, regardless of how it terminated. */
+
+    if (aPolicy->mForever || aFault)
+        return 1;
+
+    if (0 <= aExitCode && aExitCode < aPolicy->mExits) {
+        if (aPolicy->mExit[aExitCode])
+            return 0;
+    }
+
+    if (aExitCode >= 0x100)
+        return 0;
+
+    return 1;
+}
+
+/******************************************************************************/
+int
+restart_backoff(struct RestartBackoff *aBackoff, uint64_t aEndMillis)
+{
+    int rc = -1;
+
+    uint64_t runDurationMillis = aEndMillis - aBackoff->mWindowStartMillis;
+
+    /* Classify the duration that the program runs. Durations less
+     * than 1s are considered short, and imply that there is an
+     * issue starting the program. Durations between 1s and 60s
+     * imply that there is a problem initialising the program
+     * (eg issue connecting to remote). Durations longer than 60s
+     * are considered long, and imply that the program initialised
+     * successfully but terminated unexpectedly. */
+
+    if (runDurationMillis <= RESTART_SHORT_MILLIS) {
+
+        /* Reset the backoff window because the previous attempt
+         * terminated so quickly. */
+
+        aBackoff->mWindowSeconds = 0;
+
+        /* Limit the number of attempts within a 1s window to
+         * limit the number of attempts to start a broken program. */
+
+        if (aBackoff->mAttempt >= RESTART_ATTEMPT_MAX) {
+            errno = 0;
+            goto Finally;
+        }
+
+        /* Limit the retries so that a broken program cannot
+         * overwhelm the host. */
+
+        clk_sleepmillis(1);
+
+    } else {
+
+        /* Reset the backoff window if the previous attempt ran
+         * for a significant period of time. Otherwise, use the
+         * backoff window to try to restart the program. */
+
+        if (runDurationMillis > RESTART_LONG_MILLIS)
+            aBackoff->mWindowSeconds = 0;
+        else {
+            if (aBackoff->mWindowSeconds < RESTART_WINDOW_MAX)
+                aBackoff->mWindowSeconds = (aBackoff->mWindowSeconds + 1) * 2;
+
+            unsigned backoffDelay = rand() % aBackoff->mWindowSeconds;
+
+            DEBUG("Waiting %us before respawning", backoffDelay);
+
+            TRACE(TraceBegin, "backoff", 0, backoffDelay);
+            clk_sleepmillis(backoffDelay * 1000);
+            TRACE(TraceEnd, "backoff", 0, backoffDelay);
+        }
+
+        restart_reset(aBackoff, aEndMillis);
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
@@ -0,0 +1,52 @@
+#ifndef RESTART_H_
+#define RESTART_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdint.h>
+
+/* The restart policy decides whether a process that terminated is
+ * started again, and how long to wait before it is. Failures are
+ * classified by how long the process ran since the start of the backoff
+ * window. A process that fails to start is retried after a millisecond,
+ * up to a limit, a process that fails to initialise is retried after a
+ * random delay from a window that roughly doubles with each consecutive
+ * failure, and a process that ran for a long time is retried at once. */
+
+#define RESTART_SHORT_MILLIS  1000
+#define RESTART_LONG_MILLIS   60000
+#define RESTART_ATTEMPT_MAX   10
+#define RESTART_WINDOW_MAX    60
+
+struct RestartPolicy {
+    int                  mForever;
+    const unsigned char *mExit;
+    unsigned             mExits;
+};
+
+struct RestartBackoff {
+    unsigned mAttempt;
+    unsigned mWindowSeconds;
+    uint64_t mWindowStartMillis;
+};
+
+void restart_reset(struct RestartBackoff *aBackoff, uint64_t aNowMillis);
+int restart_wanted(
+    const struct RestartPolicy *aPolicy, int aExitCode, int aFault);
+int restart_backoff(struct RestartBackoff *aBackoff, uint64_t aEndMillis);
+
+#endif
@@ -17,19 +17,19 @@
 #include "sig.h"
 
 #include "err.h"
+#include "int.h"
+#include "macros.h"
 
+#include <ctype.h>
 #include <signal.h>
+#include <string.h>
 #include <unistd.h>
 
 /******************************************************************************/
 static volatile sig_atomic_t SignalSet_;
 
 /******************************************************************************/
-struct SignalBlock {
-    sigset_t mSigSet;
-};
-
-static void
+void
 signal_block_acquire(struct SignalBlock *aSignalBlock)
 {
     sigset_t blockMask;
@@ -42,7 +42,7 @@ signal_block_acquire(struct SignalBlock *aSignalBlock)
 }
 
 /*----------------------------------------------------------------------------*/
-static void
+void
 signal_block_release(const struct SignalBlock *aSignalBlock)
 {
     if (sigprocmask(SIG_SETMASK, &aSignalBlock->mSigSet, 0))
@@ -94,6 +94,7 @@ signalset_add(int aSignal)
 static struct {
     const char *mName;
     int         mSignal;
+    int         mExcluded;
     sig_t       mHandler;
     int         mFlags;
 } SigStrategy[] = {
@@ -104,8 +105,28 @@ static struct {
     { "SIGTERM", SIGTERM },
     { "SIGCONT", SIGCONT },
     { "SIGALRM", SIGALRM },
+    { "SIGUSR1", SIGUSR1, 1 },
+    { "SIGUSR2", SIGUSR2, 1 },
 };
 
+/*----------------------------------------------------------------------------*/
+void
+signal_include(int aSignal)
+{
+    /* Signals that are excluded by default are only caught if the
+     * program has a use for them, otherwise their default action
+     * is preserved. */
+
+    for (unsigned ix = 0; ix < NUMBEROF(SigStrategy); ++ix) {
+        if (aSignal == SigStrategy[ix].mSignal) {
+            SigStrategy[ix].mExcluded = 0;
+            return;
+        }
+    }
+
+    die("Unable to include signal %d", aSignal);
+}
+
 /*----------------------------------------------------------------------------*/
 static void
 signal_handler_(int aSignal)
@@ -123,6 +144,9 @@ signal_catch(void)
 
     for (unsigned ix = 0; ix < NUMBEROF(SigStrategy); ++ix) {
 
+        if (SigStrategy[ix].mExcluded)
+            continue;
+
         struct sigaction action;
 
         if (sigaction(SigStrategy[ix].mSignal, 0, &action))
@@ -142,11 +166,35 @@ signal_catch(void)
     }
 }
 
+/*----------------------------------------------------------------------------*/
+void
+signal_caught(sigset_t *aSigSet)
+{
+    /* Report the signals that are caught so that the process monitor
+     * can also wake when one of them is delivered. */
+
+    if (sigemptyset(aSigSet))
+        die("Unable to empty caught signal set");
+
+    for (unsigned ix = 0; ix < NUMBEROF(SigStrategy); ++ix) {
+
+        if (SigStrategy[ix].mExcluded)
+            continue;
+
+        if (sigaddset(aSigSet, SigStrategy[ix].mSignal))
+            die("Unable to add signal %s", SigStrategy[ix].mName);
+    }
+}
+
 /*----------------------------------------------------------------------------*/
 void
 signal_release(void)
 {
     for (unsigned ix = 0; ix < NUMBEROF(SigStrategy); ++ix) {
+
+        if (SigStrategy[ix].mExcluded)
+            continue;
+
         struct sigaction action;
 
         if (sigaction(SigStrategy[ix].mSignal, 0, &action))
@@ -178,3 +226,61 @@ signal_release(void)
 }
 
 /******************************************************************************/
+int
+signal_parse(int *aSignal, const char *aName)
+{
+    int rc = -1;
+
+    static const struct {
+        const char *mName;
+        int         mSignal;
+    } SignalName[] = {
+        { "HUP",  SIGHUP },
+        { "INT",  SIGINT },
+        { "QUIT", SIGQUIT },
+        { "ABRT", SIGABRT },
+        { "KILL", SIGKILL },
+        { "USR1", SIGUSR1 },
+        { "USR2", SIGUSR2 },
+        { "ALRM", SIGALRM },
+        { "TERM", SIGTERM },
+        { "CONT", SIGCONT },
+        { "STOP", SIGSTOP },
+    };
+
+    /* Accept a signal number, or a signal name with or without the
+     * SIG prefix. */
+
+    if (isdigit((unsigned char) *aName)) {
+        unsigned long signalNumber;
+
+        if (int_strtoul(&signalNumber, aName) || NSIG <= signalNumber)
+            goto Finally;
+
+        *aSignal = signalNumber;
+
+    } else {
+        if (!strncmp("SIG", aName, 3))
+            aName += 3;
+
+        unsigned ix;
+
+        for (ix = 0; ix < NUMBEROF(SignalName); ++ix) {
+            if (!strcmp(SignalName[ix].mName, aName))
+                break;
+        }
+
+        if (NUMBEROF(SignalName) <= ix)
+            goto Finally;
+
+        *aSignal = SignalName[ix].mSignal;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
@@ -18,10 +18,22 @@
 
 #include <signal.h>
 
+struct SignalBlock {
+    sigset_t mSigSet;
+};
+
+void signal_block_acquire(struct SignalBlock *aSignalBlock);
+void signal_block_release(const struct SignalBlock *aSignalBlock);
+
 sig_atomic_t signalset_sample(void);
 void signalset_add(int aSignal);
 
+void signal_include(int aSignal);
+
 void signal_catch(void);
+void signal_caught(sigset_t *aSigSet);
 void signal_release(void);
 
+int signal_parse(int *aSignal, const char *aName);
+
 #endif
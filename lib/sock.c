@@ -0,0 +1,430 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sock.h"
+
+#include "err.h"
+#include "fd.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <netinet/in.h>
+
+/******************************************************************************/
+static int
+sock_listen_unix_(const char *aPath)
+{
+    int rc = -1;
+
+    int sockFd = -1;
+
+    struct sockaddr_un sockAddr;
+
+    memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.sun_family = AF_UNIX;
+
+    if (strlen(aPath) >= sizeof(sockAddr.sun_path)) {
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    strcpy(sockAddr.sun_path, aPath);
+
+    /* Remove a stale socket left by an earlier program, but do not
+     * remove anything that is not a socket. */
+
+    struct stat sockStat;
+
+    if (!lstat(aPath, &sockStat) && S_ISSOCK(sockStat.st_mode)) {
+        if (unlink(aPath))
+            goto Finally;
+    }
+
+    sockFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == sockFd)
+        goto Finally;
+
+    if (bind(sockFd, (struct sockaddr *) &sockAddr, sizeof(sockAddr)))
+        goto Finally;
+
+    if (listen(sockFd, SOMAXCONN))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc)
+            sockFd = fd_close(sockFd);
+    });
+
+    return sockFd;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+sock_resolve_(int aType, const char *aAddr, int aPassive,
+              struct addrinfo **aAddrList)
+{
+    int rc = -1;
+
+    /* The address is either a port, or a host and port separated
+     * by a colon. IPv6 hosts are enclosed in brackets. */
+
+    char addrBuf[strlen(aAddr) + 1];
+    strcpy(addrBuf, aAddr);
+
+    char *hostName = 0;
+    char *portName = addrBuf;
+
+    char *portSep = strrchr(addrBuf, ':');
+
+    if (portSep) {
+        *portSep = 0;
+
+        hostName = addrBuf;
+        portName = portSep + 1;
+
+        size_t hostLen = strlen(hostName);
+
+        if ('[' == hostName[0] && hostLen && ']' == hostName[hostLen-1]) {
+            hostName[hostLen-1] = 0;
+            ++hostName;
+        }
+
+        if (!*hostName)
+            hostName = 0;
+    }
+
+    /* Without a host, an active socket connects to the IPv4 loopback
+     * address, which is reachable by servers listening on either the
+     * IPv4 or the dual stack wildcard address. */
+
+    if (!hostName && !aPassive)
+        hostName = "127.0.0.1";
+
+    struct addrinfo addrHints;
+
+    memset(&addrHints, 0, sizeof(addrHints));
+    addrHints.ai_family   = AF_UNSPEC;
+    addrHints.ai_socktype = aType;
+    addrHints.ai_flags    = aPassive ? AI_PASSIVE : 0;
+
+    int addrErr = getaddrinfo(hostName, portName, &addrHints, aAddrList);
+    if (addrErr) {
+        errno = 0;
+        warn("Unable to resolve %s - %s", aAddr, gai_strerror(addrErr));
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+sock_listen_inet_(int aType, const char *aAddr, int aReusePort)
+{
+    int rc = -1;
+
+    int sockFd = -1;
+
+    struct addrinfo *addrList = 0;
+
+    if (sock_resolve_(aType, aAddr, 1, &addrList))
+        goto Finally;
+
+    sockFd = socket(addrList->ai_family, addrList->ai_socktype, 0);
+    if (-1 == sockFd)
+        goto Finally;
+
+    int optOn = 1;
+
+    if (setsockopt(sockFd, SOL_SOCKET, SO_REUSEADDR, &optOn, sizeof(optOn)))
+        goto Finally;
+
+    if (aReusePort) {
+#ifdef SO_REUSEPORT
+        if (setsockopt(
+                sockFd, SOL_SOCKET, SO_REUSEPORT, &optOn, sizeof(optOn)))
+            goto Finally;
+#else
+        errno = ENOSYS;
+        goto Finally;
+#endif
+    }
+
+    if (bind(sockFd, addrList->ai_addr, addrList->ai_addrlen))
+        goto Finally;
+
+    if (SOCK_STREAM == aType) {
+        if (listen(sockFd, SOMAXCONN))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (addrList)
+            freeaddrinfo(addrList);
+
+        if (rc)
+            sockFd = fd_close(sockFd);
+    });
+
+    return sockFd;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+sock_listen(const char *aSpec, int aReusePort)
+{
+    int rc = -1;
+
+    int sockFd = -1;
+
+    /* Listening sockets are specified as tcp:[host:]port,
+     * udp:[host:]port, or unix:path. A bare port implies tcp. */
+
+    if (!strncmp("unix:", aSpec, 5)) {
+        if (aReusePort) {
+            errno = EINVAL;
+            goto Finally;
+        }
+        sockFd = sock_listen_unix_(aSpec + 5);
+    }
+    else if (!strncmp("udp:", aSpec, 4))
+        sockFd = sock_listen_inet_(SOCK_DGRAM, aSpec + 4, aReusePort);
+    else if (!strncmp("tcp:", aSpec, 4))
+        sockFd = sock_listen_inet_(SOCK_STREAM, aSpec + 4, aReusePort);
+    else
+        sockFd = sock_listen_inet_(SOCK_STREAM, aSpec, aReusePort);
+
+    if (-1 == sockFd)
+        goto Finally;
+
+    /* The socket is inherited explicitly by each child process, and
+     * is deliberately left blocking because the file status flags
+     * are shared with the child. */
+
+    if (fd_cloexec(sockFd))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc)
+            sockFd = fd_close(sockFd);
+    });
+
+    return sockFd;
+}
+
+/******************************************************************************/
+int
+sock_connect(const char *aSpec)
+{
+    int rc = -1;
+
+    int sockFd = -1;
+
+    struct addrinfo *addrList = 0;
+
+    /* Stream sockets are specified as tcp:[host:]port or unix:path,
+     * and a bare port implies tcp. Without a host, connect to the
+     * loopback address. The connection is initiated without blocking,
+     * and completes when the socket becomes writable. */
+
+    struct sockaddr_un unixAddr;
+
+    struct sockaddr *sockAddr;
+    socklen_t        sockAddrLen;
+
+    int sockFamily;
+
+    if (!strncmp("unix:", aSpec, 5)) {
+
+        const char *unixPath = aSpec + 5;
+
+        memset(&unixAddr, 0, sizeof(unixAddr));
+        unixAddr.sun_family = AF_UNIX;
+
+        if (strlen(unixPath) >= sizeof(unixAddr.sun_path)) {
+            errno = ENAMETOOLONG;
+            goto Finally;
+        }
+
+        strcpy(unixAddr.sun_path, unixPath);
+
+        sockFamily  = AF_UNIX;
+        sockAddr    = (struct sockaddr *) &unixAddr;
+        sockAddrLen = sizeof(unixAddr);
+
+    } else {
+
+        if (!strncmp("tcp:", aSpec, 4))
+            aSpec += 4;
+
+        if (sock_resolve_(SOCK_STREAM, aSpec, 0, &addrList))
+            goto Finally;
+
+        sockFamily  = addrList->ai_family;
+        sockAddr    = addrList->ai_addr;
+        sockAddrLen = addrList->ai_addrlen;
+    }
+
+    sockFd = socket(sockFamily, SOCK_STREAM, 0);
+    if (-1 == sockFd)
+        goto Finally;
+
+    if (fd_cloexec(sockFd) || fd_nonblock(sockFd))
+        goto Finally;
+
+    if (connect(sockFd, sockAddr, sockAddrLen)) {
+        if (EINPROGRESS != errno)
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (addrList)
+            freeaddrinfo(addrList);
+
+        if (rc)
+            sockFd = fd_close(sockFd);
+    });
+
+    return sockFd;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+sock_error(int aFd)
+{
+    int rc = -1;
+
+    /* Retrieve the outcome of a connection initiated without blocking. */
+
+    int sockErr = 0;
+
+    socklen_t sockErrLen = sizeof(sockErr);
+
+    if (getsockopt(aFd, SOL_SOCKET, SO_ERROR, &sockErr, &sockErrLen))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : sockErr;
+}
+
+/******************************************************************************/
+int
+sock_port(const char *aSpec)
+{
+    int rc = -1;
+
+    int sockPort = 0;
+
+    struct addrinfo *addrList = 0;
+
+    /* Report the port of a tcp listening address, or zero for
+     * addresses that are not tcp. */
+
+    if (strncmp("unix:", aSpec, 5) && strncmp("udp:", aSpec, 4)) {
+
+        if (!strncmp("tcp:", aSpec, 4))
+            aSpec += 4;
+
+        if (sock_resolve_(SOCK_STREAM, aSpec, 1, &addrList))
+            goto Finally;
+
+        struct sockaddr *sockAddr = addrList->ai_addr;
+
+        if (AF_INET == sockAddr->sa_family)
+            sockPort = ntohs(((struct sockaddr_in *) sockAddr)->sin_port);
+        else if (AF_INET6 == sockAddr->sa_family)
+            sockPort = ntohs(((struct sockaddr_in6 *) sockAddr)->sin6_port);
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (addrList)
+            freeaddrinfo(addrList);
+    });
+
+    return rc ? -1 : sockPort;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+sock_pending(int aFd)
+{
+    int rc = -1;
+
+    /* A listening socket is readable when there is a connection
+     * pending, and a datagram socket is readable when there is a
+     * datagram queued. */
+
+    struct pollfd pollFd;
+
+    pollFd.fd      = aFd;
+    pollFd.events  = POLLIN;
+    pollFd.revents = 0;
+
+    int pollRc;
+
+    do
+        pollRc = poll(&pollFd, 1, 0);
+    while (-1 == pollRc && EINTR == errno);
+
+    if (-1 == pollRc)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : !!(pollFd.revents & POLLIN);
+}
+
+/******************************************************************************/
@@ -0,0 +1,182 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "trace.h"
+
+#include "clk.h"
+#include "err.h"
+#include "macros.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/******************************************************************************/
+struct TraceRing *trace_;
+
+/*----------------------------------------------------------------------------*/
+int
+trace_open(unsigned aEvents)
+{
+    int rc = -1;
+
+    struct TraceRing *ring = 0;
+
+    /* Round the capacity up to a power of two so that the position
+     * of each event in the ring is found by masking. */
+
+    unsigned events = 1;
+
+    while (events < aEvents) {
+        if (events > UINT_MAX / 2) {
+            errno = EINVAL;
+            goto Finally;
+        }
+        events *= 2;
+    }
+
+    ring = malloc(sizeof(*ring) + events * sizeof(ring->mEvent[0]));
+    if (!ring)
+        goto Finally;
+
+    ring->mMask = events - 1;
+    ring->mNext = 0;
+
+    trace_close();
+
+    trace_ = ring;
+    ring   = 0;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        free(ring);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+trace_close(void)
+{
+    free(trace_);
+    trace_ = 0;
+}
+
+/******************************************************************************/
+void
+trace_record(enum TracePhase aPhase, const char *aName, pid_t aPid, int aValue)
+{
+    struct TraceEvent *event = &trace_->mEvent[trace_->mNext++ & trace_->mMask];
+
+    event->mNanos = clk_mononanos();
+    event->mName  = aName;
+    event->mPid   = aPid;
+    event->mValue = aValue;
+    event->mPhase = aPhase;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+trace_dump(const char *aPath)
+{
+    int rc = -1;
+
+    FILE *traceFile = 0;
+    char  tracePath[PATH_MAX];
+
+    /* Write the events in the Chrome trace event format, which is also
+     * read by Perfetto. Each supervisor is a process in the trace, and
+     * each child process is a thread of that process. The trace is
+     * written to a temporary file and renamed so that a reader never
+     * sees a partial trace. */
+
+    if (sizeof(tracePath) <= snprintf(
+            tracePath, sizeof(tracePath), "%s.%d", aPath, (int) getpid())) {
+        tracePath[0] = 0;
+        errno = ENAMETOOLONG;
+        goto Finally;
+    }
+
+    /* Only remove the temporary file once it has been created, so that
+     * a truncated path or a file owned by another is never removed. */
+
+    traceFile = fopen(tracePath, "w");
+    if (!traceFile) {
+        tracePath[0] = 0;
+        goto Finally;
+    }
+
+    pid_t selfPid = getpid();
+
+    fprintf(traceFile,
+        "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+        "\"args\":{\"name\":\"%s\"}}",
+        (int) selfPid, ARGV0);
+
+    uint64_t events = trace_->mMask + 1;
+    uint64_t first  = trace_->mNext > events ? trace_->mNext - events : 0;
+
+    for (uint64_t ix = first; ix < trace_->mNext; ++ix) {
+        const struct TraceEvent *event = &trace_->mEvent[ix & trace_->mMask];
+
+        fprintf(traceFile,
+            ",\n{\"name\":\"%s\",\"ph\":\"%c\",%s"
+            "\"ts\":%" PRIu64 ".%03u,\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"value\":%d}}",
+            event->mName,
+            event->mPhase,
+            TraceInstant == event->mPhase ? "\"s\":\"t\"," : "",
+            event->mNanos / 1000, (unsigned) (event->mNanos % 1000),
+            (int) selfPid,
+            (int) (event->mPid ? event->mPid : selfPid),
+            event->mValue);
+    }
+
+    fprintf(traceFile, "\n]}\n");
+
+    int closed = fclose(traceFile);
+    traceFile = 0;
+
+    if (closed)
+        goto Finally;
+
+    if (rename(tracePath, aPath))
+        goto Finally;
+
+    tracePath[0] = 0;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (traceFile)
+            fclose(traceFile);
+
+        if (rc && tracePath[0])
+            unlink(tracePath);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
@@ -0,0 +1,61 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <sys/types.h>
+
+/* The trace ring records lifecycle events with nanosecond timestamps,
+ * overwriting the oldest events once the ring is full. The ring is
+ * only allocated when tracing is enabled, so that recording an event
+ * otherwise costs a single test. Events are recorded and dumped by the
+ * same thread, never from a signal handler, so the ring needs no
+ * locks. */
+
+#define TRACE(...) if (!trace_) { } else trace_record(__VA_ARGS__)
+
+enum TracePhase {
+    TraceInstant = 'i',
+    TraceBegin   = 'B',
+    TraceEnd     = 'E',
+};
+
+struct TraceEvent {
+    uint64_t        mNanos;
+    const char     *mName;
+    pid_t           mPid;
+    int             mValue;
+    enum TracePhase mPhase;
+};
+
+struct TraceRing {
+    unsigned          mMask;
+    uint64_t          mNext;
+    struct TraceEvent mEvent[];
+};
+
+extern struct TraceRing *trace_;
+
+int trace_open(unsigned aEvents);
+void trace_close(void);
+
+void trace_record(
+    enum TracePhase aPhase, const char *aName, pid_t aPid, int aValue);
+int trace_dump(const char *aPath);
+
+#endif
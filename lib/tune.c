@@ -0,0 +1,542 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tune.h"
+
+#include "err.h"
+#include "fd.h"
+#include "int.h"
+
+#include "macros.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+
+#include <linux/ioprio.h>
+#include <linux/mempolicy.h>
+#endif
+
+/******************************************************************************/
+static int
+tune_list_add_(struct TuneList *aList, unsigned long aItem)
+{
+    int rc = -1;
+
+    if (TUNE_LIST_MAX <= aItem || TUNE_LIST_MAX <= aList->mCount) {
+        errno = ERANGE;
+        goto Finally;
+    }
+
+    for (unsigned ix = 0; ix < aList->mCount; ++ix) {
+        if (aItem == aList->mItem[ix]) {
+            rc = 0;
+            goto Finally;
+        }
+    }
+
+    aList->mItem[aList->mCount++] = aItem;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+tune_list_number_(unsigned long *aNumber, const char *aWord)
+{
+    if (!strcmp("0", aWord)) {
+        *aNumber = 0;
+        return 0;
+    }
+
+    return int_strtoul(aNumber, aWord);
+}
+
+/*----------------------------------------------------------------------------*/
+static int
+tune_list_parse_(struct TuneList *aList, const char *aSpec)
+{
+    int rc = -1;
+
+    aList->mCount = 0;
+
+    /* Comma separated numbers and ranges in the style of taskset(1).
+     * The order of the list is preserved. */
+
+    char specBuf[strlen(aSpec) + 1];
+    strcpy(specBuf, aSpec);
+
+    char *lastSep;
+
+    char *specList = specBuf;
+
+    while (1) {
+        char *word = strtok_r(specList, ",", &lastSep);
+
+        if (!word) {
+            if (specList) {
+                errno = EINVAL;
+                goto Finally;
+            }
+            break;
+        }
+
+        specList = 0;
+
+        char *rangeSep = strchr(word, '-');
+        if (rangeSep)
+            *rangeSep++ = 0;
+
+        unsigned long firstItem;
+        unsigned long lastItem;
+
+        if (tune_list_number_(&firstItem, word))
+            goto Finally;
+
+        lastItem = firstItem;
+
+        if (rangeSep && tune_list_number_(&lastItem, rangeSep))
+            goto Finally;
+
+        if (lastItem < firstItem) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        for (unsigned long item = firstItem; item <= lastItem; ++item) {
+            if (tune_list_add_(aList, item))
+                goto Finally;
+        }
+    }
+
+    if (!aList->mCount) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+tune_cpus_parse(struct TuneList *aList, const char *aSpec)
+{
+    int rc = -1;
+
+    aList->mCount = 0;
+
+#ifndef __linux__
+    errno = ENOSYS;
+    goto Finally;
+#else
+    /* The word all means all the cpus available to this process. */
+
+    if (strcmp("all", aSpec)) {
+        if (tune_list_parse_(aList, aSpec))
+            goto Finally;
+    } else {
+
+        cpu_set_t cpuSet;
+
+        if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet))
+            goto Finally;
+
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpuSet)) {
+                if (tune_list_add_(aList, cpu))
+                    goto Finally;
+            }
+        }
+    }
+#endif
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+tune_cpus_apply(const struct TuneList *aList, int aIndex)
+{
+    int rc = -1;
+
+#ifndef __linux__
+    errno = ENOSYS;
+    goto Finally;
+#else
+    /* Bind to all the cpus in the list, or with a non-negative index,
+     * bind to a single cpu selected from the list in turn. */
+
+    cpu_set_t cpuSet;
+
+    CPU_ZERO(&cpuSet);
+
+    if (0 > aIndex) {
+        for (unsigned ix = 0; ix < aList->mCount; ++ix)
+            CPU_SET(aList->mItem[ix], &cpuSet);
+    } else {
+        CPU_SET(aList->mItem[aIndex % aList->mCount], &cpuSet);
+    }
+
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+        goto Finally;
+#endif
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+tune_nodes_parse(struct TuneList *aList, const char *aSpec)
+{
+    return tune_list_parse_(aList, aSpec);
+}
+
+/*----------------------------------------------------------------------------*/
+int
+tune_nodes_apply(const struct TuneList *aList)
+{
+    int rc = -1;
+
+#ifndef __linux__
+    errno = ENOSYS;
+    goto Finally;
+#else
+    /* Use the system call directly to avoid a dependency on libnuma.
+     * The kernel expects a bitmask of nodes, and the number of bits
+     * in the mask. */
+
+    unsigned long nodeMask[TUNE_LIST_MAX / (sizeof(unsigned long) * CHAR_BIT)];
+
+    static const unsigned NodeBits = sizeof(nodeMask[0]) * CHAR_BIT;
+
+    memset(nodeMask, 0, sizeof(nodeMask));
+
+    for (unsigned ix = 0; ix < aList->mCount; ++ix) {
+        unsigned node = aList->mItem[ix];
+
+        nodeMask[node / NodeBits] |= 1UL << (node % NodeBits);
+    }
+
+    if (syscall(SYS_set_mempolicy,
+            MPOL_BIND, nodeMask, (unsigned long) TUNE_LIST_MAX + 1))
+        goto Finally;
+#endif
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+tune_sched_parse(struct TuneSched *aSched, const char *aSpec)
+{
+    int rc = -1;
+
+    /* The policy is one of other, batch, idle, fifo or rr. The realtime
+     * policies fifo and rr take a priority as policy:priority. */
+
+    static const struct {
+        const char *mName;
+        int         mPolicy;
+        int         mRealTime;
+    } SchedPolicy[] = {
+        { "other", SCHED_OTHER },
+#ifdef SCHED_BATCH
+        { "batch", SCHED_BATCH },
+#endif
+#ifdef SCHED_IDLE
+        { "idle",  SCHED_IDLE },
+#endif
+        { "fifo",  SCHED_FIFO, 1 },
+        { "rr",    SCHED_RR,   1 },
+    };
+
+    const char *prioritySep = strchr(aSpec, ':');
+
+    size_t nameLen = prioritySep ? prioritySep - aSpec : strlen(aSpec);
+
+    unsigned ix;
+
+    for (ix = 0; ix < NUMBEROF(SchedPolicy); ++ix) {
+        if (strlen(SchedPolicy[ix].mName) == nameLen &&
+                !strncmp(SchedPolicy[ix].mName, aSpec, nameLen))
+            break;
+    }
+
+    if (NUMBEROF(SchedPolicy) <= ix) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    aSched->mPolicy   = SchedPolicy[ix].mPolicy;
+    aSched->mPriority = 0;
+
+    if (SchedPolicy[ix].mRealTime) {
+
+        unsigned long priority = 1;
+
+        if (prioritySep && int_strtoul(&priority, prioritySep + 1))
+            goto Finally;
+
+        int minPriority = sched_get_priority_min(aSched->mPolicy);
+        int maxPriority = sched_get_priority_max(aSched->mPolicy);
+
+        if (priority < minPriority || priority > maxPriority) {
+            errno = ERANGE;
+            goto Finally;
+        }
+
+        aSched->mPriority = priority;
+
+    } else if (prioritySep) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+tune_sched_apply(const struct TuneSched *aSched)
+{
+    int rc = -1;
+
+#ifndef __linux__
+    errno = ENOSYS;
+    goto Finally;
+#else
+    struct sched_param schedParam;
+
+    memset(&schedParam, 0, sizeof(schedParam));
+    schedParam.sched_priority = aSched->mPriority;
+
+    if (sched_setscheduler(0, aSched->mPolicy, &schedParam))
+        goto Finally;
+#endif
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+tune_nice_get(int *aNice)
+{
+    int rc = -1;
+
+    /* The nice value can legitimately be -1, so use errno to detect
+     * failure. */
+
+    errno = 0;
+    int niceValue = getpriority(PRIO_PROCESS, 0);
+
+    if (-1 == niceValue && errno)
+        goto Finally;
+
+    *aNice = niceValue;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+tune_nice_set(int aNice)
+{
+    return setpriority(PRIO_PROCESS, 0, aNice);
+}
+
+/******************************************************************************/
+int
+tune_ioprio_parse(int *aIoPrio, const char *aSpec)
+{
+    int rc = -1;
+
+#ifndef __linux__
+    errno = ENOSYS;
+    goto Finally;
+#else
+    /* The class is one of rt, be or idle. The rt and be classes take
+     * a level from 0 (highest) to 7 (lowest) as class:level. */
+
+    const char *levelSep = strchr(aSpec, ':');
+
+    size_t classLen = levelSep ? levelSep - aSpec : strlen(aSpec);
+
+    int ioClass;
+
+    if (2 == classLen && !strncmp("rt", aSpec, classLen))
+        ioClass = IOPRIO_CLASS_RT;
+    else if (2 == classLen && !strncmp("be", aSpec, classLen))
+        ioClass = IOPRIO_CLASS_BE;
+    else if (4 == classLen && !strncmp("idle", aSpec, classLen))
+        ioClass = IOPRIO_CLASS_IDLE;
+    else {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    unsigned long ioLevel = IOPRIO_CLASS_IDLE == ioClass ? 0 : 4;
+
+    if (levelSep) {
+        if (IOPRIO_CLASS_IDLE == ioClass) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        if (tune_list_number_(&ioLevel, levelSep + 1))
+            goto Finally;
+
+        if (7 < ioLevel) {
+            errno = ERANGE;
+            goto Finally;
+        }
+    }
+
+    *aIoPrio = (ioClass << IOPRIO_CLASS_SHIFT) | ioLevel;
+#endif
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+tune_ioprio_apply(int aIoPrio)
+{
+    int rc = -1;
+
+#ifndef __linux__
+    errno = ENOSYS;
+    goto Finally;
+#else
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, aIoPrio))
+        goto Finally;
+#endif
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+static const char TuneOomPath[] = "/proc/self/oom_score_adj";
+
+int
+tune_oom_get(int *aScore)
+{
+    int rc = -1;
+
+    FILE *oomFile = fopen(TuneOomPath, "r");
+    if (!oomFile)
+        goto Finally;
+
+    if (1 != fscanf(oomFile, "%d", aScore)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (oomFile)
+            fclose(oomFile);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+tune_oom_set(int aScore)
+{
+    int rc = -1;
+
+    int oomFd = -1;
+
+    /* Use a single write so that this can be used between fork and
+     * exec without involving stdio. */
+
+    oomFd = open(TuneOomPath, O_WRONLY | O_CLOEXEC);
+    if (-1 == oomFd)
+        goto Finally;
+
+    char scoreText[sizeof(int) * CHAR_BIT];
+
+    int scoreLen = snprintf(scoreText, sizeof(scoreText), "%d", aScore);
+
+    if (scoreLen != fd_write(oomFd, scoreText, scoreLen))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        oomFd = fd_close(oomFd);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
@@ -0,0 +1,49 @@
+#ifndef TUNE_H_
+#define TUNE_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define TUNE_LIST_MAX 1024
+
+struct TuneList {
+    unsigned       mCount;
+    unsigned short mItem[TUNE_LIST_MAX];
+};
+
+struct TuneSched {
+    int mPolicy;
+    int mPriority;
+};
+
+int tune_cpus_parse(struct TuneList *aList, const char *aSpec);
+int tune_cpus_apply(const struct TuneList *aList, int aIndex);
+
+int tune_nodes_parse(struct TuneList *aList, const char *aSpec);
+int tune_nodes_apply(const struct TuneList *aList);
+
+int tune_sched_parse(struct TuneSched *aSched, const char *aSpec);
+int tune_sched_apply(const struct TuneSched *aSched);
+
+int tune_nice_get(int *aNice);
+int tune_nice_set(int aNice);
+
+int tune_ioprio_parse(int *aIoPrio, const char *aSpec);
+int tune_ioprio_apply(int aIoPrio);
+
+int tune_oom_get(int *aScore);
+int tune_oom_set(int aScore);
+
+#endif
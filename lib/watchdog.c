@@ -0,0 +1,129 @@
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "watchdog.h"
+
+#include "err.h"
+#include "fd.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+/******************************************************************************/
+static size_t
+watchdog_size_(void)
+{
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    return pageSize < WATCHDOG_SLOTS * WATCHDOG_SLOT_SIZE
+        ? WATCHDOG_SLOTS * WATCHDOG_SLOT_SIZE
+        : pageSize;
+}
+
+/******************************************************************************/
+int
+watchdog_create(struct Watchdog *aWatchdog)
+{
+    int rc = -1;
+
+    aWatchdog->mFd   = -1;
+    aWatchdog->mBeat = 0;
+
+    aWatchdog->mFd = fd_anonymous("watchdog");
+    if (-1 == aWatchdog->mFd)
+        goto Finally;
+
+    if (ftruncate(aWatchdog->mFd, watchdog_size_()))
+        goto Finally;
+
+    if (watchdog_attach(aWatchdog))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc)
+            aWatchdog->mFd = fd_close(aWatchdog->mFd);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+watchdog_attach(struct Watchdog *aWatchdog)
+{
+    int rc = -1;
+
+    /* Map the page from the descriptor, for example after the
+     * descriptor has been inherited across an exec. */
+
+    void *beatPage = mmap(
+        0, watchdog_size_(), PROT_READ, MAP_SHARED, aWatchdog->mFd, 0);
+
+    if (MAP_FAILED == beatPage) {
+        aWatchdog->mBeat = 0;
+        goto Finally;
+    }
+
+    aWatchdog->mBeat = beatPage;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+watchdog_close(struct Watchdog *aWatchdog)
+{
+    int rc = -1;
+
+    if (aWatchdog->mBeat) {
+        if (munmap((void *) aWatchdog->mBeat, watchdog_size_()))
+            goto Finally;
+        aWatchdog->mBeat = 0;
+    }
+
+    aWatchdog->mFd = fd_close(aWatchdog->mFd);
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+uint64_t
+watchdog_beat(const struct Watchdog *aWatchdog, unsigned aSlot)
+{
+    const volatile char *slotPtr = (const volatile char *) aWatchdog->mBeat;
+
+    slotPtr += aSlot % WATCHDOG_SLOTS * WATCHDOG_SLOT_SIZE;
+
+    return *(const volatile uint64_t *) slotPtr;
+}
+
+/******************************************************************************/
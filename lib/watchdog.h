@@ -0,0 +1,42 @@
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+/**
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+/* The watchdog is a shared page that the child process maps using the
+ * descriptor that it inherits. The page is divided into slots, each in
+ * its own cache line, so that overlapping instances of the child each
+ * have their own counter. The child periodically increments the 64 bit
+ * counter at the start of its slot, and the supervisor reads the
+ * counter without any system calls. */
+
+#define WATCHDOG_SLOT_SIZE 64
+#define WATCHDOG_SLOTS     64
+
+struct Watchdog {
+    int                mFd;
+    volatile uint64_t *mBeat;
+};
+
+int watchdog_create(struct Watchdog *aWatchdog);
+int watchdog_attach(struct Watchdog *aWatchdog);
+int watchdog_close(struct Watchdog *aWatchdog);
+
+uint64_t watchdog_beat(const struct Watchdog *aWatchdog, unsigned aSlot);
+
+#endif
@@ -19,26 +19,114 @@
 #include "clk.h"
 #include "err.h"
 #include "fd.h"
+#include "fdstore.h"
 #include "int.h"
+#include "load.h"
+#include "match.h"
+#include "notify.h"
+#include "probe.h"
+#include "rate.h"
 #include "proc.h"
+#include "restart.h"
 #include "sig.h"
+#include "sock.h"
+#include "trace.h"
+#include "tune.h"
+#include "watchdog.h"
 #include "macros.h"
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <sys/event.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 
+/******************************************************************************/
+/* A planned restart can start a new instance while the instance that
+ * it replaces continues to run, so that there are briefly several
+ * instances of the child process. */
+
+#define RESPAWN_INSTANCE_MAX 16
+
+#define RESPAWN_PROBE_MAX 8
+
+/* Each instance of the child process has a stream for each of stdout
+ * and stderr, and the streams of an instance can outlive it. */
+
+#define RESPAWN_STREAM_MAX (4 * RESPAWN_INSTANCE_MAX)
+
+/* The trace ring retains the most recent lifecycle events, which is
+ * several hours of history even for a process that restarts every
+ * second. */
+
+#define RESPAWN_TRACE_EVENTS (64 * 1024)
+
 /******************************************************************************/
 static int optHelp;
 static int optContinue;
 static int optForever;
+static int optFdStore;
 static int optParented;
+static int optUpgrade;
+static int optProtect;
+
+static unsigned    optIdle;
+static unsigned    optMemoryLimit;
+static unsigned    optMemoryGrowth;
+static unsigned    optOverlap;
+static unsigned    optOverlapMax = 2;
+static unsigned    optWatchdog;
+static unsigned    optWatchdogGrace;
+
+static struct Probe optProbe[RESPAWN_PROBE_MAX];
+static unsigned     optProbes;
+
+enum DetectKind {
+    DetectReady,
+    DetectFail,
+    DetectRestart,
+};
+
+static struct Matcher  optDetect;
+static enum DetectKind optDetectKind[MATCH_PATTERN_MAX];
+static unsigned        optDetects;
+
+enum LabelClock {
+    LabelOff,
+    LabelNone,
+    LabelMono,
+    LabelReal,
+};
+
+static enum LabelClock optLabel;
+
+static unsigned optRate;
+static unsigned optRateBurst;
+static const char *optListen;
+static const char *optTrace;
+static unsigned    optReplicas;
+static unsigned    optReplicasMin;
+
+static unsigned    optScaleHigh     = 80;
+static unsigned    optScaleLow      = 30;
+static unsigned    optScaleCooldown = 30;
+
+static struct TuneList  optCpus;
+static struct TuneList  optMemBind;
+static struct TuneSched optSched  = { -1 };
+static int              optNice   = INT_MIN;
+static int              optIoPrio = -1;
+static int              optOom    = INT_MIN;
 
 static unsigned char optExit[256] = { 1 };
 
@@ -47,18 +135,56 @@ void
 usage(void)
 {
     static const char usageText[] =
-        "[-dfZ] [-x N,...] -- cmd ...\n"
+        "[-dfFpPUZ] [-B class] [-C cpus] [-D detect] [-H probe] [-I N] [-l clock]"
+            " [-L addr] [-m N[,N]]"
+            " [-M nodes] [-N N] [-o N[,N]]"
+            " [-O N] [-r N[,N]] [-R N[-N]] [-S N,N,N] [-t file] [-T policy] [-W N]"
+            " [-x N,...]"
+            " -- cmd ...\n"
         "\n"
         "Options:\n"
-        "  -d --debug      Emit debug information\n"
-        "  -f --forever    Continually restart the monitored process\n"
-        "  -P --parented   Terminate if no longer parented\n"
-        "  -Z --continue   Continue monitored process if it suspends\n"
-        "  -x --exit N,..  Additional success exit codes [default: 0]\n"
-        "  -x --exit none  No success exit codes [default: 0]\n"
+        "  -B --ioprio class Set io scheduling class of monitored process\n"
+        "  -C --cpus cpus    Bind monitored processes to cpus\n"
+        "  -d --debug        Emit debug information\n"
+        "  -D --detect kind:text\n"
+        "                    Act on text in output of monitored process\n"
+        "  -f --forever      Continually restart the monitored process\n"
+        "  -F --fdstore      Retain fds deposited by the monitored process\n"
+        "  -H --probe probe  Restart if liveness probe fails repeatedly\n"
+        "  -I --idle N       Stop monitored process after N idle seconds\n"
+        "  -l --label clock  Label output lines with time, instance and stream\n"
+        "  -L --listen addr  Start monitored process on demand from addr\n"
+        "  -m --memory N[,N] Restart at N MiB memory or N MiB/h growth\n"
+        "  -M --membind nodes\n"
+        "                    Bind memory of monitored process to nodes\n"
+        "  -N --nice N       Set nice value of monitored process\n"
+        "  -o --overlap N,M  Overlap planned restarts by N s with M instances\n"
+        "  -O --oom N        Set oom score adjustment of monitored process\n"
+        "  -p --protect      Protect supervisor from scheduling and oom\n"
+        "  -P --parented     Terminate if no longer parented\n"
+        "  -r --rate N[,N]   Limit output to N KiB/s with N KiB bursts\n"
+        "  -R --replicas N   Monitor N replicas of the process\n"
+        "  -R --replicas N-N Scale replicas between bounds according to load\n"
+        "  -S --scale H,L,N  Scale at H%/L% load with N s cooldown [80,30,30]\n"
+        "  -t --trace file   Trace lifecycle events to file, also on SIGUSR1\n"
+        "  -T --sched policy Set scheduling policy of monitored process\n"
+        "  -U --upgrade      Re-execute on SIGUSR2 retaining monitored process\n"
+        "  -W --watchdog N,G Restart if no heartbeat within N seconds,\n"
+        "                    or G seconds after starting [G: N]\n"
+        "  -Z --continue     Continue monitored process if it suspends\n"
+        "  -x --exit N,..    Additional success exit codes [default: 0]\n"
+        "  -x --exit none    No success exit codes [default: 0]\n"
         "\n"
         "Arguments:\n"
-        "  cmd ...         Program to monitor\n";
+        "  addr              [tcp:|udp:][host:]port or unix:path\n"
+        "  class             rt[:N], be[:N] or idle\n"
+        "  clock             mono, real or none\n"
+        "  cpus              all or N[-N],...\n"
+        "  kind              ready, fail or restart\n"
+        "  nodes             N[-N],...\n"
+        "  probe             [key=value,]... addr or exec:cmd\n"
+        "  policy            other, batch, idle, fifo[:N] or rr[:N]\n"
+        "  cmd ...           Program to monitor\n";
 
     help(usageText, optHelp);
 
@@ -71,13 +197,34 @@ parse_options(int argc, char **argv)
 {
     int rc = -1;
 
-    static char shortOpts[] = "+hdfPZx:";
+    static char shortOpts[] = "+hB:C:dD:fFH:I:l:L:m:M:N:o:O:pPr:R:S:t:T:UW:Zx:";
 
     static struct option longOpts[] = {
         { "help",      no_argument,       0, 'h' },
+        { "ioprio",    required_argument, 0, 'B' },
+        { "cpus",      required_argument, 0, 'C' },
         { "debug",     no_argument,       0, 'd' },
+        { "detect",    required_argument, 0, 'D' },
         { "forever",   no_argument,       0, 'f' },
+        { "fdstore",   no_argument,       0, 'F' },
+        { "probe",     required_argument, 0, 'H' },
+        { "idle",      required_argument, 0, 'I' },
+        { "label",     required_argument, 0, 'l' },
+        { "listen",    required_argument, 0, 'L' },
+        { "memory",    required_argument, 0, 'm' },
+        { "membind",   required_argument, 0, 'M' },
+        { "nice",      required_argument, 0, 'N' },
+        { "overlap",   required_argument, 0, 'o' },
+        { "oom",       required_argument, 0, 'O' },
+        { "protect",   no_argument,       0, 'p' },
         { "parented",  no_argument,       0, 'P' },
+        { "rate",      required_argument, 0, 'r' },
+        { "replicas",  required_argument, 0, 'R' },
+        { "scale",     required_argument, 0, 'S' },
+        { "trace",     required_argument, 0, 't' },
+        { "sched",     required_argument, 0, 'T' },
+        { "upgrade",   no_argument,       0, 'U' },
+        { "watchdog",  required_argument, 0, 'W' },
         { "continue",  no_argument,       0, 'Z' },
         { "exit",      required_argument, 0, 'x' },
         { 0 },
@@ -104,9 +251,298 @@ parse_options(int argc, char **argv)
         case 'f':
             optForever = 1; break;
 
+        case 'F':
+            optFdStore = 1; break;
+
+        case 'D':
+            {
+                static const struct {
+                    const char     *mName;
+                    enum DetectKind mKind;
+                } DetectName[] = {
+                    { "ready:",   DetectReady },
+                    { "fail:",    DetectFail },
+                    { "restart:", DetectRestart },
+                };
+
+                unsigned ix;
+
+                for (ix = 0; ix < NUMBEROF(DetectName); ++ix) {
+                    size_t nameLen = strlen(DetectName[ix].mName);
+
+                    if (!strncmp(DetectName[ix].mName, optarg, nameLen))
+                        break;
+                }
+
+                if (NUMBEROF(DetectName) <= ix)
+                    die("Unable to parse detector %s", optarg);
+
+                if (!optDetects && match_init(&optDetect))
+                    die("Unable to create output matcher");
+
+                const char *detectText =
+                    optarg + strlen(DetectName[ix].mName);
+
+                int detectIndex = match_add(&optDetect, detectText);
+                if (-1 == detectIndex)
+                    die("Unable to add detector %s", optarg);
+
+                optDetectKind[detectIndex] = DetectName[ix].mKind;
+                optDetects = detectIndex + 1;
+            }
+            break;
+
+        case 'H':
+            if (RESPAWN_PROBE_MAX <= optProbes)
+                die("Too many probes %s", optarg);
+
+            if (probe_parse(&optProbe[optProbes], optarg))
+                die("Unable to parse probe %s", optarg);
+
+            ++optProbes;
+            break;
+
+        case 'I':
+            {
+                unsigned long idleSeconds;
+                if (int_strtoul(&idleSeconds, optarg))
+                    die("Unable to parse idle duration %s", optarg);
+
+                optIdle = idleSeconds;
+                if (optIdle != idleSeconds || optIdle > INT_MAX / 1000)
+                    die("Idle duration too large %lu", idleSeconds);
+            }
+            break;
+
+        case 'l':
+            if (!strcmp("none", optarg))
+                optLabel = LabelNone;
+            else if (!strcmp("mono", optarg))
+                optLabel = LabelMono;
+            else if (!strcmp("real", optarg))
+                optLabel = LabelReal;
+            else
+                die("Unable to parse label clock %s", optarg);
+            break;
+
+        case 'L':
+            optListen = optarg; break;
+
+        case 'C':
+            if (tune_cpus_parse(&optCpus, optarg))
+                die("Unable to parse cpu list %s", optarg);
+            break;
+
+        case 'm':
+            {
+                /* A limit of 0 disables the limit so that only growth
+                 * is monitored. */
+
+                char *growthSep = strchr(optarg, ',');
+                if (growthSep)
+                    *growthSep++ = 0;
+
+                unsigned long memoryLimit = 0;
+                if (strcmp("0", optarg) && int_strtoul(&memoryLimit, optarg))
+                    die("Unable to parse memory limit %s", optarg);
+
+                unsigned long memoryGrowth = 0;
+                if (growthSep && int_strtoul(&memoryGrowth, growthSep))
+                    die("Unable to parse memory growth %s", growthSep);
+
+                optMemoryLimit  = memoryLimit;
+                optMemoryGrowth = memoryGrowth;
+                if (optMemoryLimit != memoryLimit ||
+                        optMemoryGrowth != memoryGrowth)
+                    die("Memory limit too large %s", optarg);
+
+                if (!optMemoryLimit && !optMemoryGrowth)
+                    die("No memory limit specified");
+            }
+            break;
+
+        case 'r':
+            {
+                /* The burst defaults to one second of output. */
+
+                char *burstSep = strchr(optarg, ',');
+                if (burstSep)
+                    *burstSep++ = 0;
+
+                unsigned long rateLimit;
+                if (int_strtoul(&rateLimit, optarg))
+                    die("Unable to parse output rate %s", optarg);
+
+                unsigned long rateBurst = rateLimit;
+                if (burstSep && int_strtoul(&rateBurst, burstSep))
+                    die("Unable to parse output burst %s", burstSep);
+
+                optRate      = rateLimit;
+                optRateBurst = rateBurst;
+                if (optRate != rateLimit || optRateBurst != rateBurst ||
+                        optRate > UINT_MAX / 1024 ||
+                        optRateBurst > UINT_MAX / 1024)
+                    die("Output rate too large %s", optarg);
+            }
+            break;
+
+        case 'M':
+            if (tune_nodes_parse(&optMemBind, optarg))
+                die("Unable to parse node list %s", optarg);
+            break;
+
+        case 'N':
+            {
+                long niceValue;
+                if (int_strtol(&niceValue, optarg) ||
+                        -20 > niceValue || 19 < niceValue)
+                    die("Unable to parse nice value %s", optarg);
+
+                optNice = niceValue;
+            }
+            break;
+
+        case 'o':
+            {
+                char *maxSep = strchr(optarg, ',');
+                if (maxSep)
+                    *maxSep++ = 0;
+
+                unsigned long overlapSeconds;
+                if (int_strtoul(&overlapSeconds, optarg))
+                    die("Unable to parse overlap duration %s", optarg);
+
+                optOverlap = overlapSeconds;
+                if (optOverlap != overlapSeconds || optOverlap > INT_MAX / 1000)
+                    die("Overlap duration too large %lu", overlapSeconds);
+
+                unsigned long overlapMax = optOverlapMax;
+                if (maxSep && int_strtoul(&overlapMax, maxSep))
+                    die("Unable to parse instance count %s", maxSep);
+
+                if (2 > overlapMax || RESPAWN_INSTANCE_MAX < overlapMax)
+                    die("Instance count must be 2 to %u", RESPAWN_INSTANCE_MAX);
+
+                optOverlapMax = overlapMax;
+            }
+            break;
+
+        case 'O':
+            {
+                long oomScore;
+                if (int_strtol(&oomScore, optarg) ||
+                        -1000 > oomScore || 1000 < oomScore)
+                    die("Unable to parse oom score adjustment %s", optarg);
+
+                optOom = oomScore;
+            }
+            break;
+
+        case 'B':
+            if (tune_ioprio_parse(&optIoPrio, optarg))
+                die("Unable to parse io scheduling class %s", optarg);
+            break;
+
+        case 't':
+            optTrace = optarg; break;
+
+        case 'T':
+            if (tune_sched_parse(&optSched, optarg))
+                die("Unable to parse scheduling policy %s", optarg);
+            break;
+
+        case 'p':
+            optProtect = 1; break;
+
         case 'P':
             optParented = 1; break;
 
+        case 'R':
+            {
+                /* Either a fixed number of replicas, or a range of
+                 * replicas that is scaled according to load. */
+
+                char *rangeSep = strchr(optarg, '-');
+                if (rangeSep)
+                    *rangeSep++ = 0;
+
+                unsigned long replicas;
+                if (int_strtoul(&replicas, optarg))
+                    die("Unable to parse replica count %s", optarg);
+
+                unsigned long maxReplicas = replicas;
+                if (rangeSep && int_strtoul(&maxReplicas, rangeSep))
+                    die("Unable to parse replica count %s", rangeSep);
+
+                if (maxReplicas < replicas)
+                    die("Replica range %lu-%lu is empty", replicas, maxReplicas);
+
+                optReplicas    = maxReplicas;
+                optReplicasMin = replicas;
+                if (optReplicas != maxReplicas || maxReplicas > 4096)
+                    die("Replica count too large %lu", maxReplicas);
+            }
+            break;
+
+        case 'S':
+            {
+                unsigned long scaleArg[3] = {
+                    optScaleHigh, optScaleLow, optScaleCooldown };
+
+                char *lastSep;
+                char *argList = optarg;
+
+                for (unsigned ix = 0; ix < NUMBEROF(scaleArg); ++ix) {
+                    char *word = strtok_r(argList, ",", &lastSep);
+
+                    if (!word)
+                        break;
+
+                    argList = 0;
+
+                    if (int_strtoul(&scaleArg[ix], word) || scaleArg[ix] > 3600)
+                        die("Unable to parse scaling parameter %s", word);
+                }
+
+                if (scaleArg[1] >= scaleArg[0])
+                    die("Scaling threshold %lu must exceed %lu",
+                        scaleArg[0], scaleArg[1]);
+
+                optScaleHigh     = scaleArg[0];
+                optScaleLow      = scaleArg[1];
+                optScaleCooldown = scaleArg[2];
+            }
+            break;
+
+        case 'U':
+            optUpgrade = 1; break;
+
+        case 'W':
+            {
+                char *graceSep = strchr(optarg, ',');
+                if (graceSep)
+                    *graceSep++ = 0;
+
+                unsigned long watchdogSeconds;
+                if (int_strtoul(&watchdogSeconds, optarg))
+                    die("Unable to parse watchdog period %s", optarg);
+
+                optWatchdog = watchdogSeconds;
+                if (optWatchdog != watchdogSeconds ||
+                        optWatchdog > INT_MAX / 1000)
+                    die("Watchdog period too large %lu", watchdogSeconds);
+
+                unsigned long graceSeconds = watchdogSeconds;
+                if (graceSep && int_strtoul(&graceSeconds, graceSep))
+                    die("Unable to parse watchdog grace %s", graceSep);
+
+                optWatchdogGrace = graceSeconds;
+                if (optWatchdogGrace != graceSeconds ||
+                        optWatchdogGrace > INT_MAX / 1000)
+                    die("Watchdog grace too large %lu", graceSeconds);
+            }
+            break;
+
         case 'Z':
             optContinue = 1; break;
 
@@ -151,6 +587,12 @@ parse_options(int argc, char **argv)
         }
     }
 
+    if (optIdle && !optListen)
+        die("Idle duration requires a listening address");
+
+    if (optDetects && match_compile(&optDetect))
+        die("Unable to compile output matcher");
+
     if (argc >= optind && !strcmp("--", argv[optind-1]))
         rc = 0;
 
@@ -166,6 +608,244 @@ Finally:
     return rc ? 0 : argv;
 }
 
+/******************************************************************************/
+static char **Argv_;
+
+static const char RespawnStateEnv[]   = "RESPAWN_STATE";
+static const char RespawnNotifyEnv[]  = "RESPAWN_NOTIFY";
+static const char RespawnFdStoreEnv[] = "RESPAWN_FDS";
+static const char RespawnListenEnv[]  = "RESPAWN_LISTEN";
+static const char RespawnReplicaEnv[] = "RESPAWN_REPLICA";
+static const char RespawnWatchdogEnv[] = "RESPAWN_WATCHDOG";
+static const char RespawnWatchdogSlotEnv[] = "RESPAWN_WATCHDOG_SLOT";
+
+enum StopReason {
+    StopNone,
+    StopIdle,
+    StopMemory,
+    StopRestart,
+    StopHung,
+    StopFault,
+};
+
+/* The output of each instance of the child process is captured using
+ * a pipe for each of stdout and stderr so that the output can be
+ * attributed to the instance that produced it. A stream remains open
+ * until the last writer closes it, even after the instance terminates. */
+
+struct RespawnStream {
+    int      mFd;
+    int      mFileNo;
+    unsigned mInstance;
+    int      mMidLine;
+    int      mReady;
+    uint32_t mMatchState;
+
+    struct RateBucket mBucket;
+    int               mDropLine;
+    uint64_t          mSuppressBytes;
+    uint64_t          mMarkerMillis;
+};
+
+struct StopLadder {
+    unsigned mStep;
+    uint64_t mStepMillis;
+};
+
+struct RespawnRetire {
+    pid_t             mPid;
+    struct StopLadder mLadder;
+};
+
+struct RespawnHandover {
+    pid_t    mPid;
+    unsigned mInstance;
+    uint64_t mStartMillis;
+    int      mFailed;
+    int      mReady;
+};
+
+struct RespawnState {
+    pid_t    mParentPid;
+    pid_t    mChildPid;
+    unsigned mChildInstance;
+    unsigned mSpawnInstance;
+
+    unsigned              mSpawnCount;
+    struct RestartBackoff mBackoff;
+
+    struct SignalBlock mSignalBlock;
+
+    int            mNotifyFd[2];
+    struct FdStore mFdStore;
+
+    int             mReplica;
+    int             mReportFd[2];
+    int             mListenFd;
+    uint64_t        mActivityMillis;
+    uint64_t        mActivateMillis;
+    enum StopReason mStopReason;
+
+    int mOriginNice;
+    int mOriginOom;
+
+    struct RespawnHandover mHandover;
+    unsigned               mRetireCount;
+    struct RespawnRetire   mRetire[RESPAWN_INSTANCE_MAX - 1];
+
+    struct Watchdog mWatchdog;
+    uint64_t        mWatchdogBeat;
+    uint64_t        mWatchdogMillis;
+    int             mWatchdogStarting;
+    unsigned        mHungCount;
+
+    int                  mSpawnStreamFd[2];
+    struct RespawnStream mStream[RESPAWN_STREAM_MAX];
+    uint64_t             mRelayBytes;
+    uint64_t             mSuppressBytes;
+};
+
+/* The state image comprises a header followed by a sequence of records.
+ * The layout of the header never changes, so that any image identifies
+ * the child process, whereas the version describes the framing and the
+ * encoding of the records that follow. Each record is tagged with the
+ * scalar field of the state that it holds, and its length, so that an
+ * image written by another build is read field by field. Unknown records
+ * are skipped, unless marked critical because they hold the processes
+ * or descriptors shared with the child process. A field that changes
+ * meaning needs a new tag.
+ *
+ * Each record holds a scalar field, or the same member of each element
+ * of an array, so that the image does not depend on the layout of the
+ * structures of either build. Integers are encoded as 64 bit values,
+ * text as its fixed length buffer, and a signal mask as a bitmap of 64
+ * bit words. Process local values, such as the mapping of the watchdog
+ * page, are not recorded, and are recreated on resumption. */
+
+static const char RespawnStateMagic[8] = "respawn";
+
+#define RESPAWN_IMAGE_VERSION  2
+#define RESPAWN_IMAGE_CRITICAL 0x80000000U
+
+#define RESPAWN_IMAGE_SIGNAL_WORDS ((NSIG + 63) / 64)
+
+struct RespawnImageHeader {
+    char     mMagic[sizeof(RespawnStateMagic)];
+    uint32_t mVersion;
+    uint32_t mSize;
+    int32_t  mParentPid;
+    int32_t  mChildPid;
+};
+
+struct RespawnImageRecord {
+    uint32_t mTag;
+    uint32_t mLen;
+};
+
+enum RespawnImageKind {
+    ImageSigned,
+    ImageUnsigned,
+    ImageText,
+    ImageSignals,
+};
+
+#define RESPAWN_IMAGE_FIELD_(aTag, aKind, aField) \
+    { aTag, aKind, offsetof(struct RespawnState, aField), \
+      sizeof(((struct RespawnState *) 0)->aField), 1, 0 }
+
+#define RESPAWN_IMAGE_EACH_(aTag, aKind, aArray, aMember) \
+    { aTag, aKind, offsetof(struct RespawnState, aArray[0] aMember), \
+      sizeof(((struct RespawnState *) 0)->aArray[0] aMember), \
+      NUMBEROF(((struct RespawnState *) 0)->aArray), \
+      sizeof(((struct RespawnState *) 0)->aArray[0]) }
+
+#define RESPAWN_IMAGE_INT(aTag, aField) \
+    RESPAWN_IMAGE_FIELD_(aTag, ImageSigned, aField)
+
+#define RESPAWN_IMAGE_UINT(aTag, aField) \
+    RESPAWN_IMAGE_FIELD_(aTag, ImageUnsigned, aField)
+
+#define RESPAWN_IMAGE_EACH_INT(aTag, aArray, aMember) \
+    RESPAWN_IMAGE_EACH_(aTag, ImageSigned, aArray, aMember)
+
+#define RESPAWN_IMAGE_EACH_UINT(aTag, aArray, aMember) \
+    RESPAWN_IMAGE_EACH_(aTag, ImageUnsigned, aArray, aMember)
+
+#define RESPAWN_IMAGE_EACH_TEXT(aTag, aArray, aMember) \
+    RESPAWN_IMAGE_EACH_(aTag, ImageText, aArray, aMember)
+
+#define RESPAWN_IMAGE_SIGNALS(aTag, aField) \
+    RESPAWN_IMAGE_FIELD_(aTag, ImageSignals, aField)
+
+static const struct RespawnImageField {
+    uint32_t              mTag;
+    enum RespawnImageKind mKind;
+    size_t                mOffset;
+    size_t                mSize;
+    size_t                mCount;
+    size_t                mStride;
+} RespawnImageField[] = {
+    RESPAWN_IMAGE_UINT( 1, mChildInstance),
+    RESPAWN_IMAGE_UINT( 2, mSpawnCount),
+    RESPAWN_IMAGE_UINT( 3, mBackoff.mAttempt),
+    RESPAWN_IMAGE_UINT( 4, mBackoff.mWindowSeconds),
+    RESPAWN_IMAGE_UINT( 5, mBackoff.mWindowStartMillis),
+    RESPAWN_IMAGE_SIGNALS( 6 | RESPAWN_IMAGE_CRITICAL, mSignalBlock.mSigSet),
+    RESPAWN_IMAGE_EACH_INT( 7 | RESPAWN_IMAGE_CRITICAL, mNotifyFd, ),
+    RESPAWN_IMAGE_UINT( 8 | RESPAWN_IMAGE_CRITICAL, mFdStore.mCount),
+    RESPAWN_IMAGE_EACH_INT( 9 | RESPAWN_IMAGE_CRITICAL, mFdStore.mEntry, .mFd),
+    RESPAWN_IMAGE_EACH_TEXT(10 | RESPAWN_IMAGE_CRITICAL,
+        mFdStore.mEntry, .mName),
+    RESPAWN_IMAGE_INT(11, mReplica),
+    RESPAWN_IMAGE_EACH_INT(12 | RESPAWN_IMAGE_CRITICAL, mReportFd, ),
+    RESPAWN_IMAGE_INT(13 | RESPAWN_IMAGE_CRITICAL, mListenFd),
+    RESPAWN_IMAGE_INT(14, mStopReason),
+    RESPAWN_IMAGE_INT(15, mOriginNice),
+    RESPAWN_IMAGE_INT(16, mOriginOom),
+    RESPAWN_IMAGE_INT(17 | RESPAWN_IMAGE_CRITICAL, mHandover.mPid),
+    RESPAWN_IMAGE_UINT(18 | RESPAWN_IMAGE_CRITICAL, mHandover.mInstance),
+    RESPAWN_IMAGE_UINT(19 | RESPAWN_IMAGE_CRITICAL, mHandover.mStartMillis),
+    RESPAWN_IMAGE_INT(20 | RESPAWN_IMAGE_CRITICAL, mHandover.mFailed),
+    RESPAWN_IMAGE_INT(21 | RESPAWN_IMAGE_CRITICAL, mHandover.mReady),
+    RESPAWN_IMAGE_UINT(22 | RESPAWN_IMAGE_CRITICAL, mRetireCount),
+    RESPAWN_IMAGE_EACH_INT(23 | RESPAWN_IMAGE_CRITICAL, mRetire, .mPid),
+    RESPAWN_IMAGE_EACH_UINT(24 | RESPAWN_IMAGE_CRITICAL,
+        mRetire, .mLadder.mStep),
+    RESPAWN_IMAGE_EACH_UINT(25 | RESPAWN_IMAGE_CRITICAL,
+        mRetire, .mLadder.mStepMillis),
+    RESPAWN_IMAGE_INT(26 | RESPAWN_IMAGE_CRITICAL, mWatchdog.mFd),
+    RESPAWN_IMAGE_UINT(27, mWatchdogBeat),
+    RESPAWN_IMAGE_UINT(28, mHungCount),
+    RESPAWN_IMAGE_INT(29, mWatchdogStarting),
+    RESPAWN_IMAGE_EACH_INT(30 | RESPAWN_IMAGE_CRITICAL, mStream, .mFd),
+    RESPAWN_IMAGE_EACH_INT(31 | RESPAWN_IMAGE_CRITICAL, mStream, .mFileNo),
+    RESPAWN_IMAGE_EACH_UINT(32 | RESPAWN_IMAGE_CRITICAL, mStream, .mInstance),
+    RESPAWN_IMAGE_EACH_INT(33, mStream, .mMidLine),
+    RESPAWN_IMAGE_EACH_INT(34, mStream, .mReady),
+    RESPAWN_IMAGE_EACH_UINT(35, mStream, .mMatchState),
+    RESPAWN_IMAGE_EACH_UINT(36, mStream, .mBucket.mRate),
+    RESPAWN_IMAGE_EACH_UINT(37, mStream, .mBucket.mBurst),
+    RESPAWN_IMAGE_EACH_INT(38, mStream, .mBucket.mCredit),
+    RESPAWN_IMAGE_EACH_UINT(39, mStream, .mBucket.mMillis),
+    RESPAWN_IMAGE_EACH_INT(40, mStream, .mDropLine),
+    RESPAWN_IMAGE_EACH_UINT(41, mStream, .mSuppressBytes),
+    RESPAWN_IMAGE_EACH_UINT(42, mStream, .mMarkerMillis),
+    RESPAWN_IMAGE_UINT(43, mRelayBytes),
+    RESPAWN_IMAGE_UINT(44, mSuppressBytes),
+};
+
+/* Every scalar is no larger than its encoding, except the signal mask
+ * which is encoded more compactly, so the encoded state is bounded by
+ * twice the size of the state itself. */
+
+struct RespawnImage {
+    struct RespawnImageHeader mHeader;
+    char mRecords[
+        NUMBEROF(RespawnImageField) * sizeof(struct RespawnImageRecord) +
+        2 * sizeof(struct RespawnState) +
+        RESPAWN_IMAGE_SIGNAL_WORDS * sizeof(uint64_t)];
+};
+
 /******************************************************************************/
 void
 terminate(void)
@@ -178,211 +858,257 @@ terminate(void)
 
 /******************************************************************************/
 int
-spawn_command(char **aCmd, int aMonitorFd)
+stop_command(pid_t aPid, struct StopLadder *aLadder)
 {
-    int rc = -1;
+    int waitMillis = -1;
 
-    pid_t childPid = proc_execute(aCmd);
-    if (-1 == childPid) {
-        warn("Unable to spawn command %s", aCmd[0]);
-        goto Finally;
-    }
+    /* Allow a child process that is stopped time to terminate gracefully
+     * after SIGTERM is delivered, before resorting to SIGKILL. */
 
-    while (1) {
+    static const int StopSignal[] = { SIGTERM, SIGKILL };
 
-        /* Propagate all caught signals to the child process. The child
-         * might choose to ignore or catch the signals, and might not
-         * terminate.
-         *
-         * https://people.freebsd.org/~cracauer/homepage-mirror/sigint.html
-         */
+    static const unsigned StopGraceMillis = 3000;
 
-        sig_atomic_t sigSet = signalset_sample();
+    uint64_t nowMillis = clk_monomillis();
 
-        for (int signal = 0; sigSet; ++signal) {
-            if (sigSet & 1) {
-                DEBUG(
-                    "Delivering signal %d to child process %d",
-                    signal, childPid);
+    if (aLadder->mStep) {
 
-                kill(childPid, signal);
-            }
-            sigSet >>= 1;
-        }
+        uint64_t stepDuration = nowMillis - aLadder->mStepMillis;
 
-        int procEvent = proc_monitor_wait(aMonitorFd);
-        if (-1 == procEvent) {
-            warn("Unable to wait for process monitor");
+        if (stepDuration < StopGraceMillis) {
+            waitMillis = StopGraceMillis - stepDuration;
             goto Finally;
         }
+    }
 
-        if (procEvent) {
+    if (aLadder->mStep < NUMBEROF(StopSignal)) {
 
-            /* If the process must be parented, and the parent has exited,
-             * there is no parent waiting for exit status.
-             */
+        int stopSignal = StopSignal[aLadder->mStep++];
 
-            DEBUG("Parent process %d exited", procEvent);
+        DEBUG("Stopping child process %d signal %d", aPid, stopSignal);
 
-            terminate();
-            goto Finally;
-        }
+        TRACE(TraceInstant, "terminate", aPid, stopSignal);
 
-        int childStatus;
+        proc_kill(aPid, stopSignal);
 
-        pid_t pid = waitpid(childPid, &childStatus, WNOHANG|WUNTRACED);
-        if (-1 == pid) {
-            if (EINTR == errno)
-                continue;
-            warn("Unable to wait for child process %d", childPid);
-            goto Finally;
-        }
+        aLadder->mStepMillis = nowMillis;
 
-        if (pid) {
+        if (aLadder->mStep < NUMBEROF(StopSignal))
+            waitMillis = StopGraceMillis;
+    }
 
-            if (WIFSTOPPED(childStatus)) {
-                int stopSig = WSTOPSIG(childStatus);
+Finally:
 
-                DEBUG("Child process %d stopped signal %d", childPid, stopSig);
+    return waitMillis;
+}
 
-                /* http://curiousthing.org/sigttin-sigttou-deep-dive-linux */
+/******************************************************************************/
+int
+share_state(const struct RespawnState *aState, int aShare)
+{
+    int rc = -1;
 
-                if (SIGSTOP == stopSig || SIGTSTP == stopSig) {
-                    if (optContinue) {
-                        signalset_add(SIGCONT);
-                        stopSig = 0;
-                    }
-                }
+    if (notify_share(aState->mNotifyFd, aShare))
+        goto Finally;
 
-                if (stopSig) {
-                    if (kill(getpid(), stopSig)) {
-                        warn("Unable to stop process after signal %d", stopSig);
-                    }
-                }
+    if (notify_share(aState->mReportFd, aShare))
+        goto Finally;
 
-                continue;
-            }
+    if (fdstore_share(&aState->mFdStore, aShare))
+        goto Finally;
 
-            if (WIFEXITED(childStatus)) {
-                int exitStatus = WEXITSTATUS(childStatus);
+    if (-1 != aState->mListenFd) {
+        if (aShare ? fd_inherit(aState->mListenFd)
+                   : fd_cloexec(aState->mListenFd))
+            goto Finally;
+    }
 
-                DEBUG("Child process %d exit status %d", childPid, exitStatus);
-                rc = 0x000 + exitStatus;
-            }
-            else if (WIFSIGNALED(childStatus)) {
-                int termSig = WTERMSIG(childStatus);
+    if (-1 != aState->mWatchdog.mFd) {
+        if (aShare ? fd_inherit(aState->mWatchdog.mFd)
+                   : fd_cloexec(aState->mWatchdog.mFd))
+            goto Finally;
+    }
 
-                DEBUG("Child process %d termination signal %d", childPid, termSig);
-                rc = 0x100 + termSig;
-            }
+    for (unsigned ix = 0; ix < NUMBEROF(aState->mStream); ++ix) {
+        int streamFd = aState->mStream[ix].mFd;
 
-            break;
+        if (-1 != streamFd) {
+            if (aShare ? fd_inherit(streamFd) : fd_cloexec(streamFd))
+                goto Finally;
         }
     }
 
+    rc = 0;
+
 Finally:
 
     return rc;
 }
 
 /******************************************************************************/
-int
-respawn_command(char **aCmd, int aMonitorFd)
+void
+watchdog_reset(struct RespawnState *aState, int aStarting)
 {
-    int rc = -1;
+    /* Each instance beats in its own slot, so that the heartbeats of
+     * an instance that is being retired do not hide a hung instance
+     * that replaced it. */
 
-    int exitCode;
+    if (aState->mWatchdog.mBeat) {
+        if (aStarting)
+            aState->mWatchdogStarting = 1;
 
-    unsigned spawnCount = 0;
-    unsigned spawnAttempt = 0;
+        aState->mWatchdogBeat = watchdog_beat(
+            &aState->mWatchdog, aState->mChildInstance);
+        aState->mWatchdogMillis = clk_monomillis();
+    }
+}
 
-    unsigned backoffWindowSeconds = 0;
+/******************************************************************************/
+void
+age_state(struct RespawnState *aState, uint64_t aNowMillis)
+{
+    /* Convert the monotonic timestamps of instances that are being
+     * started or stopped to their ages, or convert their ages back
+     * to timestamps. The conversion is its own inverse. */
 
-    uint64_t windowStartMillis = clk_monomillis();
+    if (aState->mHandover.mPid)
+        aState->mHandover.mStartMillis =
+            aNowMillis - aState->mHandover.mStartMillis;
 
-    while (1) {
+    for (unsigned ix = 0; ix < aState->mRetireCount; ++ix) {
+        struct StopLadder *ladder = &aState->mRetire[ix].mLadder;
 
-        ++spawnCount;
-        ++spawnAttempt;
+        if (ladder->mStep)
+            ladder->mStepMillis = aNowMillis - ladder->mStepMillis;
+    }
 
-        DEBUG("Spawning count %u attempt %u", spawnCount, spawnAttempt);
+    /* The rate limit of each open stream continues to accrue from the
+     * time it was last refilled, rather than from the upgrade. */
 
-        signal_catch();
-        exitCode = spawn_command(aCmd, aMonitorFd);
-        signal_release();
+    for (unsigned ix = 0; ix < NUMBEROF(aState->mStream); ++ix) {
+        struct RespawnStream *stream = &aState->mStream[ix];
 
-        uint64_t windowEndMillis = clk_monomillis();
+        if (-1 != stream->mFd) {
+            stream->mBucket.mMillis = aNowMillis - stream->mBucket.mMillis;
+            stream->mMarkerMillis   = aNowMillis - stream->mMarkerMillis;
+        }
+    }
+}
 
-        uint64_t runDurationMillis = windowEndMillis - windowStartMillis;
+/******************************************************************************/
+size_t
+image_element_len(const struct RespawnImageField *aField)
+{
+    switch (aField->mKind) {
+    default:
+        return sizeof(uint64_t);
+    case ImageText:
+        return aField->mSize;
+    case ImageSignals:
+        return RESPAWN_IMAGE_SIGNAL_WORDS * sizeof(uint64_t);
+    }
+}
 
-        if (-1 == exitCode)
-            goto Finally;
+/*----------------------------------------------------------------------------*/
+char *
+encode_field(char *aRecord,
+             const struct RespawnImageField *aField, const char *aFieldPtr)
+{
+    /* Widen each integer to 64 bits, extending the sign of signed
+     * fields so that the value is preserved in a field of any width. */
 
-        /* Normally only restart the process if it failed to exit
-         * with EXIT_SUCCESS and did not terminate due to a signal. */
+    if (ImageSignals == aField->mKind) {
+        const sigset_t *sigSet = (const sigset_t *) aFieldPtr;
 
-        if (!optForever) {
-            if (0 <= exitCode && exitCode < NUMBEROF(optExit)) {
-                if (optExit[exitCode])
-                    break;
-            }
+        uint64_t sigWord[RESPAWN_IMAGE_SIGNAL_WORDS] = { 0 };
 
-            if (exitCode >= 0x100)
-                break;
+        for (int signal = 1; signal < NSIG; ++signal) {
+            if (1 == sigismember(sigSet, signal))
+                sigWord[(signal - 1) / 64] |= 1ULL << (signal - 1) % 64;
         }
 
-        /* Classify the duration that the program runs. Durations less
-         * than 1s are considered short, and imply that there is an
-         * issue starting the program. Durations between 1s and 60s
-         * imply that there is a problem initialising the program
-         * (eg issue connecting to remote). Durations longer than 60s
-         * are considered long, and imply that the program initialised
-         * successfully but terminated unexpectedly. */
+        memcpy(aRecord, sigWord, sizeof(sigWord));
+        aRecord += sizeof(sigWord);
 
-        static const unsigned ShortDurationMillis = 1000;
-        static const unsigned LongDurationMillis  = 60000;
+    } else if (ImageText == aField->mKind) {
+        memcpy(aRecord, aFieldPtr, aField->mSize);
+        aRecord += aField->mSize;
 
-        if (runDurationMillis <= ShortDurationMillis) {
+    } else {
+        uint64_t value;
 
-            /* Reset the backoff window because the previous attempt
-             * terminated so quickly. */
+        if (sizeof(uint64_t) == aField->mSize) {
+            memcpy(&value, aFieldPtr, sizeof(value));
+        } else {
+            uint32_t narrow;
 
-            backoffWindowSeconds = 0;
+            memcpy(&narrow, aFieldPtr, sizeof(narrow));
 
-            /* Limit the number of attempts within a 1s window to
-             * limit the number of attempts to start a broken program. */
+            value = ImageSigned == aField->mKind
+                ? (uint64_t) (int64_t) (int32_t) narrow
+                : narrow;
+        }
 
-            if (spawnAttempt >= 10) {
-                errno = 0;
-                error("Failed to start %s", aCmd[0]);
-                goto Finally;
-            }
+        memcpy(aRecord, &value, sizeof(value));
+        aRecord += sizeof(value);
+    }
+
+    return aRecord;
+}
 
-            /* Limit the retries so that a broken program cannot
-             * overwhelm the host. */
+/*----------------------------------------------------------------------------*/
+int
+decode_field(char *aFieldPtr,
+             const struct RespawnImageField *aField, const char *aRecord)
+{
+    int rc = -1;
 
-            clk_sleepmillis(1);
+    /* Reject values that do not fit the field in this build, rather than
+     * truncate them. When decoding to a null field, only validate. */
 
-        } else {
+    if (ImageSignals == aField->mKind) {
+        uint64_t sigWord[RESPAWN_IMAGE_SIGNAL_WORDS];
 
-            /* Reset the backoff window if the previous attempt ran
-             * for a significant period of time. Otherwise, use the
-             * backoff window to try to restart the program. */
+        memcpy(sigWord, aRecord, sizeof(sigWord));
 
-            if (runDurationMillis > LongDurationMillis)
-                backoffWindowSeconds = 0;
-            else {
-                if (backoffWindowSeconds < 60)
-                    backoffWindowSeconds = (backoffWindowSeconds + 1) * 2;
+        if (aFieldPtr) {
+            sigset_t *sigSet = (sigset_t *) aFieldPtr;
 
-                unsigned backoffDelay = rand() % backoffWindowSeconds;
+            sigemptyset(sigSet);
 
-                DEBUG("Waiting %us before respawning", backoffDelay);
-                clk_sleepmillis(backoffDelay * 1000);
+            for (int signal = 1; signal < NSIG; ++signal) {
+                if (sigWord[(signal - 1) / 64] & 1ULL << (signal - 1) % 64)
+                    sigaddset(sigSet, signal);
             }
+        }
+
+    } else if (ImageText == aField->mKind) {
+        if (!memchr(aRecord, 0, aField->mSize))
+            goto Finally;
+
+        if (aFieldPtr)
+            memcpy(aFieldPtr, aRecord, aField->mSize);
+
+    } else {
+        uint64_t value;
 
-            windowStartMillis = windowEndMillis;
-            spawnAttempt = 0;
+        memcpy(&value, aRecord, sizeof(value));
+
+        if (sizeof(uint64_t) == aField->mSize) {
+            if (aFieldPtr)
+                memcpy(aFieldPtr, &value, sizeof(value));
+        } else {
+            uint32_t narrow = value;
+
+            uint64_t widened = ImageSigned == aField->mKind
+                ? (uint64_t) (int64_t) (int32_t) narrow
+                : narrow;
+
+            if (widened != value)
+                goto Finally;
+
+            if (aFieldPtr)
+                memcpy(aFieldPtr, &narrow, sizeof(narrow));
         }
     }
 
@@ -390,50 +1116,2739 @@ respawn_command(char **aCmd, int aMonitorFd)
 
 Finally:
 
-    return rc ? rc : exitCode;
+    return rc;
 }
 
 /******************************************************************************/
 int
-main(int argc, char **argv)
+upgrade_command(struct RespawnState *aState)
 {
-    int exitCode = 255;
-    int monitorFd = -1;
+    int rc = -1;
 
-    srand(getpid());
+    int imageFd = -1;
+    int shared  = 0;
 
-    char **cmd = parse_options(argc, argv);
-    if (!cmd || !cmd[0])
-        usage();
+    struct SignalBlock signalBlock;
 
-    pid_t parentPid = 0;
-    if (optParented) {
-        parentPid = getppid();
-        if (1 >= parentPid)
-            goto Finally;
-    }
+    /* Hold all signals pending across the exec so that none are lost
+     * or acted upon using their default action. The new image will
+     * release the signals once it has installed its own catchers. */
 
-    monitorFd = proc_monitor_create(parentPid);
-    if (-1 == monitorFd) {
-        warn("Unable to create proc monitor");
+    signal_block_acquire(&signalBlock);
+
+    struct RespawnState imageState = *aState;
+
+    imageState.mSignalBlock = signalBlock;
+
+    /* The clocks are relative to program initialisation, so only
+     * the elapsed time since each timestamp can be carried across
+     * to the new image. */
+
+    imageState.mBackoff.mWindowStartMillis =
+        clk_bootmillis() - aState->mBackoff.mWindowStartMillis;
+
+    age_state(&imageState, clk_monomillis());
+
+    struct RespawnImage image;
+
+    memset(&image, 0, sizeof(image));
+    memcpy(image.mHeader.mMagic,
+        RespawnStateMagic, sizeof(image.mHeader.mMagic));
+
+    image.mHeader.mVersion   = RESPAWN_IMAGE_VERSION;
+    image.mHeader.mParentPid = aState->mParentPid;
+    image.mHeader.mChildPid  = aState->mChildPid;
+
+    char *recordPtr = image.mRecords;
+
+    for (unsigned ix = 0; ix < NUMBEROF(RespawnImageField); ++ix) {
+        const struct RespawnImageField *field = &RespawnImageField[ix];
+
+        struct RespawnImageRecord record = {
+            .mTag = field->mTag,
+            .mLen = field->mCount * image_element_len(field),
+        };
+
+        memcpy(recordPtr, &record, sizeof(record));
+        recordPtr += sizeof(record);
+
+        const char *fieldPtr = (const char *) &imageState + field->mOffset;
+
+        for (unsigned ex = 0; ex < field->mCount; ++ex) {
+            recordPtr = encode_field(recordPtr, field, fieldPtr);
+            fieldPtr += field->mStride;
+        }
+    }
+
+    image.mHeader.mSize = recordPtr - (char *) &image;
+
+    imageFd = fd_anonymous(RespawnStateMagic);
+    if (-1 == imageFd) {
+        warn("Unable to create state image");
+        goto Finally;
+    }
+
+    if (image.mHeader.mSize != fd_write(
+            imageFd, (void *) &image, image.mHeader.mSize)) {
+        warn("Unable to write state image");
+        goto Finally;
+    }
+
+    if (lseek(imageFd, 0, SEEK_SET)) {
+        warn("Unable to rewind state image");
+        goto Finally;
+    }
+
+    if (fd_inherit(imageFd)) {
+        warn("Unable to share state image");
+        goto Finally;
+    }
+
+    /* The descriptors shared with the child process are retained
+     * across the exec so that the child process is not disturbed. */
+
+    shared = 1;
+
+    if (share_state(aState, 1)) {
+        warn("Unable to share supervisor descriptors");
+        goto Finally;
+    }
+
+    char imageEnv[sizeof(int) * CHAR_BIT];
+    snprintf(imageEnv, sizeof(imageEnv), "%d", imageFd);
+
+    if (setenv(RespawnStateEnv, imageEnv, 1)) {
+        warn("Unable to set %s", RespawnStateEnv);
+        goto Finally;
+    }
+
+    DEBUG("Upgrading %s with child process %d", Argv_[0], aState->mChildPid);
+
+    /* Abandon probes that are running because the new image will not
+     * know to collect them. */
+
+    probe_reset(optProbe, optProbes, 0);
+
+    execvp(Argv_[0], Argv_);
+
+    warn("Unable to upgrade %s", Argv_[0]);
+
+    unsetenv(RespawnStateEnv);
+
+Finally:
+
+    FINALLY({
+        imageFd = fd_close(imageFd);
+
+        if (shared) {
+            if (share_state(aState, 0))
+                warn("Unable to reclaim supervisor descriptors");
+        }
+
+        signal_block_release(&signalBlock);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+decode_image(struct RespawnState *aState,
+             uint32_t aVersion, const char *aRecords, size_t aLen)
+{
+    int rc = -1;
+
+    if (RESPAWN_IMAGE_VERSION != aVersion)
+        goto Finally;
+
+    while (aLen) {
+
+        struct RespawnImageRecord record;
+
+        if (sizeof(record) > aLen)
+            goto Finally;
+
+        memcpy(&record, aRecords, sizeof(record));
+
+        aRecords += sizeof(record);
+        aLen     -= sizeof(record);
+
+        if (record.mLen > aLen)
+            goto Finally;
+
+        const struct RespawnImageField *field = 0;
+
+        for (unsigned ix = 0; ix < NUMBEROF(RespawnImageField); ++ix) {
+            if (record.mTag == RespawnImageField[ix].mTag) {
+                field = &RespawnImageField[ix];
+                break;
+            }
+        }
+
+        /* An array can be shorter than that of this build, in which
+         * case the remaining elements retain their initial values. Every
+         * element is validated before any is decoded so that a record
+         * is either accepted or skipped in its entirety. */
+
+        int accept = 0;
+
+        if (field) {
+            size_t elementLen = image_element_len(field);
+
+            size_t count = record.mLen / elementLen;
+
+            accept =
+                record.mLen && !(record.mLen % elementLen) &&
+                count <= field->mCount;
+
+            for (unsigned ex = 0; accept && ex < count; ++ex) {
+                if (decode_field(0, field, aRecords + ex * elementLen))
+                    accept = 0;
+            }
+
+            for (unsigned ex = 0; accept && ex < count; ++ex) {
+                decode_field(
+                    (char *) aState + field->mOffset + ex * field->mStride,
+                    field, aRecords + ex * elementLen);
+            }
+        }
+
+        if (!accept) {
+            if (record.mTag & RESPAWN_IMAGE_CRITICAL) {
+                DEBUG("Incompatible state record %#" PRIx32
+                    " length %" PRIu32, record.mTag, record.mLen);
+                goto Finally;
+            }
+
+            DEBUG("Skipping state record %#" PRIx32 " length %" PRIu32,
+                record.mTag, record.mLen);
+        }
+
+        aRecords += record.mLen;
+        aLen     -= record.mLen;
+    }
+
+    if (aState->mRetireCount > NUMBEROF(aState->mRetire))
+        goto Finally;
+
+    for (unsigned ix = 0; ix < aState->mRetireCount; ++ix) {
+        if (0 >= aState->mRetire[ix].mPid)
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+abandon_image(struct RespawnState *aState)
+{
+    /* Without a compatible image, the descriptors shared with the child
+     * process cannot all be recovered, so the child process cannot be
+     * supervised. Rather than leave the child process, and any other
+     * instances that are known, unsupervised, stop them so that
+     * supervision can start afresh. */
+
+    static const unsigned AbandonPollMillis = 10;
+
+    pid_t             stopPid[2 + NUMBEROF(aState->mRetire)];
+    struct StopLadder stopLadder[NUMBEROF(stopPid)];
+
+    unsigned stopCount = 0;
+
+    if (0 < aState->mChildPid)
+        stopPid[stopCount++] = aState->mChildPid;
+
+    if (0 < aState->mHandover.mPid)
+        stopPid[stopCount++] = aState->mHandover.mPid;
+
+    for (unsigned ix = 0; ix < aState->mRetireCount; ++ix) {
+        if (ix < NUMBEROF(aState->mRetire) && 0 < aState->mRetire[ix].mPid)
+            stopPid[stopCount++] = aState->mRetire[ix].mPid;
+    }
+
+    memset(stopLadder, 0, sizeof(stopLadder));
+
+    while (stopCount) {
+
+        for (unsigned ix = 0; ix < stopCount; ) {
+
+            int stopStatus;
+
+            pid_t pid = proc_wait(stopPid[ix], &stopStatus, WNOHANG, 0);
+            if (-1 == pid)
+                warn("Unable to wait for process %d", stopPid[ix]);
+
+            if (pid) {
+                DEBUG("Abandoned process %d", stopPid[ix]);
+
+                --stopCount;
+                stopPid[ix]    = stopPid[stopCount];
+                stopLadder[ix] = stopLadder[stopCount];
+                continue;
+            }
+
+            stop_command(stopPid[ix], &stopLadder[ix]);
+
+            ++ix;
+        }
+
+        if (stopCount)
+            clk_sleepmillis(AbandonPollMillis);
+    }
+
+    /* Prevent the descriptors that were recovered from leaking into the
+     * new child process, and release the signals held pending across the
+     * exec, using an empty mask if the mask was not recovered. */
+
+    if (share_state(aState, 0))
+        warn("Unable to reclaim supervisor descriptors");
+
+    signal_block_release(&aState->mSignalBlock);
+}
+
+/*----------------------------------------------------------------------------*/
+int
+resume_command(struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int   imageFd      = -1;
+    char *imageRecords = 0;
+
+    const char *imageEnv = getenv(RespawnStateEnv);
+    if (!imageEnv) {
+        rc = 0;
+        goto Finally;
+    }
+
+    unsigned long imageArg;
+    if (int_strtoul(&imageArg, imageEnv) || imageArg > INT_MAX) {
+        warn("Unable to parse %s %s", RespawnStateEnv, imageEnv);
+        goto Finally;
+    }
+
+    imageFd = imageArg;
+
+    if (fd_cloexec(imageFd)) {
+        warn("Unable to access state image fd %d", imageFd);
+        goto Finally;
+    }
+
+    struct RespawnImageHeader header;
+
+    ssize_t headerLen = fd_read(imageFd, (void *) &header, sizeof(header));
+    if (-1 == headerLen) {
+        warn("Unable to read state image");
+        goto Finally;
+    }
+
+    if (sizeof(header) != headerLen ||
+            sizeof(header) > header.mSize ||
+            memcmp(header.mMagic, RespawnStateMagic, sizeof(header.mMagic))) {
+        errno = 0;
+        warn("Unrecognised state image");
+        goto Finally;
+    }
+
+    size_t recordsLen = header.mSize - sizeof(header);
+
+    imageRecords = malloc(recordsLen ? recordsLen : 1);
+    if (!imageRecords) {
+        warn("Unable to allocate state image");
+        goto Finally;
+    }
+
+    if (recordsLen != fd_read(imageFd, imageRecords, recordsLen)) {
+        warn("Unable to read state image");
+        goto Finally;
+    }
+
+    /* Decode the image over the initial state so that fields that are
+     * not present in the image retain their initial values. */
+
+    struct RespawnState imageState = *aState;
+
+    imageState.mParentPid = header.mParentPid;
+    imageState.mChildPid  = header.mChildPid;
+
+    if (decode_image(&imageState, header.mVersion, imageRecords, recordsLen)) {
+        errno = 0;
+        warn("Incompatible state image version %" PRIu32
+             " with child process %d", header.mVersion, imageState.mChildPid);
+
+        abandon_image(&imageState);
+
+        rc = 0;
+        goto Finally;
+    }
+
+    *aState = imageState;
+
+    if (share_state(aState, 0)) {
+        warn("Unable to reclaim supervisor descriptors");
+        goto Finally;
+    }
+
+    /* The mapping of the watchdog page does not survive the exec, and
+     * is not recorded in the image, so recreate it from the retained
+     * descriptor. */
+
+    if (-1 != aState->mWatchdog.mFd) {
+        if (watchdog_attach(&aState->mWatchdog)) {
+            warn("Unable to map watchdog");
+            goto Finally;
+        }
+    }
+
+    aState->mActivityMillis = clk_monomillis();
+    aState->mActivateMillis = 0;
+
+    /* Rebase the timestamps on the clocks of this image. The arithmetic
+     * is modulo 2^64 so that elapsed durations remain correct even if
+     * the timestamps precede program initialisation. */
+
+    aState->mBackoff.mWindowStartMillis =
+        clk_bootmillis() - aState->mBackoff.mWindowStartMillis;
+
+    age_state(aState, clk_monomillis());
+
+    /* The watchdog period restarts because the time of the last
+     * heartbeat was measured with the clock of the previous image. */
+
+    watchdog_reset(aState, 0);
+
+    DEBUG("Resuming child process %d", aState->mChildPid);
+
+    rc = 1;
+
+Finally:
+
+    FINALLY({
+        if (imageEnv)
+            unsetenv(RespawnStateEnv);
+
+        free(imageRecords);
+
+        imageFd = fd_close(imageFd);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+prepare_command(void *aArg)
+{
+    int rc = -1;
+
+    const struct RespawnState *state = aArg;
+
+    /* Publish the notification channel, and the descriptors retained
+     * from earlier instances, to the child process. */
+
+    if (-1 != state->mNotifyFd[1]) {
+
+        if (fd_inherit(state->mNotifyFd[1]))
+            goto Finally;
+
+        char notifyEnv[sizeof(int) * CHAR_BIT];
+        snprintf(notifyEnv, sizeof(notifyEnv), "%d", state->mNotifyFd[1]);
+
+        if (setenv(RespawnNotifyEnv, notifyEnv, 1))
+            goto Finally;
+
+        if (fdstore_share(&state->mFdStore, 1))
+            goto Finally;
+
+        if (fdstore_export(&state->mFdStore, RespawnFdStoreEnv))
+            goto Finally;
+    }
+
+    if (0 <= state->mReplica) {
+
+        char replicaEnv[sizeof(int) * CHAR_BIT];
+        snprintf(replicaEnv, sizeof(replicaEnv), "%d", state->mReplica);
+
+        if (setenv(RespawnReplicaEnv, replicaEnv, 1))
+            goto Finally;
+    }
+
+    /* Each replica is bound to a single cpu from the list in turn,
+     * whereas a single process is bound to all the cpus in the list. */
+
+    if (optCpus.mCount) {
+        if (tune_cpus_apply(&optCpus, state->mReplica))
+            goto Finally;
+    }
+
+    if (optMemBind.mCount) {
+        if (tune_nodes_apply(&optMemBind))
+            goto Finally;
+    }
+
+    if (-1 != optSched.mPolicy) {
+        if (tune_sched_apply(&optSched))
+            goto Finally;
+    }
+
+    /* A protected supervisor must not pass its own nice value and
+     * oom score adjustment to the child, so restore the values that
+     * the supervisor originally started with unless others are
+     * specified. */
+
+    int childNice = optNice;
+    if (INT_MIN == childNice && optProtect)
+        childNice = state->mOriginNice;
+
+    if (INT_MIN != childNice) {
+        if (tune_nice_set(childNice))
+            goto Finally;
+    }
+
+    if (-1 != optIoPrio) {
+        if (tune_ioprio_apply(optIoPrio))
+            goto Finally;
+    }
+
+    int childOom = optOom;
+    if (INT_MIN == childOom && optProtect)
+        childOom = state->mOriginOom;
+
+    if (INT_MIN != childOom) {
+        if (tune_oom_set(childOom))
+            goto Finally;
+    }
+
+    /* Redirect stdout and stderr to the pipes so that the supervisor
+     * can scan the output before relaying it. */
+
+    for (unsigned ix = 0; ix < NUMBEROF(state->mSpawnStreamFd); ++ix) {
+
+        int streamFd = state->mSpawnStreamFd[ix];
+
+        if (-1 != streamFd) {
+            if (STDOUT_FILENO + ix != dup2(streamFd, STDOUT_FILENO + ix))
+                goto Finally;
+        }
+    }
+
+    if (-1 != state->mWatchdog.mFd) {
+
+        if (fd_inherit(state->mWatchdog.mFd))
+            goto Finally;
+
+        char watchdogEnv[sizeof(int) * CHAR_BIT];
+        snprintf(watchdogEnv, sizeof(watchdogEnv), "%d", state->mWatchdog.mFd);
+
+        if (setenv(RespawnWatchdogEnv, watchdogEnv, 1))
+            goto Finally;
+
+        char slotEnv[sizeof(int) * CHAR_BIT];
+        snprintf(slotEnv, sizeof(slotEnv),
+            "%u", state->mSpawnInstance % WATCHDOG_SLOTS);
+
+        if (setenv(RespawnWatchdogSlotEnv, slotEnv, 1))
+            goto Finally;
+    }
+
+    if (-1 != state->mListenFd) {
+
+        if (fd_inherit(state->mListenFd))
+            goto Finally;
+
+        char listenEnv[sizeof(int) * CHAR_BIT];
+        snprintf(listenEnv, sizeof(listenEnv), "%d", state->mListenFd);
+
+        if (setenv(RespawnListenEnv, listenEnv, 1))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+void
+report_load(struct RespawnState *aState, const char *aLoad)
+{
+    /* Relay the load reported by the child process, as a percentage
+     * of its capacity, to the pool that is scaling the replicas. */
+
+    if (-1 == aState->mReportFd[1])
+        return;
+
+    unsigned long childLoad;
+
+    if (int_strtoul(&childLoad, aLoad)) {
+        if (strcmp("0", aLoad)) {
+            DEBUG("Ignoring load %s", aLoad);
+            return;
+        }
+        childLoad = 0;
+    }
+
+    char reportMsg[64];
+
+    snprintf(reportMsg, sizeof(reportMsg),
+        "LOAD=%d:%lu", aState->mReplica, childLoad);
+
+    if (notify_send(aState->mReportFd[1], reportMsg)) {
+        DEBUG("Unable to report load %lu", childLoad);
+    }
+}
+
+/******************************************************************************/
+void
+receive_notification(struct RespawnState *aState)
+{
+    if (-1 == aState->mNotifyFd[0])
+        return;
+
+    while (1) {
+
+        char notifyMsg[1024];
+        int  notifyFd;
+
+        ssize_t notifyLen = notify_receive(
+            aState->mNotifyFd[0], notifyMsg, sizeof(notifyMsg), &notifyFd);
+
+        if (-1 == notifyLen) {
+            warn("Unable to receive notification");
+            break;
+        }
+
+        if (!notifyLen) {
+            notifyFd = fd_close(notifyFd);
+            break;
+        }
+
+        /* Each notification comprises newline separated assignments,
+         * and a descriptor can be attached to the notification. */
+
+        char *lastSep;
+
+        char *assignList = notifyMsg;
+
+        while (1) {
+            char *assignment = strtok_r(assignList, "\n", &lastSep);
+
+            if (!assignment)
+                break;
+
+            assignList = 0;
+
+            char *value = strchr(assignment, '=');
+            if (!value) {
+                DEBUG("Ignoring notification %s", assignment);
+                continue;
+            }
+
+            *value++ = 0;
+
+            if (!strcmp("FDSTORE", assignment)) {
+
+                /* The notification channel is also created for other
+                 * options, so only retain descriptors when the store
+                 * was requested. */
+
+                if (!optFdStore) {
+                    DEBUG("Ignoring notification %s", assignment);
+                    notifyFd = fd_close(notifyFd);
+                } else {
+                    fdstore_put(&aState->mFdStore, value, notifyFd);
+                    notifyFd = -1;
+                }
+            } else if (!strcmp("ACTIVE", assignment)) {
+                aState->mActivityMillis = clk_coarsemillis();
+            } else if (!strcmp("LOAD", assignment)) {
+                report_load(aState, value);
+            } else if (!strcmp("READY", assignment)) {
+                aState->mHandover.mReady = 1;
+
+                TRACE(TraceInstant, "ready",
+                    aState->mHandover.mPid
+                        ? aState->mHandover.mPid : aState->mChildPid, 0);
+            } else if (!strcmp("RESTART", assignment)) {
+                if (StopNone == aState->mStopReason)
+                    aState->mStopReason = StopRestart;
+            } else {
+                DEBUG("Ignoring notification %s", assignment);
+            }
+        }
+
+        notifyFd = fd_close(notifyFd);
+    }
+}
+
+/******************************************************************************/
+int
+idle_command(struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int waitMillis = -1;
+
+    uint64_t nowMillis = clk_monomillis();
+
+    uint64_t idleMillis   = nowMillis - aState->mActivityMillis;
+    uint64_t idleDuration = optIdle * 1000;
+
+    if (idleMillis >= idleDuration) {
+
+        /* A pending connection or datagram indicates that the
+         * child process still has work to do. */
+
+        int pending = sock_pending(aState->mListenFd);
+        if (-1 == pending) {
+            warn("Unable to poll listening socket");
+            goto Finally;
+        }
+
+        if (pending) {
+            aState->mActivityMillis = nowMillis;
+            idleMillis = 0;
+        }
+    }
+
+    if (idleMillis < idleDuration)
+        waitMillis = idleDuration - idleMillis;
+    else {
+        DEBUG("Child process %d is idle", aState->mChildPid);
+
+        aState->mStopReason = StopIdle;
+        waitMillis = 0;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : waitMillis;
+}
+
+/******************************************************************************/
+struct MemoryWatch {
+    uint64_t mSampleMillis;
+    uint64_t mWindowMillis;
+    uint64_t mWindowBytes;
+    unsigned mWindowGrowth;
+};
+
+int
+memory_command(struct RespawnState *aState, struct MemoryWatch *aWatch)
+{
+    int rc = -1;
+
+    int waitMillis = -1;
+
+    /* Sample the memory used by the child process periodically, and
+     * measure growth over a longer window so that the transient
+     * allocations of a busy process are not mistaken for a leak. */
+
+    static const unsigned SampleMillis = 1000;
+    static const unsigned WindowMillis = 600 * 1000;
+    static const unsigned WindowGrowth = 3;
+
+    static const uint64_t MiB = 1024 * 1024;
+
+    uint64_t nowMillis = clk_monomillis();
+
+    if (aWatch->mSampleMillis) {
+        uint64_t sampleDuration = nowMillis - aWatch->mSampleMillis;
+
+        if (sampleDuration < SampleMillis) {
+            waitMillis = SampleMillis - sampleDuration;
+            rc = 0;
+            goto Finally;
+        }
+    }
+
+    aWatch->mSampleMillis = nowMillis;
+
+    waitMillis = SampleMillis;
+
+    uint64_t memoryBytes;
+
+    if (load_memory(aState->mChildPid, &memoryBytes)) {
+
+        /* The child process might have terminated but not yet have been
+         * reaped, so only warn about the failure. */
+
+        warn("Unable to measure memory of child process %d",
+            aState->mChildPid);
+
+        rc = 0;
+        goto Finally;
+    }
+
+    if (optMemoryLimit && memoryBytes > optMemoryLimit * MiB) {
+        DEBUG("Child process %d memory %" PRIu64 "MiB exceeds limit",
+            aState->mChildPid, memoryBytes / MiB);
+
+        aState->mStopReason = StopMemory;
+    }
+
+    if (optMemoryGrowth) {
+
+        if (!aWatch->mWindowMillis) {
+            aWatch->mWindowMillis = nowMillis;
+            aWatch->mWindowBytes  = memoryBytes;
+        }
+
+        uint64_t windowDuration = nowMillis - aWatch->mWindowMillis;
+
+        if (windowDuration >= WindowMillis) {
+
+            /* Require sustained growth over consecutive windows before
+             * concluding that the child process is leaking. */
+
+            uint64_t growthLimit =
+                optMemoryGrowth * MiB * windowDuration / (3600 * 1000);
+
+            if (memoryBytes > aWatch->mWindowBytes &&
+                    memoryBytes - aWatch->mWindowBytes > growthLimit)
+                ++aWatch->mWindowGrowth;
+            else
+                aWatch->mWindowGrowth = 0;
+
+            DEBUG("Child process %d memory %" PRIu64 "MiB growth %u",
+                aState->mChildPid,
+                memoryBytes / MiB, aWatch->mWindowGrowth);
+
+            if (aWatch->mWindowGrowth >= WindowGrowth)
+                aState->mStopReason = StopMemory;
+
+            aWatch->mWindowMillis = nowMillis;
+            aWatch->mWindowBytes  = memoryBytes;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : waitMillis;
+}
+
+/******************************************************************************/
+int
+activate_command(int aMonitorFd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    /* Defer starting the child process until a connection or datagram
+     * arrives on the listening socket. No signals are caught because
+     * there is no child process to receive them. */
+
+    DEBUG("Awaiting activity on listening socket %d", aState->mListenFd);
+
+    while (1) {
+
+        receive_notification(aState);
+
+        int pending = sock_pending(aState->mListenFd);
+        if (-1 == pending) {
+            warn("Unable to poll listening socket");
+            goto Finally;
+        }
+
+        if (pending)
+            break;
+
+        struct ProcMonitorEvent procEvent;
+
+        if (proc_monitor_wait(aMonitorFd, -1, &procEvent)) {
+            warn("Unable to wait for process monitor");
+            goto Finally;
+        }
+
+        if (procEvent.mParentPid) {
+            DEBUG("Parent process %d exited", procEvent.mParentPid);
+
+            terminate();
+            goto Finally;
+        }
+    }
+
+    aState->mActivateMillis = clk_monomillis();
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+void
+capture_release(struct RespawnState *aState)
+{
+    /* Once the new instance is spawned, only the instance holds the
+     * write ends of its streams so that the supervisor observes the
+     * end of each stream when the last writer closes it. */
+
+    for (unsigned ix = 0; ix < NUMBEROF(aState->mSpawnStreamFd); ++ix) {
+        if (-1 != aState->mSpawnStreamFd[ix]) {
+            fd_close(aState->mSpawnStreamFd[ix]);
+            aState->mSpawnStreamFd[ix] = -1;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int
+capture_command(int aMonitorFd, struct RespawnState *aState, unsigned aInstance)
+{
+    int rc = -1;
+
+    /* Create the stdout and stderr streams of a new instance, and install
+     * the write ends for prepare_command() to redirect. */
+
+    for (unsigned ix = 0; ix < NUMBEROF(aState->mSpawnStreamFd); ++ix) {
+
+        struct RespawnStream *stream = 0;
+
+        for (unsigned sx = 0; sx < NUMBEROF(aState->mStream); ++sx) {
+            if (-1 == aState->mStream[sx].mFd) {
+                stream = &aState->mStream[sx];
+                break;
+            }
+        }
+
+        /* If descendants of earlier instances keep all the streams open,
+         * abandon the stream of the oldest instance. */
+
+        if (!stream) {
+            stream = &aState->mStream[0];
+
+            for (unsigned sx = 1; sx < NUMBEROF(aState->mStream); ++sx) {
+                if (aState->mStream[sx].mInstance < stream->mInstance)
+                    stream = &aState->mStream[sx];
+            }
+
+            DEBUG("Abandoning output stream %d of instance %u",
+                stream->mFileNo, stream->mInstance);
+
+            fd_close(stream->mFd);
+            stream->mFd = -1;
+        }
+
+        int streamPipe[2];
+
+        if (pipe(streamPipe))
+            goto Finally;
+
+        memset(stream, 0, sizeof(*stream));
+
+        stream->mFd       = streamPipe[0];
+        stream->mFileNo   = STDOUT_FILENO + ix;
+        stream->mInstance = aInstance;
+
+        aState->mSpawnStreamFd[ix] = streamPipe[1];
+
+        if (fd_cloexec(streamPipe[0]) || fd_cloexec(streamPipe[1]))
+            goto Finally;
+
+        rate_init(&stream->mBucket,
+            1024 * (uint64_t) optRate,
+            1024 * (uint64_t) optRateBurst, clk_monomillis());
+
+        /* Only the supervisor end of the pipe is non-blocking because
+         * the file status flags are shared with the child process. */
+
+        if (fd_nonblock(stream->mFd))
+            goto Finally;
+
+        if (proc_monitor_watch(aMonitorFd, stream->mFd, 0))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+void
+detect_command(struct RespawnState *aState,
+               const struct RespawnStream *aStream, uint32_t aMatched)
+{
+    /* Act on the detectors that matched the output of an instance of
+     * the child process. Readiness is only of interest from a new
+     * instance that is taking over, and only the current instance can
+     * be stopped. */
+
+    unsigned instance = aStream->mInstance;
+
+    int handover =
+        aState->mHandover.mPid && instance == aState->mHandover.mInstance;
+
+    int current = instance == aState->mChildInstance;
+
+    for (unsigned ix = 0; aMatched; ++ix, aMatched >>= 1) {
+
+        if (!(aMatched & 1))
+            continue;
+
+        switch (optDetectKind[ix]) {
+        case DetectReady:
+            if (handover) {
+                DEBUG("Instance %u output ready", instance);
+                aState->mHandover.mReady = 1;
+
+                TRACE(TraceInstant, "ready", aState->mHandover.mPid, 0);
+            }
+            break;
+
+        case DetectFail:
+            if (current) {
+                DEBUG("Instance %u output failure", instance);
+                if (StopNone == aState->mStopReason)
+                    aState->mStopReason = StopFault;
+            }
+            break;
+
+        case DetectRestart:
+            if (current) {
+                DEBUG("Instance %u output restart", instance);
+                if (StopNone == aState->mStopReason)
+                    aState->mStopReason = StopRestart;
+            }
+            break;
+        }
+    }
+}
+
+/******************************************************************************/
+size_t
+relay_label(const struct RespawnState *aState,
+            const struct RespawnStream *aStream, char *aBuf, size_t aSize)
+{
+    size_t labelLen = 0;
+
+    /* The label is formed once for each read, so that all the lines
+     * in a read share the same timestamp. */
+
+    switch (optLabel) {
+    default:
+        break;
+
+    case LabelMono:
+        {
+            uint64_t monoMicros = clk_monomicros();
+
+            labelLen = snprintf(aBuf, aSize, "%" PRIu64 ".%06u ",
+                monoMicros / 1000000, (unsigned) (monoMicros % 1000000));
+        }
+        break;
+
+    case LabelReal:
+        {
+            uint64_t realMicros = clk_realmicros();
+
+            time_t    realTime = realMicros / 1000000;
+            struct tm realTm;
+
+            if (gmtime_r(&realTime, &realTm))
+                labelLen = strftime(
+                    aBuf, aSize, "%Y-%m-%dT%H:%M:%S", &realTm);
+
+            labelLen += snprintf(aBuf + labelLen, aSize - labelLen, ".%06uZ ",
+                (unsigned) (realMicros % 1000000));
+        }
+        break;
+    }
+
+    const char *streamName = STDOUT_FILENO == aStream->mFileNo ? "out" : "err";
+
+    if (0 <= aState->mReplica) {
+        labelLen += snprintf(aBuf + labelLen, aSize - labelLen, "%d.%u %s: ",
+            aState->mReplica, aStream->mInstance, streamName);
+    } else {
+        labelLen += snprintf(aBuf + labelLen, aSize - labelLen, "%u %s: ",
+            aStream->mInstance, streamName);
+    }
+
+    return labelLen < aSize ? labelLen : aSize - 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* The output of several reads is gathered into a batch so that it is
+ * written using one system call for each destination. Labels and
+ * markers are formed in the same buffer as the output that they frame,
+ * and the buffer is only reclaimed once the batch is written. */
+
+#define RELAY_READ_SIZE (64 * 1024)
+#define RELAY_TEXT_SIZE 512
+
+struct RelayBatch {
+    size_t       mLen;
+    unsigned     mIovCount[2];
+    struct iovec mIov[2][512];
+    char         mBuf[4 * RELAY_READ_SIZE];
+};
+
+void
+relay_flush(struct RelayBatch *aBatch)
+{
+    /* Output that cannot be relayed is discarded rather than stopping
+     * the supervisor. */
+
+    for (unsigned ix = 0; ix < NUMBEROF(aBatch->mIovCount); ++ix) {
+        if (aBatch->mIovCount[ix]) {
+            fd_writev(STDOUT_FILENO + ix,
+                aBatch->mIov[ix], aBatch->mIovCount[ix]);
+            aBatch->mIovCount[ix] = 0;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void
+relay_iov(struct RelayBatch *aBatch, int aFileNo, const char *aBuf, size_t aLen)
+{
+    unsigned ix = aFileNo - STDOUT_FILENO;
+
+    if (NUMBEROF(aBatch->mIov[ix]) == aBatch->mIovCount[ix])
+        relay_flush(aBatch);
+
+    struct iovec *iov = &aBatch->mIov[ix][aBatch->mIovCount[ix]++];
+
+    iov->iov_base = (char *) aBuf;
+    iov->iov_len  = aLen;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+relay_write(struct RespawnState *aState, struct RelayBatch *aBatch,
+            struct RespawnStream *aStream, const char *aBuf, size_t aLen)
+{
+    int fileNo = aStream->mFileNo;
+
+    if (LabelOff == optLabel && !optRate) {
+        aState->mRelayBytes += aLen;
+        relay_iov(aBatch, fileNo, aBuf, aLen);
+        return;
+    }
+
+    /* Frame each line with the label, gathering the label and the lines
+     * directly from the read buffer. A line that is incomplete at the
+     * end of the read is written as is, and is continued without a
+     * label by the next read. */
+
+    static const uint64_t RelayMarkerMillis = 1000;
+
+    char  *labelBuf = aBatch->mBuf + aBatch->mLen;
+    size_t labelLen = 0;
+
+    if (LabelOff != optLabel) {
+        labelLen = relay_label(aState, aStream, labelBuf, RELAY_TEXT_SIZE / 2);
+        aBatch->mLen += labelLen;
+    }
+
+    uint64_t nowMillis = clk_monomillis();
+
+    int64_t credit = optRate ? rate_available(&aStream->mBucket, nowMillis) : 0;
+
+    int marked = 0;
+
+    const char *linePtr = aBuf;
+    const char *bufEnd  = aBuf + aLen;
+
+    while (1) {
+
+        /* Report suppressed output before the next line that is
+         * admitted, periodically while output is suppressed, and when
+         * flushed at the end of the stream. */
+
+        if (aStream->mSuppressBytes && !aStream->mMidLine && !marked) {
+
+            int admit = linePtr != bufEnd && !aStream->mDropLine && 0 < credit;
+
+            if (admit || !aLen ||
+                    nowMillis - aStream->mMarkerMillis >= RelayMarkerMillis) {
+
+                char *markerBuf = aBatch->mBuf + aBatch->mLen;
+
+                int markerLen = snprintf(markerBuf, RELAY_TEXT_SIZE / 2,
+                    "respawn: %" PRIu64 " bytes suppressed\n",
+                    aStream->mSuppressBytes);
+
+                aBatch->mLen += markerLen;
+
+                relay_iov(aBatch, fileNo, labelBuf, labelLen);
+                relay_iov(aBatch, fileNo, markerBuf, markerLen);
+
+                aStream->mSuppressBytes = 0;
+                aStream->mMarkerMillis  = nowMillis;
+
+                marked = 1;
+            }
+        }
+
+        if (linePtr == bufEnd)
+            break;
+
+        const char *lineEnd = memchr(linePtr, '\n', bufEnd - linePtr);
+
+        int lineComplete = !!lineEnd;
+
+        lineEnd = lineEnd ? lineEnd + 1 : bufEnd;
+
+        size_t lineLen = lineEnd - linePtr;
+
+        /* Admit or drop each line as a whole, but truncate a line that
+         * exceeds the remaining credit so that a flood of output without
+         * newlines is still limited. The truncated line is terminated,
+         * and the rest of it is dropped. */
+
+        if (optRate) {
+            if (0 >= credit && !aStream->mDropLine) {
+                if (aStream->mMidLine) {
+                    relay_iov(aBatch, fileNo, "\n", 1);
+                    aStream->mMidLine = 0;
+                }
+                aStream->mDropLine = 1;
+            }
+
+            if (aStream->mDropLine) {
+                if (!aStream->mSuppressBytes)
+                    aStream->mMarkerMillis = nowMillis;
+
+                aStream->mSuppressBytes += lineLen;
+                aState->mSuppressBytes  += lineLen;
+
+                aStream->mDropLine = !lineComplete;
+
+                linePtr = lineEnd;
+                continue;
+            }
+
+            if ((int64_t) lineLen > credit) {
+                lineLen      = credit;
+                lineEnd      = linePtr + lineLen;
+                lineComplete = 0;
+            }
+
+            credit -= lineLen;
+            rate_consume(&aStream->mBucket, lineLen);
+        }
+
+        if (!aStream->mMidLine && labelLen)
+            relay_iov(aBatch, fileNo, labelBuf, labelLen);
+
+        relay_iov(aBatch, fileNo, linePtr, lineLen);
+
+        aStream->mMidLine = !lineComplete;
+        aState->mRelayBytes += lineLen;
+
+        linePtr = lineEnd;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int
+relay_command(struct RespawnState *aState, int aDrain)
+{
+    int rc = -1;
+
+    /* Only read the streams that the monitor reported as ready, unless
+     * draining the output of an instance that has terminated. Bound the
+     * work done for each wakeup so that a prolific instance cannot starve
+     * the supervisor. */
+
+    static const unsigned RelayReads = 16;
+
+    static struct RelayBatch relayBatch;
+
+    for (unsigned sx = 0; sx < NUMBEROF(aState->mStream); ++sx) {
+
+        struct RespawnStream *stream = &aState->mStream[sx];
+
+        if (-1 == stream->mFd || !(aDrain || stream->mReady))
+            continue;
+
+        for (unsigned rx = 0; -1 != stream->mFd && rx < RelayReads; ++rx) {
+
+            if (sizeof(relayBatch.mBuf) - relayBatch.mLen <
+                    RELAY_READ_SIZE + RELAY_TEXT_SIZE) {
+                relay_flush(&relayBatch);
+                relayBatch.mLen = 0;
+            }
+
+            char *relayBuf = relayBatch.mBuf + relayBatch.mLen;
+
+            ssize_t relayLen = read(stream->mFd, relayBuf, RELAY_READ_SIZE);
+
+            if (-1 == relayLen) {
+                if (EINTR == errno)
+                    continue;
+                if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                    stream->mReady = 0;
+                    break;
+                }
+                warn("Unable to read output of instance %u", stream->mInstance);
+                goto Finally;
+            }
+
+            /* Terminate an incomplete last line so that it is not
+             * joined to the output of another instance. */
+
+            if (!relayLen) {
+                DEBUG("Instance %u output stream %d closed",
+                    stream->mInstance, stream->mFileNo);
+
+                if (stream->mMidLine) {
+                    relay_iov(&relayBatch, stream->mFileNo, "\n", 1);
+                    stream->mMidLine = 0;
+                }
+
+                if (stream->mSuppressBytes)
+                    relay_write(aState, &relayBatch, stream, "", 0);
+
+                fd_close(stream->mFd);
+                stream->mFd    = -1;
+                stream->mReady = 0;
+                break;
+            }
+
+            relayBatch.mLen += relayLen;
+
+            if (optDetects) {
+                uint32_t matched = match_scan(
+                    &optDetect, &stream->mMatchState, relayBuf, relayLen);
+
+                if (matched)
+                    detect_command(aState, stream, matched);
+            }
+
+            relay_write(aState, &relayBatch, stream, relayBuf, relayLen);
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    relay_flush(&relayBatch);
+    relayBatch.mLen = 0;
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+watchdog_command(struct RespawnState *aState)
+{
+    int waitMillis;
+
+    /* The child process is hung if the heartbeat has not advanced at
+     * all during the watchdog period, or during the grace period after
+     * the instance started until the first heartbeat. Reading the
+     * heartbeat is a plain load from the shared page. */
+
+    uint64_t nowMillis      = clk_monomillis();
+    uint64_t watchdogPeriod = 1000 * (
+        aState->mWatchdogStarting ? optWatchdogGrace : optWatchdog);
+
+    uint64_t watchdogDuration = nowMillis - aState->mWatchdogMillis;
+
+    if (watchdogDuration < watchdogPeriod) {
+        waitMillis = watchdogPeriod - watchdogDuration;
+    } else {
+        uint64_t watchdogBeat = watchdog_beat(
+            &aState->mWatchdog, aState->mChildInstance);
+
+        if (watchdogBeat != aState->mWatchdogBeat) {
+            aState->mWatchdogBeat     = watchdogBeat;
+            aState->mWatchdogMillis   = nowMillis;
+            aState->mWatchdogStarting = 0;
+
+            waitMillis = optWatchdog * 1000;
+        } else {
+            DEBUG("Child process %d hung at heartbeat %" PRIu64,
+                aState->mChildPid, watchdogBeat);
+
+            aState->mStopReason = StopHung;
+
+            waitMillis = 0;
+        }
+    }
+
+    return waitMillis;
+}
+
+/******************************************************************************/
+int
+probe_command(int aMonitorFd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int waitMillis = -1;
+
+    uint64_t nowMillis = clk_monomillis();
+
+    if (probe_run(optProbe, optProbes, nowMillis)) {
+        warn("Unable to run probes");
+        goto Finally;
+    }
+
+    /* A child process that repeatedly fails its liveness probes is
+     * treated in the same way as a child process that is hung. */
+
+    if (probe_failed(optProbe, optProbes)) {
+        DEBUG("Child process %d failed liveness probe", aState->mChildPid);
+
+        aState->mStopReason = StopHung;
+
+        waitMillis = 0;
+
+    } else {
+
+        /* Completion of an exec probe is signalled by SIGCHLD, whereas
+         * the progress of socket probes must be monitored. */
+
+        for (unsigned ix = 0; ix < optProbes; ++ix) {
+            const struct Probe *probe = &optProbe[ix];
+
+            if (-1 != probe->mFd) {
+                if (proc_monitor_oneshot(
+                        aMonitorFd, probe->mFd, !probe->mConnected)) {
+                    warn("Unable to monitor probe %s", probe->mTarget);
+                    goto Finally;
+                }
+            }
+        }
+
+        waitMillis = probe_wait(optProbe, optProbes, nowMillis);
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : waitMillis;
+}
+
+/******************************************************************************/
+int
+retire_command(struct RespawnState *aState, int *aWaitMillis)
+{
+    int rc = -1;
+
+    /* Reap instances that were replaced by a planned restart, and
+     * continue to stop those that have yet to terminate. */
+
+    for (unsigned ix = 0; ix < aState->mRetireCount; ) {
+
+        struct RespawnRetire *retire = &aState->mRetire[ix];
+
+        int retireStatus;
+
+        pid_t pid = proc_wait(retire->mPid, &retireStatus, WNOHANG, 0);
+        if (-1 == pid) {
+            warn("Unable to wait for retired process %d", retire->mPid);
+            goto Finally;
+        }
+
+        if (pid) {
+            DEBUG("Retired process %d status %d", pid, retireStatus);
+
+            *retire = aState->mRetire[--aState->mRetireCount];
+            continue;
+        }
+
+        int stopMillis = stop_command(retire->mPid, &retire->mLadder);
+
+        if (-1 != stopMillis) {
+            if (-1 == *aWaitMillis || stopMillis < *aWaitMillis)
+                *aWaitMillis = stopMillis;
+        }
+
+        ++ix;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+handover_command(char **aCmd, int aMonitorFd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int waitMillis = -1;
+
+    struct RespawnHandover *handover = &aState->mHandover;
+
+    uint64_t nowMillis = clk_monomillis();
+
+    uint64_t overlapDuration = optOverlap * 1000;
+
+    if (!handover->mPid) {
+
+        /* Defer the new instance until enough of the instances being
+         * retired have terminated. */
+
+        if (1 + aState->mRetireCount >= optOverlapMax) {
+            DEBUG("Deferring handover with %u retiring instances",
+                aState->mRetireCount);
+
+            waitMillis = 1000;
+
+        } else {
+
+            handover->mReady = 0;
+
+            unsigned handoverInstance = aState->mSpawnCount + 1;
+
+            if (optDetects || optRate || LabelOff != optLabel) {
+                if (capture_command(aMonitorFd, aState, handoverInstance)) {
+                    warn("Unable to capture output of command %s", aCmd[0]);
+                    capture_release(aState);
+                    goto Finally;
+                }
+            }
+
+            TRACE(TraceInstant, "spawn", 0, handoverInstance);
+
+            aState->mSpawnInstance = handoverInstance;
+
+            pid_t handoverPid = proc_execute(aCmd, prepare_command, aState);
+
+            capture_release(aState);
+
+            if (-1 == handoverPid) {
+                warn("Unable to spawn command %s", aCmd[0]);
+                goto Finally;
+            }
+
+            TRACE(TraceInstant, "exec", handoverPid, handoverInstance);
+
+            aState->mSpawnCount = handoverInstance;
+
+            DEBUG("Handover from child process %d to %d count %u",
+                aState->mChildPid, handoverPid, aState->mSpawnCount);
+
+            handover->mPid         = handoverPid;
+            handover->mInstance    = handoverInstance;
+            handover->mStartMillis = nowMillis;
+
+            waitMillis = overlapDuration;
+        }
+
+    } else {
+
+        /* Once the new instance is ready, or if it does not report
+         * readiness within the overlap duration, retire the instance
+         * that it replaces. */
+
+        uint64_t overlapMillis = nowMillis - handover->mStartMillis;
+
+        if (!handover->mReady && overlapMillis < overlapDuration) {
+            waitMillis = overlapDuration - overlapMillis;
+        } else {
+            DEBUG("Child process %d %s after %" PRIu64 "ms",
+                handover->mPid,
+                handover->mReady ? "ready" : "overlap expired",
+                overlapMillis);
+
+            struct RespawnRetire *retire =
+                &aState->mRetire[aState->mRetireCount++];
+
+            memset(retire, 0, sizeof(*retire));
+            retire->mPid = aState->mChildPid;
+
+            aState->mChildPid       = handover->mPid;
+            aState->mChildInstance  = handover->mInstance;
+            aState->mActivityMillis = nowMillis;
+            aState->mStopReason     = StopNone;
+
+            memset(handover, 0, sizeof(*handover));
+
+            waitMillis = 0;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : waitMillis;
+}
+
+/******************************************************************************/
+void
+dump_trace(const struct RespawnState *aState)
+{
+    char tracePath[PATH_MAX];
+
+    /* Each replica has its own trace so that the replicas do not
+     * overwrite the traces of each other. */
+
+    const char *traceFile = optTrace;
+
+    if (0 <= aState->mReplica) {
+        snprintf(tracePath, sizeof(tracePath),
+            "%s.%d", optTrace, aState->mReplica);
+        traceFile = tracePath;
+    }
+
+    DEBUG("Writing trace %s", traceFile);
+
+    if (trace_dump(traceFile))
+        warn("Unable to write trace %s", traceFile);
+}
+
+/******************************************************************************/
+void
+report_relay(const struct RespawnState *aState)
+{
+    /* Report the output relayed and suppressed by the rate limit since
+     * the first instance was started, so that the effect of the limit
+     * can be judged without enabling debug output. */
+
+    if (optRate) {
+        char reportBuf[128];
+        char replicaBuf[32] = "";
+
+        if (0 <= aState->mReplica)
+            snprintf(replicaBuf, sizeof(replicaBuf),
+                " replica %d", aState->mReplica);
+
+        int reportLen = snprintf(reportBuf, sizeof(reportBuf),
+            "%s:%s relayed %" PRIu64 " bytes suppressed %" PRIu64 " bytes\n",
+            ARGV0, replicaBuf, aState->mRelayBytes, aState->mSuppressBytes);
+
+        if (-1 == fd_write(STDERR_FILENO, reportBuf, reportLen))
+            warn("Unable to report relayed output");
+    }
+}
+
+/******************************************************************************/
+int
+spawn_command(char **aCmd, int aMonitorFd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    pid_t childPid = aState->mChildPid;
+
+    if (childPid) {
+
+        /* After an upgrade, the child process is already running, and
+         * the signals held pending across the exec can be delivered
+         * now that the catchers are installed. */
+
+        signal_block_release(&aState->mSignalBlock);
+
+    } else {
+
+        /* Collect descriptors deposited by the previous instance
+         * before it terminated so that they are passed to the new
+         * instance. */
+
+        receive_notification(aState);
+
+        if (optDetects || optRate || LabelOff != optLabel) {
+            if (capture_command(aMonitorFd, aState, aState->mSpawnCount)) {
+                warn("Unable to capture output of command %s", aCmd[0]);
+                capture_release(aState);
+                goto Finally;
+            }
+        }
+
+        TRACE(TraceInstant, "spawn", 0, aState->mSpawnCount);
+
+        aState->mSpawnInstance = aState->mSpawnCount;
+
+        childPid = proc_execute(aCmd, prepare_command, aState);
+
+        capture_release(aState);
+
+        if (-1 == childPid) {
+            warn("Unable to spawn command %s", aCmd[0]);
+            goto Finally;
+        }
+
+        TRACE(TraceInstant, "exec", childPid, aState->mSpawnCount);
+
+        aState->mChildPid      = childPid;
+        aState->mChildInstance = aState->mSpawnCount;
+
+        watchdog_reset(aState, 1);
+
+        /* Measure the latency of an on demand start from the time the
+         * first activity was observed until the program was executed. */
+
+        aState->mActivityMillis = clk_monomillis();
+
+        if (aState->mActivateMillis) {
+            DEBUG("Child process %d activated in %" PRIu64 "ms",
+                childPid,
+                aState->mActivityMillis - aState->mActivateMillis);
+
+            aState->mActivateMillis = 0;
+        }
+    }
+
+    struct StopLadder  stopLadder  = { 0 };
+    struct MemoryWatch memoryWatch = { 0 };
+
+    probe_reset(optProbe, optProbes, clk_monomillis());
+
+    while (1) {
+
+        /* Propagate all caught signals to the child process. The child
+         * might choose to ignore or catch the signals, and might not
+         * terminate.
+         *
+         * https://people.freebsd.org/~cracauer/homepage-mirror/sigint.html
+         */
+
+        int upgrade = 0;
+
+        sig_atomic_t sigSet = signalset_sample();
+
+        for (int signal = 0; sigSet; ++signal) {
+            if (sigSet & 1) {
+                if (optUpgrade && SIGUSR2 == signal) {
+                    upgrade = 1;
+                } else if (optTrace && SIGUSR1 == signal) {
+                    dump_trace(aState);
+                    report_relay(aState);
+                } else {
+                    DEBUG(
+                        "Delivering signal %d to child process %d",
+                        signal, childPid);
+
+                    TRACE(TraceInstant,
+                        SIGCONT == signal ? "continue" : "signal",
+                        childPid, signal);
+
+                    proc_kill(childPid, signal);
+
+                    if (aState->mHandover.mPid)
+                        proc_kill(aState->mHandover.mPid, signal);
+                }
+            }
+            sigSet >>= 1;
+        }
+
+        /* Only upgrade after all other signals have been delivered
+         * because a successful upgrade will not return. */
+
+        if (upgrade)
+            upgrade_command(aState);
+
+        receive_notification(aState);
+
+        if (relay_command(aState, 0))
+            goto Finally;
+
+        /* Check the child process before waiting so that a child that
+         * terminated while the supervisor was being upgraded is not
+         * overlooked. */
+
+        /* A new instance that fails before taking over from the current
+         * instance abandons the overlap, and the current instance is
+         * instead stopped before being restarted. */
+
+        if (aState->mHandover.mPid) {
+
+            int handoverStatus;
+
+            pid_t pid = proc_wait(
+                aState->mHandover.mPid, &handoverStatus, WNOHANG, 0);
+            if (-1 == pid) {
+                if (EINTR == errno)
+                    continue;
+                warn("Unable to wait for child process %d",
+                    aState->mHandover.mPid);
+                goto Finally;
+            }
+
+            if (pid) {
+                DEBUG("Handover child process %d failed status %d",
+                    pid, handoverStatus);
+
+                aState->mHandover.mPid    = 0;
+                aState->mHandover.mFailed = 1;
+            }
+        }
+
+        int childStatus;
+
+        pid_t pid = proc_wait(childPid, &childStatus, WNOHANG|WUNTRACED, 0);
+        if (-1 == pid) {
+            if (EINTR == errno)
+                continue;
+            warn("Unable to wait for child process %d", childPid);
+            goto Finally;
+        }
+
+        if (pid) {
+
+            if (WIFSTOPPED(childStatus)) {
+                int stopSig = WSTOPSIG(childStatus);
+
+                DEBUG("Child process %d stopped signal %d", childPid, stopSig);
+
+                TRACE(TraceInstant, "stop", childPid, stopSig);
+
+                /* http://curiousthing.org/sigttin-sigttou-deep-dive-linux */
+
+                if (SIGSTOP == stopSig || SIGTSTP == stopSig) {
+                    if (optContinue) {
+                        signalset_add(SIGCONT);
+                        stopSig = 0;
+                    }
+                }
+
+                if (stopSig) {
+                    if (kill(getpid(), stopSig)) {
+                        warn("Unable to stop process after signal %d", stopSig);
+                    }
+                }
+
+                continue;
+            }
+
+            if (WIFEXITED(childStatus)) {
+                int exitStatus = WEXITSTATUS(childStatus);
+
+                DEBUG("Child process %d exit status %d", childPid, exitStatus);
+                rc = 0x000 + exitStatus;
+            }
+            else if (WIFSIGNALED(childStatus)) {
+                int termSig = WTERMSIG(childStatus);
+
+                DEBUG("Child process %d termination signal %d", childPid, termSig);
+                rc = 0x100 + termSig;
+            }
+
+            TRACE(TraceInstant, "exit", childPid, rc);
+
+            /* Relay the final output of the child process before its
+             * termination is considered. */
+
+            if (relay_command(aState, 1))
+                goto Finally;
+
+            /* If the current instance terminates while a new instance
+             * is starting, the new instance takes over immediately. */
+
+            if (aState->mHandover.mPid) {
+                DEBUG("Handover to child process %d", aState->mHandover.mPid);
+
+                childPid = aState->mHandover.mPid;
+
+                aState->mChildPid       = childPid;
+                aState->mChildInstance  = aState->mHandover.mInstance;
+                aState->mActivityMillis = clk_monomillis();
+                aState->mStopReason     = StopNone;
+
+                memset(&aState->mHandover, 0, sizeof(aState->mHandover));
+
+                memset(&memoryWatch, 0, sizeof(memoryWatch));
+                watchdog_reset(aState, 1);
+
+                probe_reset(optProbe, optProbes, clk_monomillis());
+
+                rc = -1;
+                continue;
+            }
+
+            break;
+        }
+
+        int waitMillis = -1;
+
+        if (StopNone == aState->mStopReason && optIdle) {
+            waitMillis = idle_command(aState);
+            if (-1 == waitMillis)
+                goto Finally;
+        }
+
+        if (StopNone == aState->mStopReason &&
+                (optMemoryLimit || optMemoryGrowth)) {
+            int memoryMillis = memory_command(aState, &memoryWatch);
+            if (-1 == memoryMillis)
+                goto Finally;
+
+            if (-1 == waitMillis || memoryMillis < waitMillis)
+                waitMillis = memoryMillis;
+        }
+
+        if (StopNone == aState->mStopReason && optWatchdog) {
+            int watchdogMillis = watchdog_command(aState);
+
+            if (-1 == waitMillis || watchdogMillis < waitMillis)
+                waitMillis = watchdogMillis;
+        }
+
+        if (StopNone == aState->mStopReason && optProbes) {
+            int probeMillis = probe_command(aMonitorFd, aState);
+            if (-1 == probeMillis)
+                goto Finally;
+
+            if (-1 == waitMillis || probeMillis < waitMillis)
+                waitMillis = probeMillis;
+        }
+
+        /* Planned restarts start the new instance before stopping the
+         * current instance, unless an earlier attempt to do so failed. */
+
+        if (StopNone != aState->mStopReason) {
+
+            int planned =
+                StopMemory == aState->mStopReason ||
+                StopRestart == aState->mStopReason;
+
+            if (optOverlap && planned && !aState->mHandover.mFailed) {
+                waitMillis = handover_command(aCmd, aMonitorFd, aState);
+                if (-1 == waitMillis)
+                    goto Finally;
+
+                if (childPid != aState->mChildPid) {
+                    childPid = aState->mChildPid;
+
+                    memset(&memoryWatch, 0, sizeof(memoryWatch));
+                    watchdog_reset(aState, 1);
+
+                    probe_reset(optProbe, optProbes, clk_monomillis());
+                }
+
+            } else {
+                waitMillis = stop_command(childPid, &stopLadder);
+            }
+        }
+
+        if (retire_command(aState, &waitMillis))
+            goto Finally;
+
+        struct ProcMonitorEvent procEvent;
+
+        if (proc_monitor_wait(aMonitorFd, waitMillis, &procEvent)) {
+            warn("Unable to wait for process monitor");
+            goto Finally;
+        }
+
+        if (procEvent.mParentPid) {
+
+            /* If the process must be parented, and the parent has exited,
+             * there is no parent waiting for exit status.
+             */
+
+            DEBUG("Parent process %d exited", procEvent.mParentPid);
+
+            terminate();
+            goto Finally;
+        }
+
+        /* Note the streams that are ready so that only those are read
+         * when next relaying output. */
+
+        for (unsigned ix = 0; ix < procEvent.mFds; ++ix) {
+            int readyFd = procEvent.mFd[ix];
+
+            if (aState->mListenFd == readyFd) {
+                aState->mActivityMillis = clk_coarsemillis();
+                continue;
+            }
+
+            for (unsigned sx = 0; sx < NUMBEROF(aState->mStream); ++sx) {
+                if (readyFd == aState->mStream[sx].mFd) {
+                    aState->mStream[sx].mReady = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+Finally:
+
+    FINALLY({
+        aState->mChildPid = 0;
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+respawn_command(char **aCmd, int aMonitorFd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int exitCode;
+
+    /* With a listening socket, the child process is only started on
+     * demand, and is started again on demand after it is stopped
+     * because it is idle. */
+
+    int activate = -1 != aState->mListenFd && !aState->mChildPid;
+
+    while (1) {
+
+        if (activate) {
+            if (activate_command(aMonitorFd, aState)) {
+                exitCode = -1;
+                goto Finally;
+            }
+            activate = 0;
+        }
+
+        if (aState->mChildPid) {
+            DEBUG("Resuming count %u attempt %u",
+                aState->mSpawnCount, aState->mBackoff.mAttempt);
+        } else {
+            aState->mStopReason = StopNone;
+
+            ++aState->mSpawnCount;
+            ++aState->mBackoff.mAttempt;
+
+            DEBUG("Spawning count %u attempt %u",
+                aState->mSpawnCount, aState->mBackoff.mAttempt);
+        }
+
+        signal_catch();
+        exitCode = spawn_command(aCmd, aMonitorFd, aState);
+        signal_release();
+
+        /* The durations are measured using the boot clock so that time
+         * spent suspended counts towards the duration, and a program
+         * that ran across a suspension is not mistaken for one that
+         * failed to initialise. */
+
+        uint64_t windowEndMillis = clk_bootmillis();
+
+        if (-1 == exitCode)
+            goto Finally;
+
+        /* A child process that was stopped because it was idle is not
+         * a failure, and is only restarted on demand. */
+
+        if (StopIdle == aState->mStopReason) {
+            DEBUG("Idle child process stopped");
+
+            restart_reset(&aState->mBackoff, windowEndMillis);
+
+            activate = 1;
+            continue;
+        }
+
+        /* A child process that was stopped for a planned restart is
+         * restarted immediately, and does not count against the
+         * backoff applied to failures. */
+
+        if (StopMemory == aState->mStopReason ||
+                StopRestart == aState->mStopReason) {
+            DEBUG("Restarting child process reason %d", aState->mStopReason);
+
+            aState->mHandover.mFailed = 0;
+
+            restart_reset(&aState->mBackoff, windowEndMillis);
+
+            continue;
+        }
+
+        /* A child process that was stopped because it hung, or that
+         * reported a failure in its output, is always restarted, as a
+         * failure, regardless of how it terminated. */
+
+        int fault =
+            StopHung == aState->mStopReason ||
+            StopFault == aState->mStopReason;
+
+        if (StopHung == aState->mStopReason) {
+            ++aState->mHungCount;
+
+            DEBUG("Hung child process stopped count %u", aState->mHungCount);
+        }
+
+        if (StopFault == aState->mStopReason) {
+            DEBUG("Failed child process stopped");
+        }
+
+        /* Normally only restart the process if it failed to exit
+         * with EXIT_SUCCESS and did not terminate due to a signal. */
+
+        struct RestartPolicy policy = {
+            .mForever = optForever,
+            .mExit    = optExit,
+            .mExits   = NUMBEROF(optExit),
+        };
+
+        if (!restart_wanted(&policy, exitCode, fault))
+            break;
+
+        if (restart_backoff(&aState->mBackoff, windowEndMillis)) {
+            error("Failed to start %s", aCmd[0]);
+            goto Finally;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : exitCode;
+}
+
+/******************************************************************************/
+int
+supervise_command(char **aCmd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int monitorFd = -1;
+
+    if (!aState->mChildPid) {
+
+        /* Each replica has its own listening socket so that the kernel
+         * can distribute connections across the replicas. */
+
+        if (optListen) {
+            aState->mListenFd = sock_listen(optListen, 0 <= aState->mReplica);
+            if (-1 == aState->mListenFd) {
+                warn("Unable to listen on %s", optListen);
+                goto Finally;
+            }
+        }
+
+        /* The notification channel allows the child process to report
+         * activity while serving established connections. */
+
+        if (optFdStore || optIdle || optOverlap ||
+                -1 != aState->mReportFd[1]) {
+            if (notify_create(aState->mNotifyFd)) {
+                warn("Unable to create notification channel");
+                goto Finally;
+            }
+        }
+
+        if (optWatchdog) {
+            if (watchdog_create(&aState->mWatchdog)) {
+                warn("Unable to create watchdog");
+                goto Finally;
+            }
+        }
+    }
+
+    sigset_t caughtSet;
+
+    signal_caught(&caughtSet);
+
+    monitorFd = proc_monitor_create(aState->mParentPid, &caughtSet);
+    if (-1 == monitorFd) {
+        warn("Unable to create proc monitor");
         goto Finally;
     }
 
-    int cmdExit = respawn_command(cmd, monitorFd);
+    if (-1 != aState->mNotifyFd[0]) {
+        if (proc_monitor_watch(monitorFd, aState->mNotifyFd[0], 0)) {
+            warn("Unable to monitor notification channel");
+            goto Finally;
+        }
+    }
+
+    for (unsigned ix = 0; ix < NUMBEROF(aState->mStream); ++ix) {
+        int streamFd = aState->mStream[ix].mFd;
+
+        if (-1 != streamFd) {
+            if (proc_monitor_watch(monitorFd, streamFd, 0)) {
+                warn("Unable to monitor output pipe");
+                goto Finally;
+            }
+        }
+    }
+
+    /* Each new connection or datagram on the listening socket is
+     * activity, even if the child process accepts it promptly. */
+
+    if (-1 != aState->mListenFd) {
+        if (proc_monitor_watch(monitorFd, aState->mListenFd, 1)) {
+            warn("Unable to monitor listening socket");
+            goto Finally;
+        }
+    }
+
+    int cmdExit = respawn_command(aCmd, monitorFd, aState);
+    if (-1 == cmdExit)
+        goto Finally;
+
+    rc = cmdExit;
+
+Finally:
+
+    FINALLY({
+        if (-1 != monitorFd)
+            proc_monitor_close(monitorFd);
+
+        if (optTrace)
+            dump_trace(aState);
+
+        report_relay(aState);
+    });
+
+    return rc;
+}
 
-    if (-1 == cmdExit)
+/******************************************************************************/
+int
+exit_command(int aCmdExit)
+{
+    int exitCode = 255;
+
+    if (-1 == aCmdExit)
         goto Finally;
 
     /* If the child process terminated due to a signal, reproduce
      * that signal here so that the outcome is visible to the
      * grandparent. */
 
-    if (0x100 <= cmdExit) {
-        kill(getpid(), cmdExit - 0x100);
+    if (0x100 <= aCmdExit) {
+        kill(getpid(), aCmdExit - 0x100);
+        goto Finally;
+    }
+
+    exitCode = aCmdExit;
+
+Finally:
+
+    return exitCode;
+}
+
+/******************************************************************************/
+struct PoolReplica {
+    pid_t    mPid;
+    int      mRetiring;
+    unsigned mLoad;
+};
+
+/*----------------------------------------------------------------------------*/
+pid_t
+replica_command(char **aCmd, struct RespawnState *aState,
+                unsigned aReplica, int aMonitorFd)
+{
+    /* Each replica is supervised by its own process so that each
+     * replica has independent restart and backoff behaviour. */
+
+    pid_t pid = fork();
+    if (-1 == pid) {
+        warn("Unable to fork supervisor for replica %u", aReplica);
+        goto Finally;
+    }
+
+    if (!pid) {
+        proc_monitor_close(aMonitorFd);
+
+        /* Discard signals pending for the pool, and restore the signal
+         * dispositions that the pool inherited. */
+
+        signalset_sample();
+        signal_release();
+
+        srand(getpid());
+
+        aState->mReplica = aReplica;
+
+        if (-1 != aState->mReportFd[0])
+            aState->mReportFd[0] = fd_close(aState->mReportFd[0]);
+
+        exit(exit_command(supervise_command(aCmd, aState)));
+    }
+
+    DEBUG("Replica %u supervisor %d forked", aReplica, pid);
+
+Finally:
+
+    return pid;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+receive_report(int aReportFd, struct PoolReplica *aReplicas)
+{
+    while (1) {
+
+        char reportMsg[256];
+        int  reportFd;
+
+        ssize_t reportLen = notify_receive(
+            aReportFd, reportMsg, sizeof(reportMsg), &reportFd);
+
+        reportFd = fd_close(reportFd);
+
+        if (-1 == reportLen)
+            warn("Unable to receive replica report");
+
+        if (0 >= reportLen)
+            break;
+
+        unsigned replica;
+        unsigned replicaLoad;
+
+        if (2 == sscanf(reportMsg, "LOAD=%u:%u", &replica, &replicaLoad)) {
+            if (replica < optReplicas && aReplicas[replica].mPid)
+                aReplicas[replica].mLoad = replicaLoad;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int
+scale_command(const struct PoolReplica *aReplicas, unsigned aLiveReplicas,
+              int aPort, int *aHighSamples, int *aLowSamples)
+{
+    /* Combine cheap local measures of load. The load reported by the
+     * replicas is averaged, and compared against the cpu pressure
+     * of the host, and the connections waiting to be accepted. */
+
+    unsigned childLoad = 0;
+
+    for (unsigned ix = 0; ix < optReplicas; ++ix) {
+        if (aReplicas[ix].mPid && !aReplicas[ix].mRetiring)
+            childLoad += aReplicas[ix].mLoad;
+    }
+
+    childLoad /= aLiveReplicas;
+
+    unsigned cpuLoad = 0;
+
+    if (load_cpu_pressure(&cpuLoad))
+        cpuLoad = 0;
+
+    unsigned backlog = 0;
+
+    if (0 < aPort && load_backlog(aPort, &backlog))
+        backlog = 0;
+
+    unsigned load = childLoad > cpuLoad ? childLoad : cpuLoad;
+
+    DEBUG("Replicas %u load %u%% cpu pressure %u%% backlog %u",
+        aLiveReplicas, childLoad, cpuLoad, backlog);
+
+    /* Only scale if the load remains beyond the thresholds for several
+     * consecutive samples, so that transient spikes are ignored. The
+     * gap between the thresholds provides hysteresis. */
+
+    static const int ScaleSamples = 3;
+
+    if (load > optScaleHigh || backlog >= aLiveReplicas) {
+        *aLowSamples = 0;
+        if (++*aHighSamples >= ScaleSamples)
+            return +1;
+    } else if (load < optScaleLow && !backlog) {
+        *aHighSamples = 0;
+        if (++*aLowSamples >= ScaleSamples)
+            return -1;
+    } else {
+        *aHighSamples = 0;
+        *aLowSamples  = 0;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+pool_command(char **aCmd, struct RespawnState *aState)
+{
+    int rc = -1;
+
+    int monitorFd = -1;
+    int catching  = 0;
+
+    int poolExit = 0;
+
+    struct PoolReplica *replicas     = 0;
+    unsigned            liveReplicas = 0;
+
+    /* The pool scales the number of replicas if a range of replicas
+     * is specified, starting with the lower bound. */
+
+    int autoScale = optReplicasMin < optReplicas;
+
+    int poolPort = -1;
+
+    int highSamples = 0;
+    int lowSamples  = 0;
+
+    uint64_t sampleMillis = clk_monomillis();
+    uint64_t scaleMillis  = sampleMillis;
+
+    static const unsigned ScaleSampleMillis = 1000;
+
+    replicas = calloc(optReplicas, sizeof(*replicas));
+    if (!replicas) {
+        warn("Unable to allocate %u replicas", optReplicas);
+        goto Finally;
+    }
+
+    sigset_t caughtSet;
+
+    signal_caught(&caughtSet);
+
+    monitorFd = proc_monitor_create(aState->mParentPid, &caughtSet);
+    if (-1 == monitorFd) {
+        warn("Unable to create proc monitor");
+        goto Finally;
+    }
+
+    if (autoScale) {
+
+        /* Each replica supervisor relays the load reported by its
+         * child process to the pool. */
+
+        if (notify_create(aState->mReportFd)) {
+            warn("Unable to create replica report channel");
+            goto Finally;
+        }
+
+        if (proc_monitor_watch(monitorFd, aState->mReportFd[0], 0)) {
+            warn("Unable to monitor replica report channel");
+            goto Finally;
+        }
+
+        if (optListen) {
+            poolPort = sock_port(optListen);
+            if (-1 == poolPort) {
+                warn("Unable to find port for %s", optListen);
+                goto Finally;
+            }
+        }
+    }
+
+    unsigned initialReplicas = autoScale ? optReplicasMin : optReplicas;
+
+    for (unsigned ix = 0; ix < initialReplicas; ++ix) {
+
+        pid_t pid = replica_command(aCmd, aState, ix, monitorFd);
+        if (-1 == pid)
+            goto Finally;
+
+        replicas[ix].mPid = pid;
+        ++liveReplicas;
+    }
+
+    signal_catch();
+    catching = 1;
+
+    while (liveReplicas) {
+
+        sig_atomic_t sigSet = signalset_sample();
+
+        for (int signal = 0; sigSet; ++signal) {
+            if (sigSet & 1) {
+                for (unsigned ix = 0; ix < optReplicas; ++ix) {
+                    if (replicas[ix].mPid) {
+                        DEBUG(
+                            "Delivering signal %d to replica %u supervisor %d",
+                            signal, ix, replicas[ix].mPid);
+
+                        kill(replicas[ix].mPid, signal);
+                    }
+                }
+            }
+            sigSet >>= 1;
+        }
+
+        /* The pool terminates when all the replicas have terminated,
+         * and reports the first replica that did not succeed. Replicas
+         * retired when scaling down are not considered. */
+
+        while (liveReplicas) {
+            int   replicaStatus;
+            pid_t pid = waitpid(-1, &replicaStatus, WNOHANG);
+
+            if (-1 == pid) {
+                if (EINTR == errno)
+                    continue;
+                warn("Unable to wait for replica supervisors");
+                goto Finally;
+            }
+
+            if (!pid)
+                break;
+
+            for (unsigned ix = 0; ix < optReplicas; ++ix) {
+                if (pid != replicas[ix].mPid)
+                    continue;
+
+                int replicaExit = WIFEXITED(replicaStatus)
+                    ? 0x000 + WEXITSTATUS(replicaStatus)
+                    : 0x100 + WTERMSIG(replicaStatus);
+
+                DEBUG("Replica %u supervisor %d exit %d",
+                    ix, pid, replicaExit);
+
+                if (!poolExit && !replicas[ix].mRetiring)
+                    poolExit = replicaExit;
+
+                memset(&replicas[ix], 0, sizeof(replicas[ix]));
+                --liveReplicas;
+            }
+        }
+
+        if (!liveReplicas)
+            break;
+
+        int waitMillis = -1;
+
+        if (autoScale) {
+
+            receive_report(aState->mReportFd[0], replicas);
+
+            uint64_t nowMillis = clk_monomillis();
+
+            if (nowMillis - sampleMillis >= ScaleSampleMillis) {
+
+                sampleMillis = nowMillis;
+
+                unsigned activeReplicas = 0;
+
+                for (unsigned ix = 0; ix < optReplicas; ++ix) {
+                    if (replicas[ix].mPid && !replicas[ix].mRetiring)
+                        ++activeReplicas;
+                }
+
+                int scale = activeReplicas
+                    ? scale_command(
+                        replicas, activeReplicas,
+                        poolPort, &highSamples, &lowSamples)
+                    : 0;
+
+                /* Allow the effect of each scaling decision to become
+                 * visible before making another. */
+
+                if (nowMillis - scaleMillis < optScaleCooldown * 1000)
+                    scale = 0;
+
+                if (0 < scale && activeReplicas < optReplicas) {
+
+                    for (unsigned ix = 0; ix < optReplicas; ++ix) {
+                        if (replicas[ix].mPid)
+                            continue;
+
+                        DEBUG("Scaling up to %u replicas", activeReplicas + 1);
+
+                        pid_t pid = replica_command(aCmd, aState, ix, monitorFd);
+                        if (-1 != pid) {
+                            replicas[ix].mPid = pid;
+                            ++liveReplicas;
+                        }
+                        break;
+                    }
+
+                    scaleMillis = nowMillis;
+                    highSamples = 0;
+                }
+
+                if (0 > scale && activeReplicas > optReplicasMin) {
+
+                    for (unsigned ix = optReplicas; ix--; ) {
+                        if (!replicas[ix].mPid || replicas[ix].mRetiring)
+                            continue;
+
+                        DEBUG("Scaling down to %u replicas", activeReplicas - 1);
+
+                        kill(replicas[ix].mPid, SIGTERM);
+                        replicas[ix].mRetiring = 1;
+                        break;
+                    }
+
+                    scaleMillis = nowMillis;
+                    lowSamples  = 0;
+                }
+            }
+
+            waitMillis = ScaleSampleMillis - (nowMillis - sampleMillis);
+        }
+
+        struct ProcMonitorEvent procEvent;
+
+        if (proc_monitor_wait(monitorFd, waitMillis, &procEvent)) {
+            warn("Unable to wait for process monitor");
+            goto Finally;
+        }
+
+        if (procEvent.mParentPid) {
+            DEBUG("Parent process %d exited", procEvent.mParentPid);
+
+            terminate();
+            goto Finally;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (catching)
+            signal_release();
+
+        if (rc && replicas) {
+            for (unsigned ix = 0; ix < optReplicas; ++ix) {
+                if (replicas[ix].mPid)
+                    kill(replicas[ix].mPid, SIGTERM);
+            }
+        }
+
+        if (-1 != monitorFd)
+            proc_monitor_close(monitorFd);
+
+        free(replicas);
+    });
+
+    return rc ? rc : poolExit;
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    int exitCode = 255;
+
+    srand(getpid());
+
+    /* Retain a copy of the original arguments because option parsing
+     * modifies some arguments in place, and an upgrade must re-execute
+     * the program with the same arguments. */
+
+    char *argCopy[argc+1];
+
+    for (int ix = 0; ix < argc; ++ix) {
+        argCopy[ix] = strdup(argv[ix]);
+        if (!argCopy[ix])
+            die("Unable to copy argument %d", ix);
+    }
+    argCopy[argc] = 0;
+
+    Argv_ = argCopy;
+
+    char **cmd = parse_options(argc, argv);
+    if (!cmd || !cmd[0])
+        usage();
+
+    struct RespawnState state;
+
+    memset(&state, 0, sizeof(state));
+
+    state.mNotifyFd[0] = -1;
+    state.mNotifyFd[1] = -1;
+    state.mListenFd    = -1;
+
+    state.mWatchdog.mFd = -1;
+
+    state.mSpawnStreamFd[0] = -1;
+    state.mSpawnStreamFd[1] = -1;
+
+    for (unsigned ix = 0; ix < NUMBEROF(state.mStream); ++ix)
+        state.mStream[ix].mFd = -1;
+    state.mReplica     = -1;
+
+    state.mReportFd[0] = -1;
+    state.mReportFd[1] = -1;
+
+    fdstore_init(&state.mFdStore);
+
+    /* A child process cannot be identified from an image that cannot
+     * be read, so terminate the process group rather than leave the
+     * child process unsupervised. */
+
+    int resumed = resume_command(&state);
+    if (-1 == resumed) {
+        terminate();
         goto Finally;
     }
 
-    exitCode = cmdExit;
+    pid_t parentPid = 0;
+    if (optParented) {
+        parentPid = getppid();
+
+        /* If the parent exited while the supervisor was being upgraded,
+         * there is no parent waiting for exit status. */
+
+        if (resumed && parentPid != state.mParentPid) {
+            DEBUG("Parent process %d exited", state.mParentPid);
+            terminate();
+            goto Finally;
+        }
+
+        if (1 >= parentPid)
+            goto Finally;
+    }
+
+    if (!resumed) {
+        state.mParentPid = parentPid;
+        restart_reset(&state.mBackoff, clk_bootmillis());
+
+        /* Remember the original settings, before the supervisor is
+         * protected, so that these can be restored for the child. An
+         * upgraded supervisor retains the settings from the image. */
+
+        state.mOriginNice = INT_MIN;
+        state.mOriginOom  = INT_MIN;
+
+        if (optProtect) {
+            if (tune_nice_get(&state.mOriginNice))
+                warn("Unable to query nice value");
+            if (tune_oom_get(&state.mOriginOom))
+                warn("Unable to query oom score adjustment");
+        }
+    }
+
+    /* Protecting the supervisor is best effort because it typically
+     * requires privileges, and the supervisor remains useful without
+     * protection. */
+
+    if (optProtect) {
+
+        static const int SupervisorNice = -10;
+        static const int SupervisorOom  = -1000;
+
+        if (tune_nice_set(SupervisorNice))
+            warn("Unable to set supervisor nice value %d", SupervisorNice);
+        if (tune_oom_set(SupervisorOom))
+            warn("Unable to set supervisor oom score %d", SupervisorOom);
+    }
+
+    if (optUpgrade)
+        signal_include(SIGUSR2);
+
+    if (optTrace) {
+        if (trace_open(RESPAWN_TRACE_EVENTS))
+            die("Unable to create trace");
+        signal_include(SIGUSR1);
+    }
+
+    /* A replica supervisor that is upgraded resumes as a replica, and
+     * does not create a new pool. */
+
+    int cmdExit;
+
+    if (1 < optReplicas && !resumed)
+        cmdExit = pool_command(cmd, &state);
+    else
+        cmdExit = supervise_command(cmd, &state);
+
+    exitCode = exit_command(cmdExit);
 
 Finally:
 
@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# Upgrade the supervisor while it limits the rate of output of the
+# child process, and check that the output continues to be relayed.
+# The child process writes well within the limit, so no output should
+# be suppressed, either before or after the upgrade.
+
+set -e
+
+RESPAWN=${1:-./respawn}
+
+LOG=$(mktemp)
+OUT=$(mktemp)
+trap '[ -z "$SUPERVISOR" ] || kill $SUPERVISOR ; rm -f "$LOG" "$OUT"' EXIT
+
+fail() {
+    echo "test=upgrade_rate supervisor=$RESPAWN failed=\"$*\""
+    exit 1
+}
+
+lines() {
+    wc -l <"$OUT"
+}
+
+# Write about 500 bytes per second against a limit of 1KiB per second,
+# so that the burst would be spent within a few seconds if the bucket
+# stopped refilling after the upgrade.
+
+"$RESPAWN" -d -U -r 1,1 -- \
+    sh -c 'while : ; do echo line ; sleep 0.01 ; done' >"$OUT" 2>"$LOG" &
+SUPERVISOR=$!
+
+# Run long enough before the upgrade that the clock of the upgraded
+# supervisor starts well behind the timestamps in the image.
+
+sleep 5
+
+kill -USR2 $SUPERVISOR
+
+TRIES=0
+while ! grep -q 'Resuming child process' "$LOG" ; do
+    TRIES=$((TRIES + 1))
+    [ $TRIES -lt 1000 ] || fail "upgrade did not complete"
+    sleep 0.01
+done
+
+sleep 3
+BEFORE=$(lines)
+sleep 1
+AFTER=$(lines)
+
+kill $SUPERVISOR
+wait $SUPERVISOR 2>/dev/null || true
+SUPERVISOR=
+
+[ $AFTER -gt $BEFORE ] || fail "no output relayed after upgrade"
+
+grep -q "suppressed" "$OUT" && fail "$(grep suppressed "$OUT" | head -1)"
+
+# The totals reported at exit include the output relayed before the
+# upgrade.
+
+grep -q "relayed [1-9][0-9]* bytes suppressed 0 bytes" "$LOG" ||
+    fail "no report of relayed output"
+
+echo "test=upgrade_rate supervisor=$RESPAWN lines=$AFTER relayed=ok"
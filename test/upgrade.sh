@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Upgrade the supervisor repeatedly while the child process runs, and
+# check that the same child process remains supervised throughout. The
+# debug output of the supervisor marks the completion of each upgrade.
+
+set -e
+
+RESPAWN=${1:-./respawn}
+UPGRADES=${2:-50}
+
+LOG=$(mktemp)
+trap '[ -z "$SUPERVISOR" ] || kill $SUPERVISOR ; rm -f "$LOG"' EXIT
+
+fail() {
+    echo "test=upgrade supervisor=$RESPAWN failed=\"$*\""
+    exit 1
+}
+
+resumed() {
+    grep -c 'Resuming child process' "$LOG" || true
+}
+
+"$RESPAWN" -d -U -- sleep 1000 2>"$LOG" &
+SUPERVISOR=$!
+
+while [ -z "$CHILD" ] ; do
+    CHILD=$(pgrep -P $SUPERVISOR || true)
+done
+
+START=$(date +%s.%N)
+
+UPGRADE=0
+while [ $UPGRADE -lt $UPGRADES ] ; do
+    UPGRADE=$((UPGRADE + 1))
+
+    kill -USR2 $SUPERVISOR
+
+    TRIES=0
+    while [ $(resumed) -lt $UPGRADE ] ; do
+        TRIES=$((TRIES + 1))
+        [ $TRIES -lt 1000 ] || fail "upgrade $UPGRADE did not complete"
+        sleep 0.01
+    done
+
+    PID=$(pgrep -P $SUPERVISOR || true)
+    [ x"$PID" = x"$CHILD" ] ||
+        fail "child process $CHILD became $PID after upgrade $UPGRADE"
+done
+
+FINISH=$(date +%s.%N)
+
+kill $SUPERVISOR
+wait $SUPERVISOR 2>/dev/null || true
+SUPERVISOR=
+
+grep -q "WARN" "$LOG" && fail "$(grep WARN "$LOG" | head -1)"
+
+echo "test=upgrade supervisor=$RESPAWN upgrades=$UPGRADES" \
+    "seconds=$(awk "BEGIN { printf \"%.3f\", $FINISH - $START }")" \
+    "child=stable"
@@ -16,16 +16,25 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "cgroup.h"
 #include "clk.h"
 #include "err.h"
+#include "escalate.h"
+#include "fd.h"
+#include "hdr.h"
 #include "int.h"
+#include "load.h"
 #include "macros.h"
 #include "proc.h"
 #include "sig.h"
+#include "trace.h"
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -33,28 +42,208 @@
 #include <string.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include <sys/resource.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 
+/* When the maximum bound is reached, the child process is sent each
+ * signal in the escalation schedule in turn, and the last signal is
+ * repeated until the child process terminates. */
+
+#define TIMEBOUND_ESCALATE_MAX 8
+
+#define TIMEBOUND_CGROUP_KILL (-1)
+
+/* Each budget has a distinct exit status that is reported when the
+ * budget is exceeded, chosen to avoid the statuses used by the shell
+ * and by timeout(1). */
+
+#define TIMEBOUND_EXIT_STALL  120
+#define TIMEBOUND_EXIT_CPU    121
+#define TIMEBOUND_EXIT_MEMORY 122
+#define TIMEBOUND_EXIT_IO     123
+
+enum Budget {
+    BudgetNone,
+    BudgetStall,
+    BudgetCpu,
+    BudgetMemory,
+    BudgetIo,
+};
+
+/* The process tree comprises the child process and its descendants,
+ * which are tracked using a process group or a cgroup. */
+
+struct ProcessTree {
+    pid_t    mPid;
+    int      mGroup;
+    int      mReaper;
+    int      mOutputFd[2];
+    uint64_t mDeadlineMicros;
+    uint64_t mMaxDuration;
+    char     mCgroup[PATH_MAX];
+};
+
+/* Each run of the child process is measured from just before it is
+ * started until it is reaped, and its resource usage includes that of
+ * the descendants that it reaped. */
+
+struct RunSample {
+    int           mStatus;
+    uint64_t      mWallMicros;
+    struct rusage mUsage;
+};
+
+/* In repeat mode, wall times are recorded with three significant
+ * digits up to an hour. */
+
+#define TIMEBOUND_REPEAT_HIGHEST (3600ULL * 1000000)
+#define TIMEBOUND_REPEAT_DIGITS  3
+
+/* The trace ring retains the most recent lifecycle events of the
+ * child processes, including those of every batch job and periodic
+ * run. */
+
+#define TIMEBOUND_TRACE_EVENTS (64 * 1024)
+
+enum ReportFormat {
+    ReportText,
+    ReportCsv,
+    ReportJson,
+};
+
+/* To detect stalls, the output of the child process is relayed through
+ * a pipe, and spliced to the output of this process. */
+
+#define TIMEBOUND_RELAY_SIZE (1024 * 1024)
+
+struct OutputRelay {
+    int mPipeFd;
+    int mOutputFd;
+    int mBlocked;
+};
+
+/* In batch mode, job lines are read into a buffer that holds at least
+ * one complete line, and each job occupies a slot until its result is
+ * reported. */
+
+#define TIMEBOUND_BATCH_LINE_MAX (64 * 1024)
+#define TIMEBOUND_BATCH_WORDS    1024
+
+/* In periodic mode, a run that overlaps the next scheduled run can
+ * cause that run to be skipped, queued, or can be killed. */
+
+enum Overlap {
+    OverlapSkip,
+    OverlapQueue,
+    OverlapKill,
+};
+
+struct BatchReader {
+    int      mFd;
+    int      mEof;
+    unsigned mLineNo;
+    size_t   mLen;
+    size_t   mSkip;
+    char     mBuf[TIMEBOUND_BATCH_LINE_MAX + 1];
+};
+
+struct BatchJob {
+    unsigned mLineNo;
+    pid_t    mPid;
+    int      mStatus;
+    uint64_t mMinMicros;
+    uint64_t mBeginMicros;
+    uint64_t mEndMicros;
+
+    struct Escalation mEscalation;
+};
+
 /******************************************************************************/
+static int caughtSignal;
+
 static int optHelp;
-static uint32_t optMin;
-static uint32_t optMax;
+static uint64_t optMin;
+static uint64_t optMax;
+
+static struct EscalateStep optEscalate[TIMEBOUND_ESCALATE_MAX];
+static unsigned            optEscalates;
+
+static int optGroup;
+static int optCgroup;
+
+static const char *optBatch;
+static const char *optTrace;
+static unsigned    optJobs;
+
+static uint64_t     optPeriod;
+static enum Overlap optOverlap;
+static uint64_t     optJitter;
+static unsigned     optCatchUp = 1;
+
+static unsigned          optRepeat;
+static unsigned          optWarmup;
+static enum ReportFormat optFormat;
+
+static uint64_t optStall;
+static uint64_t optCpu;
+static uint64_t optMemory;
+static uint64_t optIo;
 
 /******************************************************************************/
 void
 usage(void)
 {
     static const char usageText[] =
-        "[-d] [ min [max] ] -- cmd ...\n"
+        "[-cdg] [-C N] [-I N] [-M N] [-S N] [-s sig[:N],...] [-t file]"
+        " [ min [max] ] -- cmd ...\n"
+        "       timebound -b file [-d] [-j N] [-s sig[:N],...] [-t file]"
+        " [ min [max] ]\n"
+        "       timebound -p N [-o policy] [-J N] [-K N] [options] [max] -- cmd ...\n"
+        "       timebound -n N [-w N] [-F format] [options] [ min [max] ] -- cmd ...\n"
         "\n"
         "Options:\n"
+        "  -b --batch file\n"
+        "               Run the jobs listed in file, or - for stdin\n"
+        "  -c --cgroup  Bound the process tree in a new cgroup\n"
+        "  -C --cpu N   Bound the cpu time used to duration N\n"
         "  -d --debug   Emit debug information\n"
+        "  -F --format text|csv|json\n"
+        "               Format of the repeat report [default: text]\n"
+        "  -g --group   Bound the process tree in a new process group\n"
+        "  -I --io N    Bound the bytes read and written to N\n"
+        "  -j --jobs N  Run at most N jobs concurrently [default: ncpus]\n"
+        "  -J --jitter N\n"
+        "               Delay each periodic run randomly by up to N\n"
+        "  -K --catch-up N\n"
+        "               Queue at most N late periodic runs [default: 1]\n"
+        "  -M --memory N\n"
+        "               Bound the memory used to N bytes\n"
+        "  -n --repeat N\n"
+        "               Run the command N times and report the wall times\n"
+        "  -o --overlap skip|queue|kill\n"
+        "               Overlapping periodic runs policy [default: skip]\n"
+        "  -p --period N\n"
+        "               Run the command every N at a fixed rate\n"
+        "  -S --stall N Bound the time between output to duration N\n"
+        "  -w --warmup N\n"
+        "               Run the command N times before those reported\n"
+        "  -s --signals sig[:N],...\n"
+        "               Signals to send N apart after max [TERM:5s,KILL:5s]\n"
+        "               Use cgroup.kill as a signal to kill the cgroup\n"
+        "  -t --trace file\n"
+        "               Trace lifecycle events to file, also on SIGUSR1\n"
         "\n"
         "Arguments:\n"
-        "  min          Minimum runtime in seconds\n"
-        "  max          Maximum runtime in seconds [default: unbounded]\n"
-        "  cmd ...      Program to monitor\n";
+        "  min          Minimum runtime [default: 0]\n"
+        "  max          Maximum runtime [default: unbounded]\n"
+        "  cmd ...      Program to monitor\n"
+        "\n"
+        "Durations are in seconds, or have a unit of us, ms, s, m or h.\n"
+        "Sizes are in bytes, or have a unit of k, m, g or t.\n";
 
     help(usageText, optHelp);
     exit(EXIT_FAILURE);
@@ -66,11 +255,28 @@ parse_options(int argc, char **argv)
 {
     int rc = -1;
 
-    static char shortOpts[] = "+hd";
+    static char shortOpts[] = "+hb:cC:dF:gI:j:J:K:M:n:o:p:s:S:t:w:";
 
     static struct option longOpts[] = {
         { "help",      no_argument,       0, 'h' },
+        { "batch",     required_argument, 0, 'b' },
+        { "cgroup",    no_argument,       0, 'c' },
+        { "cpu",       required_argument, 0, 'C' },
         { "debug",     no_argument,       0, 'd' },
+        { "format",    required_argument, 0, 'F' },
+        { "group",     no_argument,       0, 'g' },
+        { "io",        required_argument, 0, 'I' },
+        { "jobs",      required_argument, 0, 'j' },
+        { "jitter",    required_argument, 0, 'J' },
+        { "catch-up",  required_argument, 0, 'K' },
+        { "memory",    required_argument, 0, 'M' },
+        { "repeat",    required_argument, 0, 'n' },
+        { "overlap",   required_argument, 0, 'o' },
+        { "period",    required_argument, 0, 'p' },
+        { "signals",   required_argument, 0, 's' },
+        { "stall",     required_argument, 0, 'S' },
+        { "trace",     required_argument, 0, 't' },
+        { "warmup",    required_argument, 0, 'w' },
         { 0 },
     };
 
@@ -92,42 +298,227 @@ parse_options(int argc, char **argv)
         case '?':
             goto Finally;
 
+        case 'b':
+            optBatch = optarg; break;
+
+        case 'c':
+            optCgroup = 1; break;
+
+        case 'C':
+            if (clk_strtomicros(&optCpu, optarg) || !optCpu)
+                die("Unable to parse cpu time bound %s", optarg);
+            break;
+
         case 'd':
             debug("%s", DebugEnable); break;
+
+        case 'F':
+            if (!strcmp("text", optarg))
+                optFormat = ReportText;
+            else if (!strcmp("csv", optarg))
+                optFormat = ReportCsv;
+            else if (!strcmp("json", optarg))
+                optFormat = ReportJson;
+            else
+                die("Unable to parse report format %s", optarg);
+            break;
+
+        case 'g':
+            optGroup = 1; break;
+
+        case 'I':
+            if (int_strtosize(&optIo, optarg))
+                die("Unable to parse io bound %s", optarg);
+            break;
+
+        case 'j':
+            {
+                unsigned long jobs;
+
+                if (int_strtoul(&jobs, optarg) || jobs > UINT_MAX)
+                    die("Unable to parse job count %s", optarg);
+
+                optJobs = jobs;
+            }
+            break;
+
+        case 'J':
+            if (clk_strtomicros(&optJitter, optarg))
+                die("Unable to parse jitter %s", optarg);
+            break;
+
+        case 'K':
+            {
+                unsigned long catchUp;
+
+                if (int_strtoul(&catchUp, optarg) || catchUp > UINT_MAX)
+                    die("Unable to parse catch-up limit %s", optarg);
+
+                optCatchUp = catchUp;
+            }
+            break;
+
+        case 'M':
+            if (int_strtosize(&optMemory, optarg))
+                die("Unable to parse memory bound %s", optarg);
+            break;
+
+        case 'n':
+            {
+                unsigned long repeat;
+
+                if (int_strtoul(&repeat, optarg) || repeat > UINT_MAX)
+                    die("Unable to parse repeat count %s", optarg);
+
+                optRepeat = repeat;
+            }
+            break;
+
+        case 'o':
+            if (!strcmp("skip", optarg))
+                optOverlap = OverlapSkip;
+            else if (!strcmp("queue", optarg))
+                optOverlap = OverlapQueue;
+            else if (!strcmp("kill", optarg))
+                optOverlap = OverlapKill;
+            else
+                die("Unable to parse overlap policy %s", optarg);
+            break;
+
+        case 'p':
+            if (clk_strtomicros(&optPeriod, optarg) || !optPeriod)
+                die("Unable to parse period %s", optarg);
+            break;
+
+        case 'S':
+            if (clk_strtomicros(&optStall, optarg) || !optStall)
+                die("Unable to parse stall bound %s", optarg);
+            break;
+
+        case 't':
+            optTrace = optarg; break;
+
+        case 'w':
+            {
+                unsigned long warmup;
+
+                if (int_strtoul(&warmup, optarg) || warmup > UINT_MAX - 1)
+                    die("Unable to parse warmup count %s", optarg);
+
+                optWarmup = warmup;
+            }
+            break;
+
+        case 's':
+            {
+                /* Each step defaults to the delay used before the
+                 * schedule was configurable. */
+
+                optEscalates = 0;
+
+                char *stepSave;
+                char *stepText = strtok_r(optarg, ",", &stepSave);
+
+                for ( ; stepText; stepText = strtok_r(0, ",", &stepSave)) {
+
+                    if (TIMEBOUND_ESCALATE_MAX <= optEscalates)
+                        die("Too many escalation signals");
+
+                    struct EscalateStep *step = &optEscalate[optEscalates++];
+
+                    char *delaySep = strchr(stepText, ':');
+                    if (delaySep)
+                        *delaySep++ = 0;
+
+                    if (!strcmp("cgroup.kill", stepText))
+                        step->mSignal = TIMEBOUND_CGROUP_KILL;
+                    else if (signal_parse(&step->mSignal, stepText) ||
+                            !step->mSignal)
+                        die("Unable to parse escalation signal %s", stepText);
+
+                    step->mDelayMicros = 5 * 1000000;
+                    if (delaySep &&
+                            clk_strtomicros(&step->mDelayMicros, delaySep))
+                        die("Unable to parse escalation delay %s", delaySep);
+                }
+
+                if (!optEscalates)
+                    die("No escalation signals specified");
+
+                if (!optEscalate[optEscalates-1].mDelayMicros)
+                    die("Last escalation signal must have a delay");
+            }
+            break;
         }
     }
 
-    if (argc > optind && isdigit((unsigned char) argv[optind][0])) {
+    if (optBatch) {
+        if (optCgroup || optGroup || optCpu || optMemory || optIo || optStall)
+            die("Batch jobs support only time bounds and signals");
+        if (optPeriod)
+            die("Batch jobs cannot be periodic");
+    } else if (optJobs) {
+        die("Job count requires --batch");
+    }
 
-        unsigned long minDuration;
-        if (int_strtoul(&minDuration, argv[optind]))
-            die("Unable to parse minimum time bound %s", argv[optind]);
+    if (optPeriod) {
+        if (optJitter >= optPeriod)
+            die("Jitter must be less than the period");
+    }
+
+    if (optRepeat) {
+        if (optBatch || optPeriod)
+            die("Repeated runs cannot be batched or periodic");
+        if (optRepeat > UINT_MAX - optWarmup)
+            die("Too many repeated runs");
+    } else if (optWarmup) {
+        die("Warmup runs require --repeat");
+    }
+
+    if (!optCgroup) {
+        for (unsigned ix = 0; ix < optEscalates; ++ix) {
+            if (TIMEBOUND_CGROUP_KILL == optEscalate[ix].mSignal)
+                die("Escalation using cgroup.kill requires --cgroup");
+        }
+    }
 
-        optMin = minDuration;
-        if (optMin != minDuration)
-            die("Minimum time bound too large %lu", minDuration);
+    /* When no bounds are specified, getopt_long() consumes the --
+     * separator that follows the options. */
+
+    if (!optBatch && 1 < optind && !strcmp("--", argv[optind-1])) {
+        if (argc > optind)
+            rc = 0;
+        goto Finally;
+    }
+
+    /* Periodic runs are paced by the period rather than by a minimum
+     * bound, so only a maximum bound is accepted. */
+
+    if (!optPeriod &&
+            argc > optind && isdigit((unsigned char) argv[optind][0])) {
+
+        if (clk_strtomicros(&optMin, argv[optind]))
+            die("Unable to parse minimum time bound %s", argv[optind]);
 
         ++optind;
     }
 
     if (argc > optind && isdigit((unsigned char) argv[optind][0])) {
 
-        unsigned long maxDuration;
-        if (int_strtoul(&maxDuration, argv[optind]))
+        if (clk_strtomicros(&optMax, argv[optind]) || !optMax)
             die("Unable to parse maximum time bound %s", argv[optind]);
 
-        optMax = maxDuration;
-        if (optMax != maxDuration)
-            die("Maximum time bound too large %lu", maxDuration);
-
         if (optMax < optMin)
-            die("Maximum time bound %" PRIu32 "s is smaller than "
-                "minimum time bound %" PRIu32 "s", optMax, optMin);
+            die("Maximum time bound %" PRIu64 "us is smaller than "
+                "minimum time bound %" PRIu64 "us", optMax, optMin);
 
         ++optind;
     }
 
-    if (argc > optind && !strcmp("--", argv[optind])) {
+    if (optBatch) {
+        if (argc == optind)
+            rc = 0;
+    } else if (argc > optind && !strcmp("--", argv[optind])) {
         if (argc > ++optind)
             rc = 0;
     }
@@ -146,199 +537,1697 @@ Finally:
 
 /******************************************************************************/
 int
-spawn_command(char **aCmd)
+prepare_command(void *aArg)
 {
     int rc = -1;
 
-    pid_t childPid = proc_execute(aCmd);
-    if (-1 == childPid)
-        goto Finally;
+    const struct ProcessTree *tree = aArg;
 
-    int alarmDelivered = 0;
+    /* Place the child process in the process group, or cgroup, before
+     * it executes the command so that all its descendants inherit it. */
 
-    while (1) {
+    if (tree->mGroup) {
+        if (setpgid(0, 0))
+            goto Finally;
+    }
 
-        /* Propagate all caught signals to the child process. The child
-         * might choose to ignore or catch the signals, and might not
-         * terminate.
-         *
-         * https://people.freebsd.org/~cracauer/homepage-mirror/sigint.html
-         */
+    if (tree->mCgroup[0]) {
+        if (cgroup_enter(tree->mCgroup))
+            goto Finally;
+    }
 
-        sig_atomic_t sigSet = signalset_sample();
+    /* Direct the output of the child process to the relay, and restore
+     * the disposition of SIGPIPE, which is ignored while relaying, so
+     * that the child process terminates if the relay closes. */
 
-        for (int signal = 0; sigSet; ++signal) {
-            if (sigSet & 1) {
-                if (SIGALRM == signal) {
+    if (-1 != tree->mOutputFd[0]) {
+        if (STDOUT_FILENO != dup2(tree->mOutputFd[0], STDOUT_FILENO))
+            goto Finally;
 
-                    /* Allow the child to react to the first alarm using
-                     * SIGTERM, but use SIGKILL on subsequent alarms. */
+        if (STDERR_FILENO != dup2(tree->mOutputFd[1], STDERR_FILENO))
+            goto Finally;
 
-                    if (alarmDelivered)
-                        signal = SIGKILL;
-                    else {
-                        signal = SIGTERM;
-                        alarmDelivered = 1;
-                    }
+        if (SIG_ERR == signal(SIGPIPE, SIG_DFL))
+            goto Finally;
+    }
 
-                    DEBUG("Using signal %d for expired alarm", signal);
-                }
+    /* The cpu budget is sampled across the tree, but also limit each
+     * process so that the kernel enforces the budget if the process
+     * consumes it between samples. The soft limit raises SIGXCPU, and
+     * the hard limit follows with SIGKILL. */
 
-                DEBUG(
-                    "Delivering signal %d to child process %d",
-                    signal, childPid);
+    /* Propagate the deadline so that the program can budget its own
+     * work. The deadline is measured against CLOCK_MONOTONIC, which
+     * remains valid across nested programs, and the remaining time
+     * suits programs that cannot read that clock. The variables are
+     * only set in the child process so that they do not linger for
+     * later runs without a deadline. */
 
-                kill(childPid, signal);
-            }
-            sigSet >>= 1;
+    if (tree->mMaxDuration) {
+        char deadlineText[sizeof(uint64_t) * CHAR_BIT + sizeof(".000000")];
+
+        snprintf(deadlineText, sizeof(deadlineText),
+            "%" PRIu64 ".%06" PRIu64,
+            tree->mDeadlineMicros / 1000000,
+            tree->mDeadlineMicros % 1000000);
+
+        if (setenv("TIMEBOUND_DEADLINE", deadlineText, 1))
+            goto Finally;
+
+        snprintf(deadlineText, sizeof(deadlineText),
+            "%" PRIu64 ".%06" PRIu64,
+            tree->mMaxDuration / 1000000, tree->mMaxDuration % 1000000);
+
+        if (setenv("TIMEBOUND_REMAINING", deadlineText, 1))
+            goto Finally;
+    }
+
+    if (optCpu) {
+        rlim_t cpuSeconds = (optCpu + 999999) / 1000000;
+
+        struct rlimit cpuLimit = {
+            .rlim_cur = cpuSeconds,
+            .rlim_max = cpuSeconds + 1,
+        };
+
+        if (setrlimit(RLIMIT_CPU, &cpuLimit))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+dump_trace(void)
+{
+    DEBUG("Writing trace %s", optTrace);
+
+    if (trace_dump(optTrace))
+        warn("Unable to write trace %s", optTrace);
+}
+
+/*----------------------------------------------------------------------------*/
+void
+signal_tree(const struct ProcessTree *aTree, int aSignal)
+{
+    /* Signal every process in the tree if it is tracked, otherwise only
+     * the child process itself. */
+
+    if (aTree->mCgroup[0]) {
+        if (TIMEBOUND_CGROUP_KILL == aSignal) {
+            if (cgroup_kill(aTree->mCgroup))
+                warn("Unable to kill cgroup %s", aTree->mCgroup);
+        } else {
+            if (-1 == cgroup_signal(aTree->mCgroup, aSignal))
+                warn("Unable to signal cgroup %s", aTree->mCgroup);
         }
+    } else if (aTree->mGroup) {
+        proc_kill(-aTree->mPid, aSignal);
+    } else {
+        proc_kill(aTree->mPid, aSignal);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int
+empty_tree(const struct ProcessTree *aTree)
+{
+    /* When acting as the subreaper, descendants are reparented to this
+     * process, so the tree is empty once there are no children left to
+     * reap. Otherwise check the cgroup or process group directly. */
+
+    if (aTree->mCgroup[0]) {
+        int procCount = cgroup_signal(aTree->mCgroup, 0);
+        if (-1 == procCount)
+            fatal("Unable to read cgroup %s", aTree->mCgroup);
+
+        if (procCount)
+            return 0;
+    } else if (aTree->mGroup && !aTree->mReaper) {
+        if (!proc_kill(-aTree->mPid, 0) || ESRCH != errno)
+            return 0;
+    }
+
+    if (aTree->mReaper) {
+        if (-1 != proc_wait(-1, 0, WNOHANG, 0) || ECHILD != errno)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+ssize_t
+relay_output(int aMonitorFd, struct OutputRelay *aRelay, int aDrain)
+{
+    ssize_t rc = 0;
 
-        int childStatus;
+    /* Relay output only while the destination is writable so that a
+     * slow reader cannot block this process and defer the bounds.
+     * Otherwise wait for the destination to drain, unless draining the
+     * remaining output once the tree has terminated. The pipe is edge
+     * triggered, and is only reported again when new output arrives.
+     * Close the pipe at end of file, or if the destination fails, so
+     * that the child process sees the failure as it would have if
+     * writing directly. */
 
-        pid_t pid = waitpid(childPid, &childStatus, WUNTRACED);
-        if (-1 == pid) {
+    aRelay->mBlocked = 0;
+
+    while (-1 != aRelay->mPipeFd) {
+
+        struct pollfd pollFd = { .fd = aRelay->mOutputFd, .events = POLLOUT };
+
+        int pollCount = poll(&pollFd, 1, aDrain ? -1 : 0);
+        if (-1 == pollCount) {
             if (EINTR == errno)
                 continue;
-            fatal("Unable to wait for child process %d", childPid);
+            fatal("Unable to poll output %d", aRelay->mOutputFd);
         }
 
-        if (WIFSTOPPED(childStatus)) {
-            int stopSig = WSTOPSIG(childStatus);
+        if (!pollCount) {
+            if (proc_monitor_oneshot(aMonitorFd, aRelay->mOutputFd, 1))
+                fatal("Unable to watch output %d", aRelay->mOutputFd);
+            aRelay->mBlocked = 1;
+            break;
+        }
 
-            DEBUG("Child process %d stopped signal %d", childPid, stopSig);
+        ssize_t relayLen = fd_splice(
+            aRelay->mPipeFd, aRelay->mOutputFd, TIMEBOUND_RELAY_SIZE);
 
-            if (kill(getpid(), stopSig)) {
-                warn("Unable to stop process after signal %d", stopSig);
-            }
+        if (-1 == relayLen) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno)
+                break;
 
-            continue;
+            DEBUG("Unable to relay output %d errno %d",
+                aRelay->mOutputFd, errno);
         }
 
-        if (WIFEXITED(childStatus)) {
-            int exitStatus = WEXITSTATUS(childStatus);
-
-            DEBUG("Child process %d exit status %d", childPid, exitStatus);
-            rc = 0x000 + exitStatus;
+        if (0 >= relayLen) {
+            fd_close(aRelay->mPipeFd);
+            aRelay->mPipeFd = -1;
+            break;
         }
-        else if (WIFSIGNALED(childStatus)) {
-            int termSig = WTERMSIG(childStatus);
 
-            DEBUG("Child process %d termination signal %d", childPid, termSig);
-            rc = 0x100 + termSig;
-        }
+        rc += relayLen;
+    }
 
-        break;
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+enum Budget
+sample_budget(pid_t aPid)
+{
+    /* Sample the resources used by the child process, which include
+     * those of its descendants if it has a cgroup of its own. A sample
+     * that cannot be taken is skipped. */
+
+    uint64_t usage;
+
+    if (optCpu && !load_cpu(aPid, &usage) && usage >= optCpu) {
+        DEBUG("Cpu time %" PRIu64 "us exceeds bound", usage);
+        return BudgetCpu;
     }
 
-Finally:
+    if (optMemory && !load_memory(aPid, &usage) && usage > optMemory) {
+        DEBUG("Memory %" PRIu64 "b exceeds bound", usage);
+        return BudgetMemory;
+    }
 
-    return rc;
+    if (optIo && !load_io(aPid, &usage) && usage > optIo) {
+        DEBUG("Io %" PRIu64 "b exceeds bound", usage);
+        return BudgetIo;
+    }
+
+    return BudgetNone;
+}
+
+/*----------------------------------------------------------------------------*/
+enum Budget
+enforced_budget(const struct ProcessTree *aTree, int aChildStatus)
+{
+    /* Detect budgets enforced by the kernel, rather than by sampling,
+     * from the termination signal of the child process or from the
+     * events counted by the cgroup. */
+
+    if (optCpu && 0x100 + SIGXCPU == aChildStatus)
+        return BudgetCpu;
+
+    if (optMemory && aTree->mCgroup[0]) {
+        uint64_t oomKills;
+
+        if (!cgroup_stat(aTree->mCgroup, "memory.events", "oom_kill", &oomKills)
+                && oomKills)
+            return BudgetMemory;
+    }
+
+    return BudgetNone;
 }
 
 /******************************************************************************/
 int
-run_command(uint32_t aMinDuration, uint32_t aMaxDuration, char **aCmd)
+spawn_command(char **aCmd, struct ProcessTree *aTree, uint64_t aDeadlineMicros,
+              struct RunSample *aSample)
 {
     int rc = -1;
 
-    uint64_t beginMillis = clk_monomillis();
+    int monitorFd = -1;
 
-    signal_catch();
+    struct OutputRelay relay[2] = { { .mPipeFd = -1 }, { .mPipeFd = -1 } };
 
-    if (aMaxDuration) {
+    /* Wait for the child process using the process monitor, which wakes
+     * on SIGCHLD, and bound each wait by the next deadline. Neither
+     * interval timers nor SIGALRM are used, so the child process is
+     * free to use them for its own purposes. */
+
+    sigset_t caughtSet;
+
+    signal_caught(&caughtSet);
+
+    monitorFd = proc_monitor_create(0, &caughtSet);
+    if (-1 == monitorFd)
+        goto Finally;
+
+    for (unsigned ix = 0; ix < NUMBEROF(relay); ++ix) {
+        if (!optStall)
+            break;
 
-        /* Configure the upper bound, and also set the timer to
-         * recur after the initial timeout in order to forcibly
-         * terminate the child. */
+        int relayPipe[2];
 
-        struct itimerval maxDuration;
+        if (pipe(relayPipe))
+            goto Finally;
+
+        relay[ix].mPipeFd   = relayPipe[0];
+        relay[ix].mOutputFd = ix ? STDERR_FILENO : STDOUT_FILENO;
 
-        maxDuration.it_interval.tv_sec = 5;
-        maxDuration.it_interval.tv_usec = 0;
+        aTree->mOutputFd[ix] = relayPipe[1];
+
+        if (fd_cloexec(relayPipe[0]) || fd_cloexec(relayPipe[1]))
+            goto Finally;
 
-        maxDuration.it_value.tv_sec = aMaxDuration;
-        maxDuration.it_value.tv_usec = 0;
+        /* Larger pipes let each splice move more output. */
 
-        DEBUG("Configured timer for %" PRIu32 "s", aMaxDuration);
+#ifdef F_SETPIPE_SZ
+        if (-1 == fcntl(relayPipe[0], F_SETPIPE_SZ, TIMEBOUND_RELAY_SIZE)) {
+            DEBUG("Unable to resize relay pipe");
+        }
+#endif
 
-        if (maxDuration.it_value.tv_sec != aMaxDuration)
-            die("Unable to set maximum duration %" PRIu32 "s", aMaxDuration);
+        if (fd_nonblock(relay[ix].mPipeFd))
+            goto Finally;
 
-        if (setitimer(ITIMER_REAL, &maxDuration, 0))
-            die("Unable to set timer for "
-                "maximum duration %" PRIu32 "s", aMaxDuration);
+        if (proc_monitor_watch(monitorFd, relay[ix].mPipeFd, 1))
+            goto Finally;
     }
 
-    int exitCode = spawn_command(aCmd);
-    if (-1 == exitCode)
+    int treeBound = aTree->mGroup || aTree->mCgroup[0];
+
+    uint64_t beginMicros = clk_monomicros();
+
+    TRACE(TraceInstant, "spawn", 0, 0);
+
+    pid_t childPid = proc_execute(
+        aCmd,
+        treeBound || optCpu || optStall || aTree->mMaxDuration
+            ? prepare_command : 0, aTree);
+    if (-1 == childPid)
         goto Finally;
 
-    rc = exitCode;
+    TRACE(TraceInstant, "exec", childPid, 0);
 
-Finally:
+    aTree->mPid = childPid;
 
-    FINALLY({
-        struct itimerval disableTimer;
+    for (unsigned ix = 0; ix < NUMBEROF(aTree->mOutputFd); ++ix) {
+        if (-1 != aTree->mOutputFd[ix]) {
+            fd_close(aTree->mOutputFd[ix]);
+            aTree->mOutputFd[ix] = -1;
+        }
+    }
 
-        disableTimer.it_interval.tv_sec = 0;
-        disableTimer.it_interval.tv_usec = 0;
+    int childStatus = -1;
 
-        disableTimer.it_value.tv_sec = 0;
-        disableTimer.it_value.tv_usec = 0;
+    struct Escalation escalation;
 
-        if (setitimer(ITIMER_REAL, &disableTimer, 0))
-            fatal("Unable to disable timer");
+    escalate_init(&escalation, optEscalate, optEscalates);
+    escalate_start(&escalation, aDeadlineMicros);
 
-        signal_release();
+    enum Budget budget = BudgetNone;
+    int         budgetBound = optCpu || optMemory || optIo;
+
+    uint64_t stallMicros = clk_coarsemicros() + optStall;
+
+    while (1) {
 
-        while (-1 != rc && exitCode < 0x100) {
-            uint64_t endMillis = clk_monomillis();
+        /* Propagate all caught signals to the child process. The child
+         * might choose to ignore or catch the signals, and might not
+         * terminate.
+         *
+         * https://people.freebsd.org/~cracauer/homepage-mirror/sigint.html
+         */
 
-            uint64_t durationMillis = endMillis - beginMillis;
+        sig_atomic_t sigSet = signalset_sample();
 
-            DEBUG("Elapsed runtime %" PRIu64 "ms", durationMillis);
+        for (int signal = 0; sigSet; ++signal) {
+            if (sigSet & 1) {
+                if (optTrace && SIGUSR1 == signal) {
+                    dump_trace();
+                } else {
+                    DEBUG(
+                        "Delivering signal %d to child process %d",
+                        signal, childPid);
 
-            if (durationMillis / 1000 >= aMinDuration)
-                break;
+                    TRACE(TraceInstant,
+                        SIGCONT == signal ? "continue" : "signal",
+                        childPid, signal);
 
-            uint32_t sleepMillis =
-                (uint64_t) aMinDuration * 1000 - durationMillis;
+                    signal_tree(aTree, signal);
 
-            DEBUG("Waiting %" PRIu32 "ms", sleepMillis);
-            clk_sleepmillis(sleepMillis);
+                    if (SIGCONT != signal)
+                        caughtSignal = signal;
+                }
+            }
+            sigSet >>= 1;
         }
-    });
 
-    return rc;
-}
+        /* Relay output before reaping so that output written by the
+         * child process before it terminates is not lost. Restart the
+         * stall bound whenever there is output, or while the output is
+         * blocked by the reader rather than by the child process. */
 
-/******************************************************************************/
-int
-main(int argc, char **argv)
-{
-    int exitCode = 255;
+        if (optStall) {
+            int relayActive = 0;
 
-    char **cmd = parse_options(argc, argv);
-    if (!cmd || !cmd[0])
-        usage();
+            for (unsigned ix = 0; ix < NUMBEROF(relay); ++ix) {
+                if (relay_output(monitorFd, &relay[ix], 0) ||
+                        relay[ix].mBlocked)
+                    relayActive = 1;
+            }
 
-    int cmdExit = run_command(optMin, optMax, cmd);
+            if (relayActive)
+                stallMicros = clk_coarsemicros() + optStall;
+        }
 
-    if (-1 == cmdExit)
-        goto Finally;
+        /* When bounding the tree, reap every descendant reparented to
+         * this process, including those that outlive the child, but
+         * only act on the status of the child. */
 
-    /* If the child process terminated due to a signal, reproduce
-     * that signal here so that the outcome is visible to the
-     * grandparent. */
+        while (aTree->mReaper || -1 == childStatus) {
 
-    if (0x100 <= cmdExit) {
-        kill(getpid(), cmdExit - 0x100);
-        goto Finally;
-    }
+            int           waitStatus;
+            struct rusage waitUsage;
 
-    exitCode = cmdExit;
+            pid_t pid = proc_wait(
+                aTree->mReaper ? -1 : childPid, &waitStatus,
+                WNOHANG|WUNTRACED, &waitUsage);
 
-Finally:
+            if (-1 == pid) {
+                if (EINTR == errno)
+                    continue;
+                if (ECHILD == errno && -1 != childStatus)
+                    break;
+                fatal("Unable to wait for child process %d", childPid);
+            }
+
+            if (!pid)
+                break;
+
+            if (childPid != pid) {
+                if (!WIFSTOPPED(waitStatus)) {
+                    DEBUG("Reaped descendant process %d", pid);
+                }
+                continue;
+            }
+
+            if (WIFSTOPPED(waitStatus)) {
+                int stopSig = WSTOPSIG(waitStatus);
+
+                DEBUG("Child process %d stopped signal %d", childPid, stopSig);
+
+                TRACE(TraceInstant, "stop", childPid, stopSig);
+
+                if (kill(getpid(), stopSig)) {
+                    warn("Unable to stop process after signal %d", stopSig);
+                }
+
+                continue;
+            }
+
+            if (WIFEXITED(waitStatus)) {
+                int exitStatus = WEXITSTATUS(waitStatus);
+
+                DEBUG("Child process %d exit status %d", childPid, exitStatus);
+                childStatus = 0x000 + exitStatus;
+            }
+            else if (WIFSIGNALED(waitStatus)) {
+                int termSig = WTERMSIG(waitStatus);
+
+                DEBUG("Child process %d termination signal %d",
+                    childPid, termSig);
+                childStatus = 0x100 + termSig;
+            }
+
+            TRACE(TraceInstant, "exit", childPid, childStatus);
+
+            if (aSample) {
+                aSample->mStatus     = childStatus;
+                aSample->mWallMicros = clk_monomicros() - beginMicros;
+                aSample->mUsage      = waitUsage;
+            }
+        }
+
+        /* Only return once the whole tree has terminated so that no
+         * descendant outlives the bound. */
+
+        if (-1 != childStatus) {
+            if (!treeBound || empty_tree(aTree)) {
+                for (unsigned ix = 0; ix < NUMBEROF(relay); ++ix)
+                    relay_output(monitorFd, &relay[ix], 1);
+
+                if (BudgetNone == budget)
+                    budget = enforced_budget(aTree, childStatus);
+
+                static const int BudgetExit[] = {
+                    [BudgetStall]  = TIMEBOUND_EXIT_STALL,
+                    [BudgetCpu]    = TIMEBOUND_EXIT_CPU,
+                    [BudgetMemory] = TIMEBOUND_EXIT_MEMORY,
+                    [BudgetIo]     = TIMEBOUND_EXIT_IO,
+                };
+
+                rc = BudgetNone == budget
+                    ? childStatus : 0x200 + BudgetExit[budget];
+                break;
+            }
+        }
+
+        /* Sample the budgets while the child process runs, and once a
+         * budget is exceeded, start the escalation schedule at once
+         * unless the maximum bound has already started it. */
+
+        if ((budgetBound || optStall) && -1 == childStatus &&
+                !escalation.mSignals) {
+            budget = budgetBound ? sample_budget(childPid) : BudgetNone;
+
+            if (BudgetNone == budget && optStall) {
+                if (clk_coarsemicros() >= stallMicros) {
+                    DEBUG("Output stalled");
+                    budget = BudgetStall;
+                }
+            }
+
+            if (BudgetNone != budget) {
+                static const char *BudgetTrace[] = {
+                    [BudgetStall]  = "stall",
+                    [BudgetCpu]    = "cpu",
+                    [BudgetMemory] = "memory",
+                    [BudgetIo]     = "io",
+                };
+
+                TRACE(TraceInstant, BudgetTrace[budget], childPid, 0);
+
+                escalate_start(&escalation, clk_monomicros());
+            }
+        }
+
+        /* Once the maximum bound is reached, allow the child to react to
+         * the first signals in the schedule, then repeat the last signal
+         * until the child terminates. */
+
+        uint64_t nowMicros = clk_monomicros();
+
+        const struct EscalateStep *step =
+            escalate_signal(&escalation, nowMicros);
+
+        if (step) {
+            DEBUG("Escalating signal %d to child process %d",
+                step->mSignal, childPid);
+
+            TRACE(TraceInstant, "terminate", childPid, step->mSignal);
+
+            signal_tree(aTree, step->mSignal);
+
+            continue;
+        }
+
+        int waitMillis = escalate_wait(&escalation, nowMicros);
+
+        /* Descendants that are not children of this process do not
+         * raise SIGCHLD when they terminate, so poll for them. */
+
+        static const int TreePollMillis = 100;
+
+        if (-1 != childStatus && !aTree->mReaper) {
+            if (-1 == waitMillis || TreePollMillis < waitMillis)
+                waitMillis = TreePollMillis;
+        }
+
+        static const int BudgetPollMillis = 100;
+
+        if (budgetBound && -1 == childStatus && !escalation.mSignals) {
+            if (-1 == waitMillis || BudgetPollMillis < waitMillis)
+                waitMillis = BudgetPollMillis;
+        }
+
+        if (optStall && -1 == childStatus && !escalation.mSignals) {
+            uint64_t nowMicros  = clk_coarsemicros();
+            uint64_t waitMicros =
+                stallMicros > nowMicros ? stallMicros - nowMicros : 0;
+
+            int stallMillis = waitMicros / 1000 >= INT_MAX
+                ? INT_MAX : (waitMicros + 999) / 1000;
+
+            if (-1 == waitMillis || stallMillis < waitMillis)
+                waitMillis = stallMillis;
+        }
+
+        struct ProcMonitorEvent procEvent;
+
+        if (proc_monitor_wait(monitorFd, waitMillis, &procEvent))
+            fatal("Unable to wait for process monitor");
+    }
+
+Finally:
+
+    FINALLY({
+        for (unsigned ix = 0; ix < NUMBEROF(relay); ++ix) {
+            if (-1 != relay[ix].mPipeFd)
+                fd_close(relay[ix].mPipeFd);
+        }
+
+        for (unsigned ix = 0; ix < NUMBEROF(aTree->mOutputFd); ++ix) {
+            if (-1 != aTree->mOutputFd[ix]) {
+                fd_close(aTree->mOutputFd[ix]);
+                aTree->mOutputFd[ix] = -1;
+            }
+        }
+
+        if (-1 != monitorFd)
+            proc_monitor_close(monitorFd);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+run_command(uint64_t aMinDuration, uint64_t aMaxDuration, char **aCmd,
+            struct RunSample *aSample)
+{
+    int rc = -1;
+
+    uint64_t beginMicros = clk_monomicros();
+
+    uint64_t deadlineMicros = 0;
+
+    if (aMaxDuration) {
+        deadlineMicros = beginMicros + aMaxDuration;
+
+        DEBUG("Configured deadline for %" PRIu64 "us", aMaxDuration);
+    }
+
+    struct ProcessTree tree = {
+        .mGroup          = optGroup,
+        .mOutputFd       = { -1, -1 },
+        .mDeadlineMicros = deadlineMicros,
+        .mMaxDuration    = aMaxDuration,
+    };
+
+    /* Become the subreaper for the tree so that descendants orphaned by
+     * their parents can still be reaped, and counted, here. */
+
+    if (optGroup || optCgroup) {
+#ifdef __linux__
+        if (prctl(PR_SET_CHILD_SUBREAPER, 1))
+            warn("Unable to become subreaper");
+        else
+            tree.mReaper = 1;
+#endif
+    }
+
+    if (optCgroup) {
+        char cgroupName[sizeof("timebound.") + sizeof(pid_t) * CHAR_BIT];
+
+        snprintf(cgroupName, sizeof(cgroupName), "timebound.%d", getpid());
+
+        if (cgroup_create(tree.mCgroup, sizeof(tree.mCgroup), cgroupName))
+            die("Unable to create cgroup %s", cgroupName);
+
+        DEBUG("Created cgroup %s", tree.mCgroup);
+
+        /* Have the kernel enforce the memory budget if the memory
+         * controller is available to the cgroup, otherwise rely on
+         * sampling alone. */
+
+        if (optMemory) {
+            char memoryText[sizeof(uint64_t) * CHAR_BIT + sizeof("\n")];
+
+            snprintf(memoryText, sizeof(memoryText),
+                "%" PRIu64 "\n", optMemory);
+
+            if (cgroup_write(tree.mCgroup, "memory.max", memoryText)) {
+                DEBUG("Unable to limit memory of cgroup %s", tree.mCgroup);
+            }
+        }
+    }
+
+    signal_catch();
+
+    /* Relay failures are reported as errors rather than signals so that
+     * the pipe can be closed and the child process notified in turn. */
+
+    if (optStall) {
+        if (SIG_ERR == signal(SIGPIPE, SIG_IGN))
+            die("Unable to ignore SIGPIPE");
+    }
+
+    int exitCode = spawn_command(aCmd, &tree, deadlineMicros, aSample);
+    if (-1 == exitCode)
+        goto Finally;
+
+    rc = exitCode;
+
+Finally:
+
+    FINALLY({
+        signal_release();
+
+        if (tree.mCgroup[0]) {
+            if (cgroup_remove(tree.mCgroup))
+                warn("Unable to remove cgroup %s", tree.mCgroup);
+        }
+
+        if (-1 != rc && exitCode < 0x100) {
+            uint64_t endMicros = clk_monomicros();
+
+            uint64_t durationMicros = endMicros - beginMicros;
+
+            DEBUG("Elapsed runtime %" PRIu64 "us", durationMicros);
+
+            if (durationMicros < aMinDuration) {
+                DEBUG("Waiting %" PRIu64 "us",
+                    aMinDuration - durationMicros);
+                clk_sleepuntil(beginMicros + aMinDuration);
+            }
+        }
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+run_periodic(uint64_t aMaxDuration, char **aCmd)
+{
+    int rc = -1;
+
+    /* Schedule each run at a fixed rate measured from the first run,
+     * rather than at a fixed delay after the previous run, so that the
+     * schedule does not drift. Runs continue until a signal is caught
+     * while a run is in progress, or is received between runs. */
+
+    srand(getpid());
+
+    uint64_t epochMicros = clk_monomicros();
+    uint64_t tick        = 0;
+
+    while (1) {
+
+        uint64_t tickMicros  = epochMicros + tick * optPeriod;
+        uint64_t startMicros = tickMicros;
+
+        if (optJitter) {
+            uint64_t jitter = (uint64_t) rand() << 31 | rand();
+
+            startMicros += jitter % optJitter;
+        }
+
+        clk_sleepuntil(startMicros);
+
+        uint64_t beginMicros = clk_monomicros();
+
+        DEBUG("Run %" PRIu64 " started %" PRIu64 "us after schedule",
+            tick, beginMicros - startMicros);
+
+        /* When killing overlapping runs, bound each run so that it is
+         * terminated by the time the next run is due. */
+
+        uint64_t maxDuration = aMaxDuration;
+
+        if (OverlapKill == optOverlap) {
+            uint64_t nextMicros = tickMicros + optPeriod;
+
+            uint64_t untilNext = nextMicros > beginMicros
+                ? nextMicros - beginMicros : 1;
+
+            if (!maxDuration || untilNext < maxDuration)
+                maxDuration = untilNext;
+        }
+
+        int exitCode = run_command(0, maxDuration, aCmd, 0);
+        if (-1 == exitCode)
+            goto Finally;
+
+        if (caughtSignal) {
+            DEBUG("Stopping after signal %d", caughtSignal);
+            rc = 0x100 + caughtSignal;
+            break;
+        }
+
+        /* If the run overlapped later runs, either skip those runs,
+         * queue at most the catch-up limit of them to run immediately,
+         * or when killing overlapping runs, start the latest run that
+         * is due now. */
+
+        uint64_t endMicros = clk_monomicros();
+        uint64_t dueTick   = (endMicros - epochMicros) / optPeriod;
+        uint64_t nextTick  = tick + 1;
+
+        if (dueTick >= nextTick) {
+            uint64_t lateTicks = dueTick - nextTick + 1;
+
+            switch (optOverlap) {
+            case OverlapSkip:
+                nextTick = dueTick + 1;
+                break;
+
+            case OverlapQueue:
+                if (lateTicks > optCatchUp)
+                    nextTick = dueTick + 1 - optCatchUp;
+                break;
+
+            case OverlapKill:
+                nextTick = dueTick;
+                break;
+            }
+
+            DEBUG("Run %" PRIu64 " overlapped %" PRIu64 " runs, skipping %"
+                PRIu64, tick, lateTicks, nextTick - (tick + 1));
+        }
+
+        tick = nextTick;
+    }
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint64_t
+timeval_micros(const struct timeval *aTime)
+{
+    return (uint64_t) aTime->tv_sec * 1000000 + aTime->tv_usec;
+}
+
+/*----------------------------------------------------------------------------*/
+static uint64_t
+rusage_maxrss(const struct rusage *aUsage)
+{
+    /* The maximum resident set size is reported in bytes on MacOS, but
+     * in kilobytes elsewhere. */
+
+#ifdef __APPLE__
+    return aUsage->ru_maxrss / 1024;
+#else
+    return aUsage->ru_maxrss;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+void
+report_repeat(FILE *aFile,
+              const struct HdrHistogram *aWall,
+              const struct RunSample *aSample, unsigned aSamples)
+{
+    static const struct {
+        const char *mName;
+        double      mPercent;
+    } Percentile[] = {
+        { "p50",   50 },
+        { "p90",   90 },
+        { "p99",   99 },
+        { "p99.9", 99.9 },
+    };
+
+    uint64_t userMicros   = 0;
+    uint64_t systemMicros = 0;
+    uint64_t maxRss       = 0;
+    unsigned failed       = 0;
+
+    for (unsigned ix = 0; ix < aSamples; ++ix) {
+        userMicros   += timeval_micros(&aSample[ix].mUsage.ru_utime);
+        systemMicros += timeval_micros(&aSample[ix].mUsage.ru_stime);
+
+        if (maxRss < rusage_maxrss(&aSample[ix].mUsage))
+            maxRss = rusage_maxrss(&aSample[ix].mUsage);
+
+        if (aSample[ix].mStatus)
+            ++failed;
+    }
+
+    if (aSamples) {
+        userMicros   /= aSamples;
+        systemMicros /= aSamples;
+    }
+
+    uint64_t minMicros = aWall->mTotal ? aWall->mMin : 0;
+
+    switch (optFormat) {
+
+    case ReportText:
+        fprintf(aFile,
+            "Runs:    %u (warmup %u, failed %u)\n",
+            aSamples, optWarmup, failed);
+
+        fprintf(aFile,
+            "Wall:    mean %" PRIu64 "us  min %" PRIu64 "us\n        ",
+            hdr_mean(aWall), minMicros);
+
+        for (unsigned ix = 0; ix < NUMBEROF(Percentile); ++ix)
+            fprintf(aFile, " %s %" PRIu64 "us ",
+                Percentile[ix].mName,
+                hdr_percentile(aWall, Percentile[ix].mPercent));
+
+        fprintf(aFile, " max %" PRIu64 "us\n", aWall->mMax);
+
+        fprintf(aFile,
+            "Cpu:     user %" PRIu64 "us  sys %" PRIu64 "us  (mean)\n",
+            userMicros, systemMicros);
+
+        fprintf(aFile,
+            "Memory:  maxrss %" PRIu64 "KiB  (max)\n", maxRss);
+        break;
+
+    case ReportCsv:
+        fprintf(aFile, "run,exit,signal,wall_us,user_us,sys_us,maxrss_kib\n");
+
+        for (unsigned ix = 0; ix < aSamples; ++ix) {
+            const struct RunSample *sample = &aSample[ix];
+
+            fprintf(aFile,
+                "%u,%d,%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                ix + 1,
+                0x100 > sample->mStatus ? sample->mStatus : -1,
+                0x100 > sample->mStatus ? 0 : sample->mStatus - 0x100,
+                sample->mWallMicros,
+                timeval_micros(&sample->mUsage.ru_utime),
+                timeval_micros(&sample->mUsage.ru_stime),
+                rusage_maxrss(&sample->mUsage));
+        }
+        break;
+
+    case ReportJson:
+        fprintf(aFile,
+            "{\"runs\":%u,\"warmup\":%u,\"failed\":%u,"
+            "\"wall_us\":{\"mean\":%" PRIu64 ",\"min\":%" PRIu64,
+            aSamples, optWarmup, failed, hdr_mean(aWall), minMicros);
+
+        for (unsigned ix = 0; ix < NUMBEROF(Percentile); ++ix)
+            fprintf(aFile, ",\"%s\":%" PRIu64,
+                Percentile[ix].mName,
+                hdr_percentile(aWall, Percentile[ix].mPercent));
+
+        fprintf(aFile,
+            ",\"max\":%" PRIu64 "},"
+            "\"user_us\":{\"mean\":%" PRIu64 "},"
+            "\"sys_us\":{\"mean\":%" PRIu64 "},"
+            "\"maxrss_kib\":{\"max\":%" PRIu64 "},"
+            "\"samples\":[",
+            aWall->mMax, userMicros, systemMicros, maxRss);
+
+        for (unsigned ix = 0; ix < aSamples; ++ix) {
+            const struct RunSample *sample = &aSample[ix];
+
+            fprintf(aFile,
+                "%s{\"exit\":%d,\"signal\":%d,\"wall_us\":%" PRIu64 ","
+                "\"user_us\":%" PRIu64 ",\"sys_us\":%" PRIu64 ","
+                "\"maxrss_kib\":%" PRIu64 "}",
+                ix ? "," : "",
+                0x100 > sample->mStatus ? sample->mStatus : -1,
+                0x100 > sample->mStatus ? 0 : sample->mStatus - 0x100,
+                sample->mWallMicros,
+                timeval_micros(&sample->mUsage.ru_utime),
+                timeval_micros(&sample->mUsage.ru_stime),
+                rusage_maxrss(&sample->mUsage));
+        }
+
+        fprintf(aFile, "]}\n");
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int
+run_repeat(uint64_t aMinDuration, uint64_t aMaxDuration, char **aCmd)
+{
+    int rc = -1;
+
+    int   nullFd     = -1;
+    int   reportFd   = -1;
+    FILE *reportFile = 0;
+
+    struct RunSample   *sample = 0;
+    struct HdrHistogram wallHist = { .mCount = 0 };
+
+    /* Write the report to standard output, but discard the output of
+     * the command so that it does not interleave with the report. */
+
+    reportFd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+    if (-1 == reportFd)
+        goto Finally;
+
+    reportFile = fdopen(reportFd, "w");
+    if (!reportFile)
+        goto Finally;
+    reportFd = -1;
+
+    nullFd = open("/dev/null", O_WRONLY);
+    if (-1 == nullFd)
+        goto Finally;
+
+    if (STDOUT_FILENO != dup2(nullFd, STDOUT_FILENO))
+        goto Finally;
+
+    sample = calloc(optRepeat, sizeof(*sample));
+    if (!sample)
+        goto Finally;
+
+    if (hdr_init(&wallHist, TIMEBOUND_REPEAT_HIGHEST, TIMEBOUND_REPEAT_DIGITS))
+        goto Finally;
+
+    /* Stop early if a signal is caught, and report the runs that were
+     * completed before the interrupted run. */
+
+    unsigned samples = 0;
+    unsigned failed  = 0;
+
+    for (unsigned run = 0; run < optWarmup + optRepeat; ++run) {
+
+        struct RunSample runSample;
+
+        if (-1 == run_command(aMinDuration, aMaxDuration, aCmd, &runSample))
+            goto Finally;
+
+        if (caughtSignal)
+            break;
+
+        DEBUG("Run %u status 0x%03x wall %" PRIu64 "us",
+            run, runSample.mStatus, runSample.mWallMicros);
+
+        if (run < optWarmup)
+            continue;
+
+        sample[samples++] = runSample;
+
+        if (runSample.mStatus)
+            ++failed;
+
+        if (hdr_record(&wallHist, runSample.mWallMicros))
+            hdr_record(&wallHist, TIMEBOUND_REPEAT_HIGHEST);
+    }
+
+    report_repeat(reportFile, &wallHist, sample, samples);
+
+    if (fflush(reportFile))
+        goto Finally;
+
+    rc = caughtSignal ? 0x100 + caughtSignal : !!failed;
+
+Finally:
+
+    FINALLY({
+        hdr_close(&wallHist);
+        free(sample);
+
+        if (reportFile)
+            fclose(reportFile);
+
+        if (-1 != reportFd)
+            close(reportFd);
+
+        if (-1 != nullFd)
+            close(nullFd);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+prepare_job(void *aArg)
+{
+    int rc = -1;
+
+    int nullFd = -1;
+
+    const struct BatchReader *reader = aArg;
+
+    /* Jobs must not consume the job lines when these are read from
+     * standard input. */
+
+    if (STDIN_FILENO == reader->mFd) {
+        nullFd = open("/dev/null", O_RDONLY);
+        if (-1 == nullFd)
+            goto Finally;
+
+        if (STDIN_FILENO != dup2(nullFd, STDIN_FILENO))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (-1 != nullFd)
+            close(nullFd);
+    });
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+batch_read(int aMonitorFd, struct BatchReader *aReader, char **aLine)
+{
+    int rc = -1;
+
+    /* Return the next line, reading more input only while the input is
+     * readable so that a slow writer cannot defer the bounds of running
+     * jobs. Otherwise wait for more input. A final line without a
+     * newline is accepted at end of file. The line remains valid until
+     * the next call. */
+
+    while (1) {
+
+        if (aReader->mSkip) {
+            aReader->mLen -= aReader->mSkip;
+            memmove(aReader->mBuf,
+                aReader->mBuf + aReader->mSkip, aReader->mLen);
+            aReader->mSkip = 0;
+        }
+
+        char *endLine = memchr(aReader->mBuf, '\n', aReader->mLen);
+
+        if (endLine || (aReader->mEof && aReader->mLen)) {
+            if (!endLine)
+                endLine = aReader->mBuf + aReader->mLen;
+
+            aReader->mSkip = endLine - aReader->mBuf;
+            if (aReader->mSkip < aReader->mLen)
+                ++aReader->mSkip;
+
+            *endLine = 0;
+            *aLine   = aReader->mBuf;
+
+            ++aReader->mLineNo;
+
+            rc = 1;
+            break;
+        }
+
+        if (aReader->mEof) {
+            rc = 0;
+            break;
+        }
+
+        if (sizeof(aReader->mBuf) - 1 == aReader->mLen)
+            die("Job line %u is too long", aReader->mLineNo + 1);
+
+        struct pollfd pollFd = { .fd = aReader->mFd, .events = POLLIN };
+
+        int pollCount = poll(&pollFd, 1, 0);
+        if (-1 == pollCount) {
+            if (EINTR == errno)
+                continue;
+            goto Finally;
+        }
+
+        if (!pollCount) {
+            if (proc_monitor_oneshot(aMonitorFd, aReader->mFd, 0))
+                goto Finally;
+
+            rc = 0;
+            break;
+        }
+
+        ssize_t readLen = read(
+            aReader->mFd,
+            aReader->mBuf + aReader->mLen,
+            sizeof(aReader->mBuf) - 1 - aReader->mLen);
+
+        if (-1 == readLen) {
+            if (EINTR == errno)
+                continue;
+            goto Finally;
+        }
+
+        if (!readLen)
+            aReader->mEof = 1;
+
+        aReader->mLen += readLen;
+    }
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+batch_words(char *aLine, char **aWord, unsigned aWords)
+{
+    int rc = -1;
+
+    /* Split the line into words separated by blanks, honouring single
+     * and double quotes, and backslash escapes, but performing no other
+     * expansion. The words are rewritten in place, and a word beginning
+     * with # starts a comment. */
+
+    unsigned words = 0;
+
+    char *srcPtr = aLine;
+    char *dstPtr = aLine;
+
+    while (1) {
+
+        while (isblank((unsigned char) *srcPtr))
+            ++srcPtr;
+
+        if (!*srcPtr || '#' == *srcPtr)
+            break;
+
+        if (words + 1 >= aWords) {
+            errno = E2BIG;
+            goto Finally;
+        }
+
+        aWord[words++] = dstPtr;
+
+        char quote = 0;
+
+        for ( ; *srcPtr; ++srcPtr) {
+            if (quote) {
+                if (quote == *srcPtr) {
+                    quote = 0;
+                    continue;
+                }
+
+                if ('"' == quote && '\\' == *srcPtr &&
+                        srcPtr[1] && strchr("\"\\", srcPtr[1]))
+                    ++srcPtr;
+            } else {
+                if (isblank((unsigned char) *srcPtr))
+                    break;
+
+                if ('\'' == *srcPtr || '"' == *srcPtr) {
+                    quote = *srcPtr;
+                    continue;
+                }
+
+                if ('\\' == *srcPtr && srcPtr[1])
+                    ++srcPtr;
+            }
+
+            *dstPtr++ = *srcPtr;
+        }
+
+        if (quote) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        if (*srcPtr)
+            ++srcPtr;
+
+        *dstPtr++ = 0;
+    }
+
+    aWord[words] = 0;
+
+    rc = words;
+
+Finally:
+
+    return rc;
+}
+
+/*----------------------------------------------------------------------------*/
+char **
+batch_job(char **aWord, uint64_t *aMin, uint64_t *aMax)
+{
+    int rc = -1;
+
+    /* Each job line has the same form as the command line, with
+     * optional bounds that override those of the command line:
+     *
+     *     [ min [max] -- ] cmd ...
+     */
+
+    char **word = aWord;
+
+    if (*word && isdigit((unsigned char) **word)) {
+        if (clk_strtomicros(aMin, *word++))
+            goto Finally;
+
+        *aMax = 0;
+
+        if (*word && isdigit((unsigned char) **word)) {
+            if (clk_strtomicros(aMax, *word++) || !*aMax || *aMax < *aMin)
+                goto Finally;
+        }
+
+        if (!*word || strcmp("--", *word))
+            goto Finally;
+    }
+
+    if (*word && !strcmp("--", *word))
+        ++word;
+
+    if (!*word)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : word;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+batch_record(const struct BatchJob *aJob)
+{
+    /* Stream each result as a single line of space separated key=value
+     * fields so that results from concurrent jobs are not interleaved. */
+
+    int exitStatus = 0x100 > aJob->mStatus ? aJob->mStatus : -1;
+    int termSignal = 0x100 > aJob->mStatus ? 0 : aJob->mStatus - 0x100;
+
+    uint64_t durationMicros = aJob->mEndMicros - aJob->mBeginMicros;
+
+    char record[256];
+
+    int recordLen = snprintf(record, sizeof(record),
+        "job=%u pid=%d exit=%d signal=%d"
+        " duration=%" PRIu64 ".%06" PRIu64 " timedout=%d\n",
+        aJob->mLineNo, aJob->mPid, exitStatus, termSignal,
+        durationMicros / 1000000, durationMicros % 1000000,
+        !!aJob->mEscalation.mSignals);
+
+    if (recordLen != fd_write(STDOUT_FILENO, record, recordLen))
+        warn("Unable to write result of job %u", aJob->mLineNo);
+}
+
+/*----------------------------------------------------------------------------*/
+int
+batch_millis(int aWaitMillis, uint64_t aNowMicros, uint64_t aUntilMicros)
+{
+    /* Shorten the wait so that it ends no earlier than the given time,
+     * rounding up to avoid waking before the time is reached. */
+
+    uint64_t waitMicros = aUntilMicros > aNowMicros
+        ? aUntilMicros - aNowMicros : 0;
+
+    int untilMillis = waitMicros / 1000 >= INT_MAX
+        ? INT_MAX : (waitMicros + 999) / 1000;
+
+    return -1 == aWaitMillis || untilMillis < aWaitMillis
+        ? untilMillis : aWaitMillis;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+run_batch(const char *aPath)
+{
+    int rc = -1;
+
+    int monitorFd = -1;
+
+    struct BatchReader *reader = 0;
+    struct BatchJob    *job    = 0;
+
+    reader = calloc(1, sizeof(*reader));
+    if (!reader)
+        goto Finally;
+
+    reader->mFd = -1;
+
+    job = calloc(optJobs, sizeof(*job));
+    if (!job)
+        goto Finally;
+
+    if (!strcmp("-", aPath))
+        reader->mFd = STDIN_FILENO;
+    else {
+        reader->mFd = open(aPath, O_RDONLY | O_CLOEXEC);
+        if (-1 == reader->mFd)
+            die("Unable to open batch %s", aPath);
+    }
+
+    sigset_t caughtSet;
+
+    signal_caught(&caughtSet);
+
+    monitorFd = proc_monitor_create(0, &caughtSet);
+    if (-1 == monitorFd)
+        goto Finally;
+
+    signal_catch();
+
+    /* Run the jobs in a single event loop that reads job lines only
+     * when there is a free slot, waits on SIGCHLD, and bounds each wait
+     * by the nearest deadline of any job. */
+
+    unsigned jobs     = 0;
+    int      draining = 0;
+    int      failed   = 0;
+
+    while (1) {
+
+        /* Propagate caught signals to every running job, and stop
+         * starting new jobs unless the signal only resumes them. */
+
+        sig_atomic_t sigSet = signalset_sample();
+
+        for (int signal = 0; sigSet; ++signal) {
+            if (sigSet & 1) {
+                if (optTrace && SIGUSR1 == signal) {
+                    dump_trace();
+                } else {
+                    for (unsigned ix = 0; ix < optJobs; ++ix) {
+                        if (job[ix].mPid && -1 == job[ix].mStatus) {
+                            DEBUG("Delivering signal %d to job %u",
+                                signal, job[ix].mLineNo);
+
+                            TRACE(TraceInstant,
+                                SIGCONT == signal ? "continue" : "signal",
+                                job[ix].mPid, signal);
+
+                            proc_kill(job[ix].mPid, signal);
+                        }
+                    }
+
+                    if (SIGCONT != signal)
+                        draining = 1;
+                }
+            }
+            sigSet >>= 1;
+        }
+
+        uint64_t nowMicros = clk_monomicros();
+
+        while (1) {
+            int waitStatus;
+
+            pid_t pid = proc_wait(-1, &waitStatus, WNOHANG, 0);
+
+            if (-1 == pid) {
+                if (EINTR == errno)
+                    continue;
+                if (ECHILD == errno)
+                    break;
+                fatal("Unable to wait for jobs");
+            }
+
+            if (!pid)
+                break;
+
+            for (unsigned ix = 0; ix < optJobs; ++ix) {
+                if (pid == job[ix].mPid && -1 == job[ix].mStatus) {
+                    job[ix].mStatus = WIFEXITED(waitStatus)
+                        ? 0x000 + WEXITSTATUS(waitStatus)
+                        : 0x100 + WTERMSIG(waitStatus);
+                    job[ix].mEndMicros = nowMicros;
+
+                    DEBUG("Job %u status 0x%03x",
+                        job[ix].mLineNo, job[ix].mStatus);
+
+                    TRACE(TraceInstant, "exit", pid, job[ix].mStatus);
+                    break;
+                }
+            }
+        }
+
+        /* Escalate running jobs that have reached their maximum bound,
+         * and release the slots of completed jobs once their minimum
+         * bound has elapsed. */
+
+        int waitMillis = -1;
+
+        for (unsigned ix = 0; ix < optJobs; ++ix) {
+
+            struct BatchJob *slot = &job[ix];
+
+            if (!slot->mLineNo)
+                continue;
+
+            if (-1 == slot->mStatus) {
+                if (!slot->mEscalation.mMicros)
+                    continue;
+
+                const struct EscalateStep *step =
+                    escalate_signal(&slot->mEscalation, nowMicros);
+
+                if (step) {
+                    DEBUG("Escalating signal %d to job %u",
+                        step->mSignal, slot->mLineNo);
+
+                    TRACE(TraceInstant, "terminate", slot->mPid, step->mSignal);
+
+                    proc_kill(slot->mPid, step->mSignal);
+                }
+
+                waitMillis = batch_millis(
+                    waitMillis, nowMicros, slot->mEscalation.mMicros);
+
+            } else {
+                uint64_t releaseMicros = slot->mEndMicros;
+
+                if (0x100 > slot->mStatus &&
+                        slot->mBeginMicros + slot->mMinMicros > releaseMicros)
+                    releaseMicros = slot->mBeginMicros + slot->mMinMicros;
+
+                if (nowMicros < releaseMicros) {
+                    waitMillis = batch_millis(
+                        waitMillis, nowMicros, releaseMicros);
+                    continue;
+                }
+
+                batch_record(slot);
+
+                if (slot->mStatus)
+                    failed = 1;
+
+                memset(slot, 0, sizeof(*slot));
+                --jobs;
+            }
+        }
+
+        /* Start new jobs while there are free slots. A job that cannot
+         * be executed is reported with the status used by the shell. */
+
+        while (!draining && jobs < optJobs) {
+
+            char *line;
+
+            int readLine = batch_read(monitorFd, reader, &line);
+            if (-1 == readLine)
+                fatal("Unable to read batch %s", aPath);
+
+            if (!readLine) {
+                if (reader->mEof)
+                    draining = 1;
+                break;
+            }
+
+            char *word[TIMEBOUND_BATCH_WORDS];
+
+            int words = batch_words(line, word, NUMBEROF(word));
+
+            if (!words)
+                continue;
+
+            uint64_t minMicros = optMin;
+            uint64_t maxMicros = optMax;
+
+            char **cmd = -1 == words
+                ? 0 : batch_job(word, &minMicros, &maxMicros);
+
+            if (!cmd) {
+                warn("Unable to parse job line %u", reader->mLineNo);
+                failed = 1;
+                continue;
+            }
+
+            struct BatchJob *slot = job;
+
+            while (slot->mLineNo)
+                ++slot;
+
+            slot->mLineNo      = reader->mLineNo;
+            slot->mStatus      = -1;
+            slot->mMinMicros   = minMicros;
+            slot->mBeginMicros = clk_monomicros();
+
+            escalate_init(&slot->mEscalation, optEscalate, optEscalates);
+
+            TRACE(TraceInstant, "spawn", 0, slot->mLineNo);
+
+            pid_t pid = proc_execute(cmd, prepare_job, reader);
+
+            if (-1 == pid) {
+                slot->mStatus    = ENOENT == errno ? 127 : 126;
+                slot->mEndMicros = slot->mBeginMicros;
+                waitMillis       = 0;
+            } else {
+                slot->mPid = pid;
+
+                TRACE(TraceInstant, "exec", pid, slot->mLineNo);
+
+                if (maxMicros) {
+                    escalate_start(
+                        &slot->mEscalation, slot->mBeginMicros + maxMicros);
+
+                    waitMillis = batch_millis(waitMillis,
+                        slot->mBeginMicros, slot->mEscalation.mMicros);
+                }
+            }
+
+            ++jobs;
+        }
+
+        if (draining && !jobs)
+            break;
+
+        struct ProcMonitorEvent procEvent;
+
+        if (proc_monitor_wait(monitorFd, waitMillis, &procEvent))
+            fatal("Unable to wait for process monitor");
+    }
+
+    rc = failed;
+
+Finally:
+
+    FINALLY({
+        signal_release();
+
+        if (-1 != monitorFd)
+            proc_monitor_close(monitorFd);
+
+        if (reader) {
+            if (-1 != reader->mFd && STDIN_FILENO != reader->mFd)
+                close(reader->mFd);
+        }
+
+        free(job);
+        free(reader);
+    });
+
+    return rc;
+}
+
+/******************************************************************************/
+int
+main(int argc, char **argv)
+{
+    int exitCode   = 255;
+    int exitSignal = 0;
+
+    char **cmd = parse_options(argc, argv);
+    if (!cmd || (!optBatch && !cmd[0]))
+        usage();
+
+    if (!optEscalates) {
+        optEscalate[optEscalates++] =
+            (struct EscalateStep) { SIGTERM, 5 * 1000000 };
+        optEscalate[optEscalates++] =
+            (struct EscalateStep) { SIGKILL, 5 * 1000000 };
+    }
+
+    if (optTrace) {
+        if (trace_open(TIMEBOUND_TRACE_EVENTS))
+            die("Unable to create trace");
+        signal_include(SIGUSR1);
+    }
+
+    if (optPeriod) {
+        int runExit = run_periodic(optMax, cmd);
+
+        if (-1 == runExit)
+            goto Finally;
+
+        if (0x100 <= runExit)
+            exitSignal = runExit - 0x100;
+
+        goto Finally;
+    }
+
+    if (optRepeat) {
+        int runExit = run_repeat(optMin, optMax, cmd);
+
+        if (-1 == runExit)
+            goto Finally;
+
+        if (0x100 <= runExit) {
+            exitSignal = runExit - 0x100;
+            goto Finally;
+        }
+
+        exitCode = runExit;
+        goto Finally;
+    }
+
+    if (optBatch) {
+        if (!optJobs) {
+            long onlineCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+            optJobs = 0 < onlineCpus ? onlineCpus : 1;
+        }
+
+        exitCode = run_batch(optBatch);
+        goto Finally;
+    }
+
+    int cmdExit = run_command(optMin, optMax, cmd, 0);
+
+    if (-1 == cmdExit)
+        goto Finally;
+
+    /* If a resource budget was exceeded, report the budget rather than
+     * the outcome of the child process. */
+
+    if (0x200 <= cmdExit) {
+        exitCode = cmdExit - 0x200;
+        goto Finally;
+    }
+
+    /* If the child process terminated due to a signal, reproduce
+     * that signal here so that the outcome is visible to the
+     * grandparent. */
+
+    if (0x100 <= cmdExit) {
+        exitSignal = cmdExit - 0x100;
+        goto Finally;
+    }
+
+    exitCode = cmdExit;
+
+Finally:
+
+    /* Write the trace before reproducing the signal that terminated
+     * the child process, because the signal terminates this process. */
+
+    if (optTrace)
+        dump_trace();
+
+    if (exitSignal)
+        kill(getpid(), exitSignal);
 
     return exitCode;
 }